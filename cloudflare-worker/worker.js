@@ -7,7 +7,20 @@
  *
  * KV namespace binding: ATOMCLAW_HISTORY
  * KV key: user:{discord_user_id}
- * KV value: { summary: string, history: Message[], history_count: number }
+ * KV value: { summary: string, history: Message[], history_count: number, version: number }
+ *
+ * version is bumped on every write (/save, /save_batch, /update_summary) and
+ * exposed as the ETag of /summary, so the ESP32 can revalidate its cached
+ * summary with If-None-Match and get a body-less 304.
+ *
+ * counted_from is history_count before the last write that appended turns;
+ * needs_summarize compares it with history_count, so a batch that steps
+ * over a SUMMARIZE_EVERY boundary still asks for a summary.
+ *
+ * applied_ids holds the ids of the last APPLIED_IDS_MAX turns. The ESP32
+ * resends a /save_batch or /turn whose response it did not get (journal
+ * replay); turns whose id is already listed are skipped, so a resend does
+ * not duplicate history or move history_count.
  *
  * Environment variables:
  *   AUTH_TOKEN       - Optional bearer token to restrict access from ESP32
@@ -15,9 +28,11 @@
  *                      (Worker just sets a flag; ESP32 decides what to do)
  *
  * Routes:
- *   GET  /summary?user_id=...   → { summary, needs_summarize, history_count }
+ *   GET  /summary?user_id=...   → { summary, needs_summarize, history_count }  (ETag, 304)
  *   POST /save                  → { ok, history_count, needs_summarize }
- *   POST /update_summary        → { ok }   (ESP32 pushes its own summary)
+ *   POST /save_batch            → { ok, saved, users: { [user_id]: { etag, history_count, needs_summarize } } }
+ *   POST /update_summary        → { ok, etag }   (ESP32 pushes its own summary)
+ *   POST /turn                  → { summary, needs_summarize, history_count, etag }  (ETag)
  *   GET  /history?user_id=...   → { history: [...] }  (for debug/admin)
  *   GET  /health                → { ok }
  *
@@ -27,6 +42,7 @@
 
 const DEFAULT_SUMMARIZE_EVERY = 20;
 const MAX_HISTORY = 100;
+const APPLIED_IDS_MAX = 256;
 
 // ── Auth ──────────────────────────────────────────────────────────────────
 
@@ -53,6 +69,73 @@ async function putUserData(env, userId, data) {
   );
 }
 
+// ── History ───────────────────────────────────────────────────────────────
+
+function appendTurn(data, role, content, timestamp) {
+  data.history.push({
+    role,
+    content: String(content).slice(0, 2000),
+    ts: timestamp ?? Math.floor(Date.now() / 1000),
+  });
+
+  data.history_count = (data.history_count ?? 0) + 1;
+  bumpVersion(data);
+
+  // 古い履歴をローテーション
+  if (data.history.length > MAX_HISTORY) {
+    data.history = data.history.slice(-MAX_HISTORY);
+    // 大幅に削った後は要約済みフラグをリセット
+    delete data.last_summarized_at;
+  }
+}
+
+// 1回の書き込みで複数ターンを追加する。counted_from に追加前の件数を残し、
+// summaryDue() が SUMMARIZE_EVERY の境界を飛び越えた場合も検出できるようにする。
+// id 付きのターンは applied_ids で重複を除く（再送されたバッチを二重に数えない）。
+function appendTurns(data, turns) {
+  const before = data.history_count ?? 0;
+  const ids = data.applied_ids ?? [];
+  const applied = new Set(ids);
+  let n = 0;
+  for (const t of turns) {
+    if (!t || !t.role || !t.content) continue;
+    if (t.id) {
+      const id = String(t.id);
+      if (applied.has(id)) continue;
+      applied.add(id);
+      ids.push(id);
+    }
+    appendTurn(data, t.role, t.content, t.timestamp);
+    n++;
+  }
+  if (ids.length > 0) data.applied_ids = ids.slice(-APPLIED_IDS_MAX);
+  if (n > 0) data.counted_from = before;
+  return n;
+}
+
+function bumpVersion(data) {
+  data.version = (data.version ?? 0) + 1;
+}
+
+function etagOf(data) {
+  return `"v${data.version ?? 0}"`;
+}
+
+// /summary が返す needs_summarize と同じ判定。
+// 直近の書き込みが every の倍数をまたいだか（ちょうど止まったかではなく）で見る。
+// counted_from の無い古いデータは1件ずつ追加されたものとして扱う。
+function summaryDue(env, data) {
+  const every = parseInt(env.SUMMARIZE_EVERY ?? DEFAULT_SUMMARIZE_EVERY);
+  const count = data.history_count ?? 0;
+  const from = data.counted_from ?? count - 1;
+  return count > 0 && Math.floor(count / every) > Math.floor(from / every) && !data.last_summarized_at;
+}
+
+function needsSummarize(env, data) {
+  const every = parseInt(env.SUMMARIZE_EVERY ?? DEFAULT_SUMMARIZE_EVERY);
+  return data.history_count % every === 0;
+}
+
 // ── Handlers ──────────────────────────────────────────────────────────────
 
 /**
@@ -65,18 +148,20 @@ async function handleSummary(request, env) {
   const userId = new URL(request.url).searchParams.get("user_id");
   if (!userId) return Response.json({ error: "Missing user_id" }, { status: 400 });
 
-  const data  = await getUserData(env, userId);
-  const every = parseInt(env.SUMMARIZE_EVERY ?? DEFAULT_SUMMARIZE_EVERY);
+  const data = await getUserData(env, userId);
+  const etag = etagOf(data);
 
-  // needs_summarize: Worker が ESP32 に「そろそろ要約して」と伝えるフラグ
-  const needs_summarize =
-    data.history_count > 0 && data.history_count % every === 0 && !data.last_summarized_at;
+  // 変更がなければ本文なしで 304 を返す（ESP32 はキャッシュを使う）
+  if (request.headers.get("If-None-Match") === etag) {
+    return new Response(null, { status: 304, headers: { ETag: etag } });
+  }
 
+  // needs_summarize: Worker が ESP32 に「そろそろ要約して」と伝えるフラグ
   return Response.json({
     summary:          data.summary ?? "",
-    needs_summarize:  needs_summarize,
+    needs_summarize:  summaryDue(env, data),
     history_count:    data.history_count ?? 0,
-  });
+  }, { headers: { ETag: etag } });
 }
 
 /**
@@ -97,34 +182,56 @@ async function handleSave(request, env) {
   }
 
   const data = await getUserData(env, user_id);
-
-  data.history.push({
-    role,
-    content: String(content).slice(0, 2000),
-    ts: timestamp ?? Math.floor(Date.now() / 1000),
-  });
-
-  data.history_count = (data.history_count ?? 0) + 1;
-
-  // 古い履歴をローテーション
-  if (data.history.length > MAX_HISTORY) {
-    data.history = data.history.slice(-MAX_HISTORY);
-    // 大幅に削った後は要約済みフラグをリセット
-    delete data.last_summarized_at;
-  }
-
+  appendTurns(data, [{ role, content, timestamp }]);
   await putUserData(env, user_id, data);
 
-  const every = parseInt(env.SUMMARIZE_EVERY ?? DEFAULT_SUMMARIZE_EVERY);
-  const needs_summarize = data.history_count % every === 0;
-
   return Response.json({
     ok:             true,
     history_count:  data.history_count,
-    needs_summarize,  // ESP32 はこれを見て llm_proxy で要約を生成し /update_summary を叩く
+    needs_summarize: needsSummarize(env, data),  // ESP32 はこれを見て llm_proxy で要約を生成し /update_summary を叩く
   });
 }
 
+/**
+ * POST /save_batch
+ * Body: { items: [{ id?, user_id, role, content, timestamp }, ...] }
+ *
+ * ESP32 の書き込みタスクがまとめて送る複数ターン（複数ユーザー可）を保存する。
+ * ユーザーごとに KV を1回読み、1回書く。不正な要素はスキップする。
+ */
+async function handleSaveBatch(request, env) {
+  let body;
+  try { body = await request.json(); }
+  catch { return Response.json({ error: "Invalid JSON" }, { status: 400 }); }
+
+  const items = Array.isArray(body?.items) ? body.items : null;
+  if (!items) return Response.json({ error: "Missing items" }, { status: 400 });
+
+  // 到着順を保ったままユーザーごとにまとめる
+  const byUser = new Map();
+  for (const it of items) {
+    if (!it || !it.user_id || !it.role || !it.content) continue;
+    if (!byUser.has(it.user_id)) byUser.set(it.user_id, []);
+    byUser.get(it.user_id).push(it);
+  }
+
+  const users = {};
+  let saved = 0;
+  await Promise.all([...byUser].map(async ([userId, turns]) => {
+    const data = await getUserData(env, userId);
+    const added = appendTurns(data, turns);
+    if (added > 0) await putUserData(env, userId, data);
+    saved += added;
+    users[userId] = {
+      etag:            etagOf(data),
+      history_count:   data.history_count,
+      needs_summarize: summaryDue(env, data),
+    };
+  }));
+
+  return Response.json({ ok: true, saved, users });
+}
+
 /**
  * POST /update_summary
  * Body: { user_id, summary }
@@ -145,9 +252,44 @@ async function handleUpdateSummary(request, env) {
   const data = await getUserData(env, user_id);
   data.summary = String(summary).slice(0, 3000);
   data.last_summarized_at = Math.floor(Date.now() / 1000);
+  bumpVersion(data);
 
   await putUserData(env, user_id, data);
-  return Response.json({ ok: true });
+  return Response.json({ ok: true, etag: etagOf(data) });
+}
+
+/**
+ * POST /turn
+ * Body: { user_id, turns?: [{ id?, role, content, timestamp }], summary? }
+ *
+ * ESP32 は次のリクエストの冒頭で1回だけ呼ぶ。前回のやり取りと（あれば）
+ * 新しい要約を保存し、最新の要約を返す。KV の読み書きは1回ずつ。
+ */
+async function handleTurn(request, env) {
+  let body;
+  try { body = await request.json(); }
+  catch { return Response.json({ error: "Invalid JSON" }, { status: 400 }); }
+
+  const { user_id, turns, summary } = body ?? {};
+  if (!user_id) return Response.json({ error: "Missing user_id" }, { status: 400 });
+
+  const data = await getUserData(env, user_id);
+  let changed = appendTurns(data, Array.isArray(turns) ? turns : []) > 0;
+
+  if (summary) {
+    data.summary = String(summary).slice(0, 3000);
+    data.last_summarized_at = Math.floor(Date.now() / 1000);
+    bumpVersion(data);
+    changed = true;
+  }
+  if (changed) await putUserData(env, user_id, data);
+
+  return Response.json({
+    summary:          data.summary ?? "",
+    needs_summarize:  summaryDue(env, data),
+    history_count:    data.history_count ?? 0,
+    etag:             etagOf(data),
+  }, { headers: { ETag: etagOf(data) } });
 }
 
 /**
@@ -173,7 +315,7 @@ export default {
         headers: {
           "Access-Control-Allow-Origin":  "*",
           "Access-Control-Allow-Methods": "GET, POST, OPTIONS",
-          "Access-Control-Allow-Headers": "Content-Type, Authorization",
+          "Access-Control-Allow-Headers": "Content-Type, Authorization, If-None-Match",
         },
       });
     }
@@ -188,7 +330,9 @@ export default {
 
     if (url.pathname === "/summary"        && request.method === "GET")  return handleSummary(request, env);
     if (url.pathname === "/save"           && request.method === "POST") return handleSave(request, env);
+    if (url.pathname === "/save_batch"     && request.method === "POST") return handleSaveBatch(request, env);
     if (url.pathname === "/update_summary" && request.method === "POST") return handleUpdateSummary(request, env);
+    if (url.pathname === "/turn"           && request.method === "POST") return handleTurn(request, env);
     if (url.pathname === "/history"        && request.method === "GET")  return handleHistory(request, env);
 
     return Response.json({ error: "Not found" }, { status: 404 });
@@ -0,0 +1,236 @@
+/*
+ * Times the llm_proxy.c pull parser against a cJSON DOM walk (the parser
+ * it replaced) on the non-streaming response bodies in responses/.
+ *
+ *   make -C host_test bench            # 2000 parses per parser and body
+ *   ./build/bench_llm_parse 10000
+ *
+ * Both sides start from the same received bytes and produce the same
+ * llm_response_t. "held" is the peak heap a parse keeps: the receive
+ * buffer and tool inputs for the pull parser, plus the cJSON tree for
+ * the DOM walk.
+ */
+#include "../main/llm/llm_proxy.c"
+
+#include <stdio.h>
+#include <time.h>
+
+/* ── Fixtures ─────────────────────────────────────────────────── */
+
+static char *load_response(const char *name, size_t *out_len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", RESPONSE_FIXTURE_DIR, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        exit(2);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *buf = malloc((size_t)size + 1);
+    if (!buf || fread(buf, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "cannot read %s\n", path);
+        exit(2);
+    }
+    fclose(f);
+    while (size > 0 && (buf[size - 1] == '\n' || buf[size - 1] == '\r')) size--;
+    buf[size] = '\0';
+    *out_len = (size_t)size;
+    return buf;
+}
+
+/* ── cJSON heap accounting ────────────────────────────────────── */
+
+static size_t s_tree_bytes;
+static size_t s_tree_peak;
+
+static void *count_malloc(size_t size)
+{
+    size_t *p = malloc(sizeof(size_t) + size);
+    if (!p) return NULL;
+    *p = size;
+    s_tree_bytes += size;
+    if (s_tree_bytes > s_tree_peak) s_tree_peak = s_tree_bytes;
+    return p + 1;
+}
+
+static void count_free(void *ptr)
+{
+    if (!ptr) return;
+    size_t *p = (size_t *)ptr - 1;
+    s_tree_bytes -= *p;
+    free(p);
+}
+
+/* ── DOM walk (former parser) ─────────────────────────────────── */
+
+static void dom_add_call(llm_response_t *resp, cJSON *id, cJSON *name, char *input)
+{
+    if (resp->call_count >= CFG_MAX_TOOL_CALLS) {
+        cJSON_free(input);
+        return;
+    }
+    llm_tool_call_t *call = &resp->calls[resp->call_count++];
+    if (cJSON_IsString(id)) safe_copy(call->id, sizeof(call->id), id->valuestring);
+    if (cJSON_IsString(name)) safe_copy(call->name, sizeof(call->name), name->valuestring);
+    call->input = input;
+    call->input_len = input ? strlen(input) : 0;
+}
+
+static void dom_add_text(llm_response_t *resp, const char *text)
+{
+    size_t len = strlen(text);
+    char *grown = realloc(resp->text, resp->text_len + len + 1);
+    if (!grown) return;
+    memcpy(grown + resp->text_len, text, len + 1);
+    resp->text = grown;
+    resp->text_len += len;
+}
+
+static esp_err_t dom_parse(const char *body, bool openai, llm_response_t *resp)
+{
+    cJSON *root = cJSON_Parse(body);
+    if (!root) return ESP_FAIL;
+
+    if (openai) {
+        cJSON *choice = cJSON_GetArrayItem(cJSON_GetObjectItem(root, "choices"), 0);
+        cJSON *msg    = cJSON_GetObjectItem(choice, "message");
+        cJSON *finish = cJSON_GetObjectItem(choice, "finish_reason");
+        cJSON *content = cJSON_GetObjectItem(msg, "content");
+        if (cJSON_IsString(content)) dom_add_text(resp, content->valuestring);
+        cJSON *tc;
+        cJSON_ArrayForEach(tc, cJSON_GetObjectItem(msg, "tool_calls")) {
+            cJSON *fn   = cJSON_GetObjectItem(tc, "function");
+            cJSON *args = cJSON_GetObjectItem(fn, "arguments");
+            char *input = NULL;
+            if (cJSON_IsString(args)) {
+                input = cJSON_malloc(strlen(args->valuestring) + 1);
+                if (input) strcpy(input, args->valuestring);
+            }
+            dom_add_call(resp, cJSON_GetObjectItem(tc, "id"), cJSON_GetObjectItem(fn, "name"), input);
+        }
+        resp->tool_use = cJSON_IsString(finish) && strcmp(finish->valuestring, "tool_calls") == 0;
+    } else {
+        cJSON *stop = cJSON_GetObjectItem(root, "stop_reason");
+        resp->tool_use = cJSON_IsString(stop) && strcmp(stop->valuestring, "tool_use") == 0;
+        cJSON *block;
+        cJSON_ArrayForEach(block, cJSON_GetObjectItem(root, "content")) {
+            cJSON *type = cJSON_GetObjectItem(block, "type");
+            if (!cJSON_IsString(type)) continue;
+            if (strcmp(type->valuestring, "text") == 0) {
+                cJSON *text = cJSON_GetObjectItem(block, "text");
+                if (cJSON_IsString(text)) dom_add_text(resp, text->valuestring);
+            } else if (strcmp(type->valuestring, "tool_use") == 0) {
+                cJSON *input = cJSON_GetObjectItem(block, "input");
+                dom_add_call(resp, cJSON_GetObjectItem(block, "id"),
+                             cJSON_GetObjectItem(block, "name"),
+                             input ? cJSON_PrintUnformatted(input) : NULL);
+            }
+        }
+    }
+    cJSON_Delete(root);
+    return ESP_OK;
+}
+
+static void dom_free(llm_response_t *resp)
+{
+    for (int i = 0; i < resp->call_count; i++) cJSON_free(resp->calls[i].input);
+    free(resp->text);
+    memset(resp, 0, sizeof(*resp));
+}
+
+/* ── Benchmark ────────────────────────────────────────────────── */
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static bool same_result(const llm_response_t *a, const llm_response_t *b)
+{
+    if (a->tool_use != b->tool_use || a->call_count != b->call_count ||
+        a->text_len != b->text_len ||
+        (a->text_len && memcmp(a->text, b->text, a->text_len) != 0)) {
+        return false;
+    }
+    for (int i = 0; i < a->call_count; i++) {
+        if (strcmp(a->calls[i].id, b->calls[i].id) != 0 ||
+            strcmp(a->calls[i].name, b->calls[i].name) != 0 ||
+            !a->calls[i].input || !b->calls[i].input) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool bench(const char *name, bool openai, int iterations)
+{
+    size_t len;
+    char *body = load_response(name, &len);
+    int64_t pull_ns = 0, dom_ns = 0;
+    size_t pull_held = 0, dom_held = 0;
+    bool ok = true;
+
+    for (int i = 0; i < iterations && ok; i++) {
+        /* Pull parser: parses the receive buffer in place */
+        llm_response_t pull = {0};
+        resp_buf_t rb = {0};
+        int64_t t0 = now_ns();
+        ok = resp_buf_append(&rb, body, len) == ESP_OK;
+        size_t cap = rb.cap;
+        ok = ok && parse_response(&rb, openai, &pull) == ESP_OK;
+        pull_ns += now_ns() - t0;
+        size_t held = cap;
+        for (int c = 0; c < pull.call_count; c++) held += pull.calls[c].input_len + 1;
+        if (held > pull_held) pull_held = held;
+
+        /* DOM walk: same received copy, then the tree */
+        llm_response_t dom = {0};
+        s_tree_peak = s_tree_bytes = 0;
+        t0 = now_ns();
+        char *copy = malloc(len + 1);
+        ok = ok && copy;
+        if (copy) {
+            memcpy(copy, body, len + 1);
+            ok = ok && dom_parse(copy, openai, &dom) == ESP_OK;
+            free(copy);
+        }
+        dom_ns += now_ns() - t0;
+        held = len + 1 + s_tree_peak;
+        if (held > dom_held) dom_held = held;
+
+        if (ok && !same_result(&pull, &dom)) {
+            fprintf(stderr, "%s: parsers disagree\n", name);
+            ok = false;
+        }
+        llm_response_free(&pull);
+        dom_free(&dom);
+    }
+
+    if (ok) {
+        printf("%-24s %5zu B  pull %7.2f us %6zu B held   cJSON %7.2f us %6zu B held\n",
+               name, len, pull_ns / 1000.0 / iterations, pull_held,
+               dom_ns / 1000.0 / iterations, dom_held);
+    }
+    free(body);
+    return ok;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = argc > 1 ? atoi(argv[1]) : 2000;
+    if (iterations <= 0) iterations = 2000;
+
+    cJSON_Hooks hooks = { .malloc_fn = count_malloc, .free_fn = count_free };
+    cJSON_InitHooks(&hooks);
+
+    printf("%d parses per parser and body\n", iterations);
+    bool ok = bench("anthropic_tool_use.json", false, iterations) &
+              bench("anthropic_text.json",     false, iterations) &
+              bench("openai_tool_calls.json",  true,  iterations);
+    return ok ? 0 : 1;
+}
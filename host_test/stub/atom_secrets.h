@@ -0,0 +1,4 @@
+#pragma once
+
+/* Host tests build against the placeholder values. */
+#include "atom_secrets.h.template"
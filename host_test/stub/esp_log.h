@@ -0,0 +1,15 @@
+#pragma once
+
+/* Host stub: logging is compiled out unless HOST_TEST_LOG is defined. */
+#include <stdio.h>
+
+#ifdef HOST_TEST_LOG
+#define HOST_LOG_(lvl, tag, fmt, ...) fprintf(stderr, lvl " (%s) " fmt "\n", tag, ##__VA_ARGS__)
+#else
+#define HOST_LOG_(lvl, tag, fmt, ...) do { if (0) fprintf(stderr, fmt, ##__VA_ARGS__); (void)(tag); } while (0)
+#endif
+
+#define ESP_LOGE(tag, fmt, ...) HOST_LOG_("E", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGW(tag, fmt, ...) HOST_LOG_("W", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGI(tag, fmt, ...) HOST_LOG_("I", tag, fmt, ##__VA_ARGS__)
+#define ESP_LOGD(tag, fmt, ...) HOST_LOG_("D", tag, fmt, ##__VA_ARGS__)
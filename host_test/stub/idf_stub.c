@@ -0,0 +1,222 @@
+/* Host definitions for the stub headers in this directory. */
+#include <stdlib.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_crt_bundle.h"
+#include "esp_http_client.h"
+#include "nvs.h"
+#include "freertos/semphr.h"
+#include "proxy/http_proxy.h"
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                return "ESP_OK";
+    case ESP_FAIL:              return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:   return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE: return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:  return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:     return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_TIMEOUT:       return "ESP_ERR_TIMEOUT";
+    default:                    return "ESP_ERR_UNKNOWN";
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/* ── Heap ─────────────────────────────────────────────────────── */
+
+void *heap_caps_malloc(size_t size, uint32_t caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_realloc(void *ptr, size_t size, uint32_t caps)
+{
+    (void)caps;
+    return realloc(ptr, size);
+}
+
+size_t heap_caps_get_free_size(uint32_t caps)
+{
+    (void)caps;
+    return 0;
+}
+
+/* ── FreeRTOS ─────────────────────────────────────────────────── */
+
+struct host_semaphore { int held; };
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return calloc(1, sizeof(struct host_semaphore));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks)
+{
+    (void)ticks;
+    sem->held = 1;
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    sem->held = 0;
+    return pdTRUE;
+}
+
+/* ── NVS: nothing stored ──────────────────────────────────────── */
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t mode, nvs_handle_t *out_handle)
+{
+    (void)name; (void)mode;
+    *out_handle = 0;
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    (void)handle; (void)key; (void)out_value; (void)length;
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    (void)handle; (void)key; (void)value;
+    return ESP_FAIL;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    (void)handle;
+    return ESP_FAIL;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    (void)handle;
+}
+
+/* ── Transport: always fails ──────────────────────────────────── */
+
+esp_err_t esp_crt_bundle_attach(void *conf)
+{
+    (void)conf;
+    return ESP_OK;
+}
+
+esp_http_client_handle_t esp_http_client_init(const esp_http_client_config_t *config)
+{
+    (void)config;
+    return NULL;
+}
+
+esp_err_t esp_http_client_set_method(esp_http_client_handle_t client, esp_http_client_method_t method)
+{
+    (void)client; (void)method;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_set_header(esp_http_client_handle_t client, const char *key, const char *value)
+{
+    (void)client; (void)key; (void)value;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_open(esp_http_client_handle_t client, int write_len)
+{
+    (void)client; (void)write_len;
+    return ESP_ERR_HTTP_CONNECT;
+}
+
+int esp_http_client_write(esp_http_client_handle_t client, const char *buffer, int len)
+{
+    (void)client; (void)buffer; (void)len;
+    return -1;
+}
+
+int esp_http_client_fetch_headers(esp_http_client_handle_t client)
+{
+    (void)client;
+    return -1;
+}
+
+int esp_http_client_get_status_code(esp_http_client_handle_t client)
+{
+    (void)client;
+    return 0;
+}
+
+int esp_http_client_read(esp_http_client_handle_t client, char *buffer, int len)
+{
+    (void)client; (void)buffer; (void)len;
+    return -1;
+}
+
+bool esp_http_client_is_complete_data_received(esp_http_client_handle_t client)
+{
+    (void)client;
+    return false;
+}
+
+esp_err_t esp_http_client_close(esp_http_client_handle_t client)
+{
+    (void)client;
+    return ESP_OK;
+}
+
+esp_err_t esp_http_client_cleanup(esp_http_client_handle_t client)
+{
+    (void)client;
+    return ESP_OK;
+}
+
+bool http_proxy_is_enabled(void)
+{
+    return false;
+}
+
+proxy_conn_t *proxy_conn_open(const char *host, int port, int timeout_ms)
+{
+    (void)host; (void)port; (void)timeout_ms;
+    return NULL;
+}
+
+int proxy_conn_write(proxy_conn_t *conn, const char *data, int len)
+{
+    (void)conn; (void)data; (void)len;
+    return -1;
+}
+
+int proxy_conn_read(proxy_conn_t *conn, char *buf, int len, int timeout_ms)
+{
+    (void)conn; (void)buf; (void)len; (void)timeout_ms;
+    return -1;
+}
+
+bool proxy_conn_is_alive(proxy_conn_t *conn)
+{
+    (void)conn;
+    return false;
+}
+
+void proxy_conn_close(proxy_conn_t *conn)
+{
+    (void)conn;
+}
@@ -0,0 +1,359 @@
+/*
+ * Replays recorded SSE streams through the llm_proxy.c stream parser.
+ *
+ * Each fixture in sse/ is fed in every chunk size from 1 byte up, with LF
+ * and CRLF line endings, so events, UTF-8 sequences and JSON escapes are
+ * split at every possible offset. A generated stream with an over-long
+ * line checks that the stream fails rather than skipping ahead, and tool
+ * input numbers must survive the request writer unchanged. The parser is
+ * static, so the module is compiled into this file; see the Makefile.
+ */
+#include "../main/llm/llm_proxy.c"
+
+#include <stdio.h>
+
+static int s_checks;
+static int s_failures;
+
+#define CHECK(cond, ...) do {                                           \
+        s_checks++;                                                     \
+        if (!(cond)) {                                                  \
+            s_failures++;                                               \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__);        \
+            fprintf(stderr, __VA_ARGS__);                               \
+            fputc('\n', stderr);                                        \
+        }                                                               \
+    } while (0)
+
+/* ── Fixtures ─────────────────────────────────────────────────── */
+
+static char *load_fixture(const char *name, bool crlf, size_t *out_len)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", SSE_FIXTURE_DIR, name);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        exit(2);
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *raw = malloc((size_t)size + 1);
+    char *out = malloc((size_t)size * 2 + 1);
+    if (!raw || !out || fread(raw, 1, (size_t)size, f) != (size_t)size) {
+        fprintf(stderr, "cannot read %s\n", path);
+        exit(2);
+    }
+    fclose(f);
+
+    size_t n = 0;
+    for (long i = 0; i < size; i++) {
+        if (crlf && raw[i] == '\n') out[n++] = '\r';
+        out[n++] = raw[i];
+    }
+    out[n] = '\0';
+    free(raw);
+    *out_len = n;
+    return out;
+}
+
+/* ── Callbacks ────────────────────────────────────────────────── */
+
+typedef struct {
+    resp_buf_t text;                /* concatenated on_text deltas */
+    int tool_calls;                 /* on_tool_use invocations */
+    char tool_order[4][32];         /* names in callback order */
+} replay_ctx_t;
+
+static void on_text(const char *delta, size_t len, void *ctx)
+{
+    replay_ctx_t *rc = ctx;
+    resp_buf_append(&rc->text, delta, len);
+}
+
+static void on_tool_use(const llm_tool_call_t *call, void *ctx)
+{
+    replay_ctx_t *rc = ctx;
+    if (rc->tool_calls < 4) {
+        safe_copy(rc->tool_order[rc->tool_calls], sizeof(rc->tool_order[0]), call->name);
+    }
+    rc->tool_calls++;
+}
+
+/* Feed the stream in chunk-sized pieces through the body sink, stopping
+ * at the first error as the transports do. */
+static esp_err_t replay(const char *stream, size_t len, size_t chunk, bool openai,
+                        replay_ctx_t *rc, llm_response_t *resp, bool *failed)
+{
+    llm_stream_cb_t cb = { .on_text = on_text, .on_tool_use = on_tool_use, .ctx = rc };
+    sse_parser_t sse = {
+        .tool_slot = -1,
+        .openai = openai,
+        .resp = resp,
+        .cb = &cb,
+    };
+    resp_buf_t err_body = {0};
+    body_sink_t sink = { .rb = &err_body, .sse = &sse, .status = 200 };
+    for (size_t off = 0; off < len; off += chunk) {
+        size_t n = len - off < chunk ? len - off : chunk;
+        if (body_sink_feed(&sink, stream + off, n) != ESP_OK) break;
+    }
+    /* Refused after the error, even if the stream would continue */
+    if (sink.err != ESP_OK) {
+        CHECK(body_sink_feed(&sink, "\n", 1) == sink.err, "sink error not latched");
+    }
+    sse_finish(&sse);
+    resp_buf_free(&err_body);
+    *failed = sse.failed;
+    return sink.err;
+}
+
+static bool text_is(const char *got, size_t got_len, const char *want)
+{
+    return got && got_len == strlen(want) && memcmp(got, want, got_len) == 0;
+}
+
+/* ── Streams ──────────────────────────────────────────────────── */
+
+static void check_anthropic_tool_use(const char *stream, size_t len, size_t chunk)
+{
+    replay_ctx_t rc = {0};
+    llm_response_t resp = {0};
+    bool failed;
+    esp_err_t err = replay(stream, len, chunk, false, &rc, &resp, &failed);
+
+    static const char *text = "Let me check the time in \"Tokyo\" and the weather \xE2\x80\x94 one moment.";
+    CHECK(err == ESP_OK, "anthropic chunk=%zu: feed %s", chunk, esp_err_to_name(err));
+    CHECK(!failed, "anthropic chunk=%zu: unexpected error event", chunk);
+    CHECK(text_is(resp.text, resp.text_len, text),
+          "anthropic chunk=%zu: text \"%s\"", chunk, resp.text ? resp.text : "(null)");
+    CHECK(text_is(rc.text.data, rc.text.len, text),
+          "anthropic chunk=%zu: streamed text differs", chunk);
+
+    CHECK(resp.tool_use, "anthropic chunk=%zu: stop_reason not tool_use", chunk);
+    CHECK(resp.call_count == 2, "anthropic chunk=%zu: %d calls", chunk, resp.call_count);
+    if (resp.call_count == 2) {
+        CHECK(strcmp(resp.calls[0].id, "toolu_01T1x1fJ34qAmk2tNTrN7Up6") == 0,
+              "anthropic chunk=%zu: id0 %s", chunk, resp.calls[0].id);
+        CHECK(strcmp(resp.calls[0].name, "get_time") == 0,
+              "anthropic chunk=%zu: name0 %s", chunk, resp.calls[0].name);
+        CHECK(text_is(resp.calls[0].input, resp.calls[0].input_len,
+                      "{\"tz\": \"Asia/Tokyo\", \"fmt\": \"%H:%M\"}"),
+              "anthropic chunk=%zu: input0 %s", chunk,
+              resp.calls[0].input ? resp.calls[0].input : "(null)");
+        CHECK(strcmp(resp.calls[1].name, "web_search") == 0,
+              "anthropic chunk=%zu: name1 %s", chunk, resp.calls[1].name);
+        CHECK(text_is(resp.calls[1].input, resp.calls[1].input_len,
+                      "{\"query\": \"\xE6\x9D\xB1\xE4\xBA\xAC \xE5\xA4\xA9\xE6\xB0\x97\\n\xE4\xBB\x8A\xE6\x97\xA5\"}"),
+              "anthropic chunk=%zu: input1 %s", chunk,
+              resp.calls[1].input ? resp.calls[1].input : "(null)");
+    }
+    CHECK(rc.tool_calls == 2 && strcmp(rc.tool_order[0], "get_time") == 0 &&
+          strcmp(rc.tool_order[1], "web_search") == 0,
+          "anthropic chunk=%zu: %d on_tool_use callbacks", chunk, rc.tool_calls);
+
+    CHECK(resp.usage.input_tokens == 412 && resp.usage.cache_read_tokens == 1850 &&
+          resp.usage.cache_creation_tokens == 0 && resp.usage.output_tokens == 87,
+          "anthropic chunk=%zu: usage in=%u read=%u write=%u out=%u", chunk,
+          (unsigned)resp.usage.input_tokens, (unsigned)resp.usage.cache_read_tokens,
+          (unsigned)resp.usage.cache_creation_tokens, (unsigned)resp.usage.output_tokens);
+
+    resp_buf_free(&rc.text);
+    llm_response_free(&resp);
+}
+
+static void check_anthropic_error(const char *stream, size_t len, size_t chunk)
+{
+    replay_ctx_t rc = {0};
+    llm_response_t resp = {0};
+    bool failed;
+    esp_err_t err = replay(stream, len, chunk, false, &rc, &resp, &failed);
+
+    CHECK(err == ESP_OK, "error chunk=%zu: feed %s", chunk, esp_err_to_name(err));
+    CHECK(failed, "error chunk=%zu: error event not reported", chunk);
+    CHECK(text_is(resp.text, resp.text_len, "Partial"),
+          "error chunk=%zu: text \"%s\"", chunk, resp.text ? resp.text : "(null)");
+    CHECK(resp.call_count == 0 && rc.tool_calls == 0,
+          "error chunk=%zu: %d calls", chunk, resp.call_count);
+
+    resp_buf_free(&rc.text);
+    llm_response_free(&resp);
+}
+
+static void check_openai_tool_calls(const char *stream, size_t len, size_t chunk)
+{
+    replay_ctx_t rc = {0};
+    llm_response_t resp = {0};
+    bool failed;
+    esp_err_t err = replay(stream, len, chunk, true, &rc, &resp, &failed);
+
+    CHECK(err == ESP_OK, "openai chunk=%zu: feed %s", chunk, esp_err_to_name(err));
+    CHECK(!failed, "openai chunk=%zu: unexpected error event", chunk);
+    CHECK(text_is(resp.text, resp.text_len, "Checking both."),
+          "openai chunk=%zu: text \"%s\"", chunk, resp.text ? resp.text : "(null)");
+    CHECK(text_is(rc.text.data, rc.text.len, "Checking both."),
+          "openai chunk=%zu: streamed text differs", chunk);
+
+    CHECK(resp.tool_use, "openai chunk=%zu: finish_reason not tool_calls", chunk);
+    CHECK(resp.call_count == 2, "openai chunk=%zu: %d calls", chunk, resp.call_count);
+    if (resp.call_count == 2) {
+        CHECK(strcmp(resp.calls[0].id, "call_Vx7hC2m0") == 0 &&
+              strcmp(resp.calls[0].name, "get_time") == 0,
+              "openai chunk=%zu: call0 %s %s", chunk, resp.calls[0].id, resp.calls[0].name);
+        CHECK(text_is(resp.calls[0].input, resp.calls[0].input_len, "{\"tz\":\"UTC\"}"),
+              "openai chunk=%zu: input0 %s", chunk,
+              resp.calls[0].input ? resp.calls[0].input : "(null)");
+        CHECK(strcmp(resp.calls[1].id, "call_Q3bN8sLk") == 0 &&
+              strcmp(resp.calls[1].name, "web_search") == 0,
+              "openai chunk=%zu: call1 %s %s", chunk, resp.calls[1].id, resp.calls[1].name);
+        CHECK(text_is(resp.calls[1].input, resp.calls[1].input_len, "{\"query\":\"esp32 psram\"}"),
+              "openai chunk=%zu: input1 %s", chunk,
+              resp.calls[1].input ? resp.calls[1].input : "(null)");
+    }
+    CHECK(rc.tool_calls == 2, "openai chunk=%zu: %d on_tool_use callbacks", chunk, rc.tool_calls);
+
+    CHECK(resp.usage.input_tokens == 44 && resp.usage.cache_read_tokens == 256 &&
+          resp.usage.output_tokens == 40,
+          "openai chunk=%zu: usage in=%u read=%u out=%u", chunk,
+          (unsigned)resp.usage.input_tokens, (unsigned)resp.usage.cache_read_tokens,
+          (unsigned)resp.usage.output_tokens);
+
+    resp_buf_free(&rc.text);
+    llm_response_free(&resp);
+}
+
+/* A data line longer than SSE_MAX_LINE between two text events: the
+ * stream must fail instead of resuming with whatever follows. */
+static char *build_oversized_stream(bool crlf, size_t *out_len)
+{
+    static const char *head =
+        "event: content_block_delta\n"
+        "data: {\"type\":\"content_block_delta\",\"index\":0,"
+        "\"delta\":{\"type\":\"text_delta\",\"text\":\"Before\"}}\n\n"
+        "event: content_block_delta\n"
+        "data: {\"type\":\"content_block_delta\",\"index\":0,"
+        "\"delta\":{\"type\":\"text_delta\",\"text\":\"";
+    static const char *tail =
+        "\"}}\n\n"
+        "event: content_block_delta\n"
+        "data: {\"type\":\"content_block_delta\",\"index\":0,"
+        "\"delta\":{\"type\":\"text_delta\",\"text\":\"After\"}}\n\n"
+        "event: message_stop\n"
+        "data: {\"type\":\"message_stop\"}\n\n";
+    size_t pad = SSE_MAX_LINE + 100;
+    size_t raw_len = strlen(head) + pad + strlen(tail);
+    char *raw = malloc(raw_len + 1);
+    char *out = malloc(raw_len * 2 + 1);
+    if (!raw || !out) exit(2);
+    char *w = raw;
+    w = stpcpy(w, head);
+    memset(w, 'x', pad);
+    w += pad;
+    strcpy(w, tail);
+
+    size_t n = 0;
+    for (size_t i = 0; i < raw_len; i++) {
+        if (crlf && raw[i] == '\n') out[n++] = '\r';
+        out[n++] = raw[i];
+    }
+    out[n] = '\0';
+    free(raw);
+    *out_len = n;
+    return out;
+}
+
+static void check_oversized_line(const char *stream, size_t len, size_t chunk)
+{
+    replay_ctx_t rc = {0};
+    llm_response_t resp = {0};
+    bool failed;
+    esp_err_t err = replay(stream, len, chunk, false, &rc, &resp, &failed);
+
+    CHECK(err == ESP_ERR_INVALID_SIZE, "oversized chunk=%zu: feed %s", chunk, esp_err_to_name(err));
+    CHECK(text_is(rc.text.data, rc.text.len, "Before"),
+          "oversized chunk=%zu: streamed text \"%.*s\"", chunk,
+          (int)(rc.text.len < 40 ? rc.text.len : 40), rc.text.data ? rc.text.data : "");
+
+    resp_buf_free(&rc.text);
+    llm_response_free(&resp);
+}
+
+/* ── Tool input numbers ───────────────────────────────────────── */
+
+static esp_err_t collect_flush(const char *data, size_t len, void *ctx)
+{
+    return resp_buf_append((resp_buf_t *)ctx, data, len);
+}
+
+/* tool_use inputs are echoed back through json_writer_cjson(); a number
+ * must read back as the same double, as it did with cJSON_Print. */
+static void check_number_round_trip(double d)
+{
+    resp_buf_t out = {0};
+    char buf[16];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf), collect_flush, &out);
+    cJSON *num = cJSON_CreateNumber(d);
+    json_writer_cjson(&w, num);
+    cJSON_Delete(num);
+    esp_err_t err = json_writer_finish(&w);
+
+    CHECK(err == ESP_OK && out.data, "number %.17g: writer %s", d, esp_err_to_name(err));
+    if (out.data) {
+        CHECK(strtod(out.data, NULL) == d, "number %.17g: wrote %s", d, out.data);
+    }
+    resp_buf_free(&out);
+}
+
+typedef struct {
+    const char *fixture;
+    void (*check)(const char *stream, size_t len, size_t chunk);
+} replay_case_t;
+
+int main(void)
+{
+    static const replay_case_t cases[] = {
+        { "anthropic_tool_use.txt", check_anthropic_tool_use },
+        { "anthropic_error.txt",    check_anthropic_error },
+        { "openai_tool_calls.txt",  check_openai_tool_calls },
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        for (int crlf = 0; crlf < 2; crlf++) {
+            size_t len;
+            char *stream = load_fixture(cases[i].fixture, crlf, &len);
+            /* Every small chunk size, then the transport's read sizes */
+            for (size_t chunk = 1; chunk <= 64; chunk++) {
+                cases[i].check(stream, len, chunk);
+            }
+            cases[i].check(stream, len, 512);
+            cases[i].check(stream, len, len);
+            /* Trailing blank line missing: sse_finish() flushes the event */
+            cases[i].check(stream, len - (crlf ? 2 : 1), 7);
+            free(stream);
+        }
+    }
+
+    for (int crlf = 0; crlf < 2; crlf++) {
+        size_t len;
+        char *stream = build_oversized_stream(crlf, &len);
+        static const size_t chunks[] = { 1, 7, 64, 512, 2048, 4096 };
+        for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+            check_oversized_line(stream, len, chunks[i]);
+        }
+        check_oversized_line(stream, len, len);
+        free(stream);
+    }
+
+    static const double numbers[] = {
+        0.1, 0.30000000000000004, 1.0 / 3.0, 35.6895, -139.69171, 1e300, 5e-324, 123456789012345678.0,
+    };
+    for (size_t i = 0; i < sizeof(numbers) / sizeof(numbers[0]); i++) {
+        check_number_round_trip(numbers[i]);
+    }
+
+    printf("%d checks, %d failures\n", s_checks, s_failures);
+    return s_failures ? 1 : 0;
+}
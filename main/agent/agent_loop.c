@@ -5,17 +5,19 @@
 #include "llm/llm_proxy.h"
 #include "memory/session_mgr.h"
 #include "tools/tool_registry.h"
+#include "tools/tool_pool.h"
 
 #include <string.h>
 #include <stdlib.h>
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "esp_random.h"
 #include "cJSON.h"
 
 static const char *TAG = "agent";
 
-#define TOOL_OUTPUT_SIZE  (8 * 1024)
+#define TOOL_OUTPUT_SIZE  MIMI_TOOL_OUTPUT_SIZE
 
 /* Build the assistant content array from llm_response_t for the messages history.
  * Returns a cJSON array with text and tool_use blocks. */
@@ -52,25 +54,30 @@ static cJSON *build_assistant_content(const llm_response_t *resp)
     return content;
 }
 
-/* Build the user message with tool_result blocks */
-static cJSON *build_tool_results(const llm_response_t *resp, char *tool_output, size_t tool_output_size)
+/* Build the user message with tool_result blocks.
+ * tool_output holds one TOOL_OUTPUT_SIZE slot per call. */
+static cJSON *build_tool_results(const llm_response_t *resp, char *tool_output)
 {
-    cJSON *content = cJSON_CreateArray();
-
+    /* Execute tools (parallel-safe calls run concurrently) */
+    tool_job_t jobs[MIMI_MAX_TOOL_CALLS];
     for (int i = 0; i < resp->call_count; i++) {
-        const llm_tool_call_t *call = &resp->calls[i];
-
-        /* Execute tool */
-        tool_output[0] = '\0';
-        tool_registry_execute(call->name, call->input, tool_output, tool_output_size);
+        jobs[i] = (tool_job_t){
+            .name        = resp->calls[i].name,
+            .input       = resp->calls[i].input,
+            .output      = tool_output + i * TOOL_OUTPUT_SIZE,
+            .output_size = TOOL_OUTPUT_SIZE,
+        };
+    }
+    tool_pool_run(jobs, resp->call_count);
 
-        ESP_LOGI(TAG, "Tool %s result: %d bytes", call->name, (int)strlen(tool_output));
+    cJSON *content = cJSON_CreateArray();
 
+    for (int i = 0; i < resp->call_count; i++) {
         /* Build tool_result block */
         cJSON *result_block = cJSON_CreateObject();
         cJSON_AddStringToObject(result_block, "type", "tool_result");
-        cJSON_AddStringToObject(result_block, "tool_use_id", call->id);
-        cJSON_AddStringToObject(result_block, "content", tool_output);
+        cJSON_AddStringToObject(result_block, "tool_use_id", resp->calls[i].id);
+        cJSON_AddStringToObject(result_block, "content", jobs[i].output);
         cJSON_AddItemToArray(content, result_block);
     }
 
@@ -84,7 +91,7 @@ static void agent_loop_task(void *arg)
     /* Allocate large buffers from PSRAM */
     char *system_prompt = heap_caps_calloc(1, MIMI_CONTEXT_BUF_SIZE, MALLOC_CAP_SPIRAM);
     char *history_json = heap_caps_calloc(1, MIMI_LLM_STREAM_BUF_SIZE, MALLOC_CAP_SPIRAM);
-    char *tool_output = heap_caps_calloc(1, TOOL_OUTPUT_SIZE, MALLOC_CAP_SPIRAM);
+    char *tool_output = heap_caps_calloc(MIMI_MAX_TOOL_CALLS, TOOL_OUTPUT_SIZE, MALLOC_CAP_SPIRAM);
 
     if (!system_prompt || !history_json || !tool_output) {
         ESP_LOGE(TAG, "Failed to allocate PSRAM buffers");
@@ -98,6 +105,7 @@ static void agent_loop_task(void *arg)
         mimi_msg_t msg;
         esp_err_t err = message_bus_pop_inbound(&msg, UINT32_MAX);
         if (err != ESP_OK) continue;
+        int64_t started_us = esp_timer_get_time();
 
         ESP_LOGI(TAG, "Processing message from %s:%s", msg.channel, msg.chat_id);
 
@@ -117,11 +125,14 @@ static void agent_loop_task(void *arg)
         cJSON_AddStringToObject(user_msg, "content", msg.content);
         cJSON_AddItemToArray(messages, user_msg);
 
+        /* Serialize system prompt, tools and history once for all iterations */
+        llm_conv_t *conv = llm_conv_create(system_prompt, tools_json, messages);
+
         /* 4. ReAct loop */
         char *final_text = NULL;
         int iteration = 0;
 
-        while (iteration < MIMI_AGENT_MAX_TOOL_ITER) {
+        while (conv && iteration < MIMI_AGENT_MAX_TOOL_ITER) {
             /* Send "working" indicator before each API call */
             {
                 static const char *working_phrases[] = {
@@ -135,12 +146,14 @@ static void agent_loop_task(void *arg)
                 mimi_msg_t status = {0};
                 strncpy(status.channel, msg.channel, sizeof(status.channel) - 1);
                 strncpy(status.chat_id, msg.chat_id, sizeof(status.chat_id) - 1);
-                status.content = strdup(working_phrases[esp_random() % phrase_count]);
-                if (status.content) message_bus_push_outbound(&status);
+                status.content = msg_text_dup(working_phrases[esp_random() % phrase_count]);
+                if (status.content && message_bus_push_outbound(&status) != ESP_OK) {
+                    msg_text_unref(status.content);
+                }
             }
 
             llm_response_t resp;
-            err = llm_chat_tools(system_prompt, messages, tools_json, &resp);
+            err = llm_conv_chat(conv, &resp);
 
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "LLM call failed: %s", esp_err_to_name(err));
@@ -150,7 +163,7 @@ static void agent_loop_task(void *arg)
             if (!resp.tool_use) {
                 /* Normal completion — save final text and break */
                 if (resp.text && resp.text_len > 0) {
-                    final_text = strdup(resp.text);
+                    final_text = msg_text_new(resp.text, resp.text_len);
                 }
                 llm_response_free(&resp);
                 break;
@@ -162,20 +175,20 @@ static void agent_loop_task(void *arg)
             cJSON *asst_msg = cJSON_CreateObject();
             cJSON_AddStringToObject(asst_msg, "role", "assistant");
             cJSON_AddItemToObject(asst_msg, "content", build_assistant_content(&resp));
-            cJSON_AddItemToArray(messages, asst_msg);
+            llm_conv_append(conv, asst_msg);
 
             /* Execute tools and append results */
-            cJSON *tool_results = build_tool_results(&resp, tool_output, TOOL_OUTPUT_SIZE);
+            cJSON *tool_results = build_tool_results(&resp, tool_output);
             cJSON *result_msg = cJSON_CreateObject();
             cJSON_AddStringToObject(result_msg, "role", "user");
             cJSON_AddItemToObject(result_msg, "content", tool_results);
-            cJSON_AddItemToArray(messages, result_msg);
+            llm_conv_append(conv, result_msg);
 
             llm_response_free(&resp);
             iteration++;
         }
 
-        cJSON_Delete(messages);
+        llm_conv_free(conv);
 
         /* 5. Send response */
         if (final_text && final_text[0]) {
@@ -187,22 +200,25 @@ static void agent_loop_task(void *arg)
             mimi_msg_t out = {0};
             strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
             strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
-            out.content = final_text;  /* transfer ownership */
-            message_bus_push_outbound(&out);
+            out.content = final_text;  /* transfer our reference */
+            if (message_bus_push_outbound(&out) != ESP_OK) {
+                msg_text_unref(out.content);
+            }
         } else {
             /* Error or empty response */
-            free(final_text);
+            msg_text_unref(final_text);
             mimi_msg_t out = {0};
             strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
             strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
-            out.content = strdup("Sorry, I encountered an error.");
-            if (out.content) {
-                message_bus_push_outbound(&out);
+            out.content = msg_text_dup("Sorry, I encountered an error.");
+            if (out.content && message_bus_push_outbound(&out) != ESP_OK) {
+                msg_text_unref(out.content);
             }
         }
 
         /* Free inbound message content */
-        free(msg.content);
+        msg_text_unref(msg.content);
+        message_bus_turn_done((uint32_t)((esp_timer_get_time() - started_us) / 1000));
 
         /* Log memory status */
         ESP_LOGI(TAG, "Free PSRAM: %d bytes",
@@ -1,18 +1,33 @@
 #include "atom_context.h"
 #include "atom_config.h"
+#include "llm/llm_proxy.h"
+#include "memory/memory_store.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 
 static const char *TAG = "atom_ctx";
 
+/* Everything before LLM_SYSTEM_CACHE_BREAK, rebuilt only when
+ * memory_generation() moves. Shared by all agent workers. */
+static char             *s_static     = NULL;
+static size_t            s_static_len = 0;
+static uint32_t          s_static_gen = 0;
+static bool              s_static_ok  = false;
+static SemaphoreHandle_t s_static_lock = NULL;
+
 /* ── Append a file's content to a buffer ────────────────────────────── */
 
+/* limit caps the bytes read from the file (0 = rest of buf). */
 static size_t append_file(char *buf, size_t size, size_t offset,
-                           const char *path, const char *header)
+                           const char *path, const char *header, size_t limit)
 {
     FILE *f = fopen(path, "r");
     if (!f) return offset;
@@ -21,7 +36,9 @@ static size_t append_file(char *buf, size_t size, size_t offset,
         offset += snprintf(buf + offset, size - offset, "\n## %s\n\n", header);
     }
 
-    size_t n = fread(buf + offset, 1, size - offset - 1, f);
+    size_t max = size - offset - 1;
+    if (limit && limit < max) max = limit;
+    size_t n = fread(buf + offset, 1, max, f);
     offset += n;
     if (offset < size) buf[offset] = '\0';
     fclose(f);
@@ -30,7 +47,8 @@ static size_t append_file(char *buf, size_t size, size_t offset,
 
 /* ── System prompt ───────────────────────────────────────────────────── */
 
-esp_err_t atom_context_build_system(char *buf, size_t size, const char *cf_summary)
+/* Identity, SOUL.md, USER.md and MEMORY.md: the stable prompt prefix. */
+static size_t build_static(char *buf, size_t size)
 {
     size_t off = 0;
 
@@ -51,26 +69,56 @@ esp_err_t atom_context_build_system(char *buf, size_t size, const char *cf_summa
         "Keep MEMORY.md under 4KB.\n\n");
 
     /* SOUL.md */
-    off = append_file(buf, size, off, ATOM_SOUL_FILE, "Personality");
+    off = append_file(buf, size, off, ATOM_SOUL_FILE, "Personality", 0);
 
     /* USER.md */
-    off = append_file(buf, size, off, ATOM_USER_FILE, "User Profile");
-
-    /* MEMORY.md (max 4KB) */
-    {
-        FILE *f = fopen(ATOM_MEMORY_FILE, "r");
-        if (f) {
-            char mem[ATOM_MEMORY_MAX_BYTES];
-            size_t n = fread(mem, 1, sizeof(mem) - 1, f);
-            mem[n] = '\0';
-            fclose(f);
-            if (n > 0) {
-                off += snprintf(buf + off, size - off,
-                                "\n## Long-term Memory\n\n%s\n", mem);
-            }
+    off = append_file(buf, size, off, ATOM_USER_FILE, "User Profile", 0);
+
+    /* MEMORY.md (max 4KB), read straight into place */
+    off = append_file(buf, size, off, ATOM_MEMORY_FILE, "Long-term Memory",
+                      ATOM_MEMORY_MAX_BYTES - 1);
+    return off;
+}
+
+esp_err_t atom_context_init(void)
+{
+    s_static_lock = xSemaphoreCreateMutex();
+    s_static = heap_caps_malloc(ATOM_CONTEXT_BUF_SIZE, MALLOC_CAP_SPIRAM);
+    if (!s_static) s_static = malloc(ATOM_CONTEXT_BUF_SIZE);
+    if (!s_static_lock || !s_static) {
+        /* Not fatal: every prompt is then built from flash */
+        ESP_LOGW(TAG, "Prompt cache unavailable");
+    }
+    return ESP_OK;
+}
+
+esp_err_t atom_context_build_system(char *buf, size_t size, const char *cf_summary)
+{
+    size_t off = 0;
+
+    /* Sections above the break change rarely and form the cached prefix;
+     * serve them from RAM unless a memory write moved the generation. */
+    if (s_static_lock && s_static) {
+        xSemaphoreTake(s_static_lock, portMAX_DELAY);
+        uint32_t gen = memory_generation();
+        if (!s_static_ok || gen != s_static_gen) {
+            s_static_len = build_static(s_static, ATOM_CONTEXT_BUF_SIZE);
+            s_static_gen = gen;
+            s_static_ok  = true;
+            ESP_LOGI(TAG, "Static prompt rebuilt: %d bytes (gen %u)",
+                     (int)s_static_len, (unsigned)gen);
         }
+        off = s_static_len < size ? s_static_len : size - 1;
+        memcpy(buf, s_static, off);
+        buf[off] = '\0';
+        xSemaphoreGive(s_static_lock);
+    } else {
+        off = build_static(buf, size);
     }
 
+    /* Everything after the break may differ per turn. */
+    off += snprintf(buf + off, size - off, "%s", LLM_SYSTEM_CACHE_BREAK);
+
     /* Cloudflare summary (cloud conversation history) */
     if (cf_summary && cf_summary[0]) {
         off += snprintf(buf + off, size - off,
@@ -101,7 +149,7 @@ esp_err_t atom_context_build_messages(const char *history_json,
     if (json_str) {
         strncpy(buf, json_str, size - 1);
         buf[size - 1] = '\0';
-        free(json_str);
+        cJSON_free(json_str);
     } else {
         snprintf(buf, size, "[{\"role\":\"user\",\"content\":\"%s\"}]", user_message);
     }
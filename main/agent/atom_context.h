@@ -15,11 +15,21 @@
  *   4. MEMORY.md    (long-term memory, max 4KB)
  *   5. CF summary   (cloud conversation summary, optional)
  *
+ * Sections are ordered from most to least stable. 1–4 are separated from
+ * 5 by LLM_SYSTEM_CACHE_BREAK so the prefix can be prompt-cached. The same
+ * prefix is kept in PSRAM and only re-read from SPIFFS when
+ * memory_generation() changes.
+ *
  * The conversation messages array is built from:
  *   - Recent history JSON (from atom_session)
  *   - Current user message appended at the end
  */
 
+/**
+ * Allocate the static prompt cache. Call once before the agent workers start.
+ */
+esp_err_t atom_context_init(void);
+
 /**
  * Build the system prompt.
  *
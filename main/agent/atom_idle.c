@@ -0,0 +1,71 @@
+#include "atom_idle.h"
+#include "atom_config.h"
+#include "bus/message_bus.h"
+#include "llm/llm_proxy.h"
+
+#include <stdbool.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+
+static const char *TAG = "atom_idle";
+
+typedef struct {
+    atom_idle_fn_t fn;
+    void          *arg;
+} idle_job_t;
+
+static QueueHandle_t s_queue = NULL;
+
+static bool system_idle(void)
+{
+    return message_bus_inbound_waiting() == 0
+        && llm_inflight() <= ATOM_IDLE_MAX_LLM_INFLIGHT;
+}
+
+static void idle_task(void *arg)
+{
+    idle_job_t job;
+    while (1) {
+        if (xQueueReceive(s_queue, &job, portMAX_DELAY) != pdTRUE) continue;
+
+        /* Wait for a quiet moment; interactive work always goes first */
+        while (!system_idle()) {
+            vTaskDelay(pdMS_TO_TICKS(ATOM_IDLE_POLL_MS));
+        }
+        job.fn(job.arg);
+        ESP_LOGD(TAG, "Job done, stack headroom %u bytes",
+                 (unsigned)uxTaskGetStackHighWaterMark(NULL));
+    }
+}
+
+esp_err_t atom_idle_init(void)
+{
+    s_queue = xQueueCreate(ATOM_IDLE_QUEUE_LEN, sizeof(idle_job_t));
+    if (!s_queue) {
+        ESP_LOGE(TAG, "Failed to create job queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (xTaskCreatePinnedToCore(idle_task, "atom_idle", ATOM_IDLE_STACK, NULL,
+                                ATOM_IDLE_PRIO, NULL, ATOM_IDLE_CORE) != pdPASS) {
+        vQueueDelete(s_queue);
+        s_queue = NULL;
+        ESP_LOGE(TAG, "Failed to create idle task");
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Idle job scheduler started");
+    return ESP_OK;
+}
+
+esp_err_t atom_idle_submit(atom_idle_fn_t fn, void *arg)
+{
+    idle_job_t job = { .fn = fn, .arg = arg };
+    if (!s_queue || xQueueSend(s_queue, &job, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Idle queue full, dropping job");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "esp_err.h"
+
+/**
+ * atom_idle.h
+ *
+ * AtomClaw: idle-time background job scheduler.
+ *
+ * Work that does not have to finish before the user gets a reply (CF
+ * summary generation, other maintenance) is queued here instead of running
+ * inline in an agent worker. One low-priority task runs the jobs one at a
+ * time, and only starts the next job while the inbound bus is empty and no
+ * more than ATOM_IDLE_MAX_LLM_INFLIGHT LLM requests are in flight, so a
+ * background LLM call never delays an interactive one.
+ */
+
+/** Job body. Owns arg and must free it. */
+typedef void (*atom_idle_fn_t)(void *arg);
+
+/**
+ * Create the job queue and start the background task.
+ */
+esp_err_t atom_idle_init(void);
+
+/**
+ * Queue a job. Does not block.
+ *
+ * @return ESP_OK if queued (fn will free arg), ESP_ERR_NO_MEM if the queue
+ *         is full or not initialized (caller still owns arg).
+ */
+esp_err_t atom_idle_submit(atom_idle_fn_t fn, void *arg);
@@ -0,0 +1,244 @@
+#include "atom_json_arena.h"
+#include "atom_config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "cJSON.h"
+
+static const char *TAG = "json_arena";
+
+typedef struct {
+    TaskHandle_t owner;       /* only written by the owner itself */
+    uint8_t     *base;
+    size_t       used;
+} arena_t;
+
+static arena_t  s_arenas[ATOM_JSON_ARENA_SLOTS];
+static SemaphoreHandle_t s_slot_lock = NULL;   /* attach / detach */
+static TaskHandle_t s_passthrough = NULL;      /* soak baseline: stock malloc */
+static uint32_t s_requests    = 0;
+static uint32_t s_spills      = 0;
+static size_t   s_peak        = 0;
+
+static arena_t *own_arena(void)
+{
+    TaskHandle_t me = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < ATOM_JSON_ARENA_SLOTS; i++) {
+        if (s_arenas[i].owner == me) return &s_arenas[i];
+    }
+    return NULL;
+}
+
+static void *json_malloc(size_t size)
+{
+    if (s_passthrough && s_passthrough == xTaskGetCurrentTaskHandle()) {
+        return malloc(size);
+    }
+
+    arena_t *a = own_arena();
+    if (a) {
+        size_t need = (size + 7) & ~(size_t)7;
+        if (a->used + need <= ATOM_JSON_ARENA_BYTES) {
+            void *p = a->base + a->used;
+            a->used += need;
+            return p;
+        }
+        __atomic_add_fetch(&s_spills, 1, __ATOMIC_RELAXED);
+    }
+
+    void *p = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    return p ? p : malloc(size);
+}
+
+static void json_free(void *p)
+{
+    if (!p) return;
+    for (int i = 0; i < ATOM_JSON_ARENA_SLOTS; i++) {
+        uint8_t *base = s_arenas[i].base;
+        if (base && (uint8_t *)p >= base && (uint8_t *)p < base + ATOM_JSON_ARENA_BYTES) {
+            return;     /* released by atom_json_arena_reset() */
+        }
+    }
+    free(p);
+}
+
+esp_err_t atom_json_arena_init(void)
+{
+    s_slot_lock = xSemaphoreCreateMutex();
+    if (!s_slot_lock) return ESP_ERR_NO_MEM;
+
+    cJSON_Hooks hooks = {
+        .malloc_fn = json_malloc,
+        .free_fn   = json_free,
+    };
+    cJSON_InitHooks(&hooks);
+    ESP_LOGI(TAG, "cJSON hooks installed (%d x %d KB arenas)",
+             ATOM_JSON_ARENA_SLOTS, ATOM_JSON_ARENA_BYTES / 1024);
+    return ESP_OK;
+}
+
+esp_err_t atom_json_arena_attach(void)
+{
+    if (own_arena()) return ESP_OK;
+
+    uint8_t *base = heap_caps_malloc(ATOM_JSON_ARENA_BYTES, MALLOC_CAP_SPIRAM);
+    if (!base) {
+        ESP_LOGW(TAG, "No PSRAM for an arena, cJSON uses the heap");
+        return ESP_ERR_NO_MEM;
+    }
+
+    xSemaphoreTake(s_slot_lock, portMAX_DELAY);
+    for (int i = 0; i < ATOM_JSON_ARENA_SLOTS; i++) {
+        arena_t *a = &s_arenas[i];
+        if (!a->owner) {
+            a->base  = base;
+            a->used  = 0;
+            a->owner = xTaskGetCurrentTaskHandle();
+            xSemaphoreGive(s_slot_lock);
+            return ESP_OK;
+        }
+    }
+    xSemaphoreGive(s_slot_lock);
+
+    ESP_LOGW(TAG, "All %d arena slots taken", ATOM_JSON_ARENA_SLOTS);
+    heap_caps_free(base);
+    return ESP_ERR_NO_MEM;
+}
+
+void atom_json_arena_detach(void)
+{
+    arena_t *a = own_arena();
+    if (!a) return;
+
+    xSemaphoreTake(s_slot_lock, portMAX_DELAY);
+    uint8_t *base = a->base;
+    a->owner = NULL;
+    a->base  = NULL;
+    a->used  = 0;
+    xSemaphoreGive(s_slot_lock);
+    heap_caps_free(base);
+}
+
+void atom_json_arena_reset(void)
+{
+    arena_t *a = own_arena();
+    if (!a) return;
+    if (a->used > s_peak) s_peak = a->used;
+    a->used = 0;
+    __atomic_add_fetch(&s_requests, 1, __ATOMIC_RELAXED);
+}
+
+void atom_json_arena_get_stats(atom_json_arena_stats_t *out)
+{
+    out->requests    = __atomic_load_n(&s_requests, __ATOMIC_RELAXED);
+    out->spills      = __atomic_load_n(&s_spills, __ATOMIC_RELAXED);
+    out->peak_used   = s_peak;
+    out->arena_bytes = ATOM_JSON_ARENA_BYTES;
+}
+
+/* ── Soak benchmark ──────────────────────────────────────────────────── */
+
+#define SOAK_HISTORY   6
+#define SOAK_KEEP      3      /* long-lived strings held across turns */
+
+/* One synthetic agent turn: history + tool round trip + printed body. */
+static void soak_turn(int n, char **keep)
+{
+    static const char *reply =
+        "{\"id\":\"msg_01\",\"type\":\"message\",\"role\":\"assistant\","
+        "\"content\":[{\"type\":\"text\",\"text\":\"Let me check.\"},"
+        "{\"type\":\"tool_use\",\"id\":\"toolu_01\",\"name\":\"web_search\","
+        "\"input\":{\"query\":\"weather tokyo tomorrow\"}}],"
+        "\"stop_reason\":\"tool_use\",\"usage\":{\"input_tokens\":812,\"output_tokens\":64}}";
+    char text[200];
+
+    cJSON *messages = cJSON_CreateArray();
+    for (int i = 0; i < SOAK_HISTORY; i++) {
+        snprintf(text, sizeof(text), "turn %d message %d: %.*s", n, i,
+                 (n * 7 + i * 13) % 120, "lorem ipsum dolor sit amet, consectetur "
+                 "adipiscing elit, sed do eiusmod tempor incididunt ut labore et "
+                 "dolore magna aliqua. ut enim ad minim veniam, quis nostrud");
+        cJSON *m = cJSON_CreateObject();
+        cJSON_AddStringToObject(m, "role", (i & 1) ? "assistant" : "user");
+        cJSON_AddStringToObject(m, "content", text);
+        cJSON_AddItemToArray(messages, m);
+    }
+
+    cJSON *resp = cJSON_Parse(reply);
+    cJSON *content = cJSON_GetObjectItem(resp, "content");
+    cJSON *asst = cJSON_CreateObject();
+    cJSON_AddStringToObject(asst, "role", "assistant");
+    cJSON_AddItemToObject(asst, "content", cJSON_Duplicate(content, true));
+    cJSON_AddItemToArray(messages, asst);
+
+    cJSON *result = cJSON_CreateObject();
+    cJSON_AddStringToObject(result, "type", "tool_result");
+    cJSON_AddStringToObject(result, "tool_use_id", "toolu_01");
+    cJSON_AddStringToObject(result, "content", text);
+    cJSON *user = cJSON_CreateObject();
+    cJSON_AddStringToObject(user, "role", "user");
+    cJSON *arr = cJSON_AddArrayToObject(user, "content");
+    cJSON_AddItemToArray(arr, result);
+    cJSON_AddItemToArray(messages, user);
+
+    char *body = cJSON_PrintUnformatted(messages);
+
+    /* Something outlives the turn, as bus messages and session copies do */
+    free(keep[n % SOAK_KEEP]);
+    keep[n % SOAK_KEEP] = body ? strndup(body, 64 + n % 96) : NULL;
+
+    cJSON_free(body);
+    cJSON_Delete(resp);
+    cJSON_Delete(messages);
+}
+
+static void soak_sample(atom_json_soak_t *out, int i)
+{
+    out->heap_free[i]    = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    out->heap_largest[i] = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+    out->frag_pct[i]     = out->heap_free[i]
+        ? 100 - (int)(out->heap_largest[i] * 100 / out->heap_free[i]) : 0;
+}
+
+esp_err_t atom_json_arena_soak(int turns, atom_json_soak_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (turns <= 0) return ESP_ERR_INVALID_ARG;
+    out->turns = turns;
+
+    char *keep[SOAK_KEEP] = {0};
+
+    /* Run 0: stock allocator for this task's cJSON calls */
+    s_passthrough = xTaskGetCurrentTaskHandle();
+    int64_t t0 = esp_timer_get_time();
+    for (int n = 0; n < turns; n++) soak_turn(n, keep);
+    out->elapsed_us[0] = esp_timer_get_time() - t0;
+    s_passthrough = NULL;
+    soak_sample(out, 0);
+
+    /* Run 1: per-request arena, reset after every turn */
+    bool attached = own_arena() == NULL;
+    if (attached && atom_json_arena_attach() != ESP_OK) {
+        for (int i = 0; i < SOAK_KEEP; i++) free(keep[i]);
+        return ESP_ERR_NO_MEM;
+    }
+    t0 = esp_timer_get_time();
+    for (int n = 0; n < turns; n++) {
+        soak_turn(n, keep);
+        atom_json_arena_reset();
+    }
+    out->elapsed_us[1] = esp_timer_get_time() - t0;
+    soak_sample(out, 1);
+    if (attached) atom_json_arena_detach();
+
+    for (int i = 0; i < SOAK_KEEP; i++) free(keep[i]);
+    return ESP_OK;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * atom_json_arena.h
+ *
+ * AtomClaw: cJSON allocator hooks.
+ *
+ * cJSON_InitHooks is process-wide, so allocations are routed by the calling
+ * task. A task that has attached an arena (the agent workers) gets cJSON
+ * memory from its own PSRAM bump arena, and the whole request is released
+ * with one atom_json_arena_reset() instead of hundreds of small frees on
+ * the internal heap that TLS needs. Every other task, and a request that
+ * outgrows its arena, gets PSRAM heap memory.
+ *
+ * Freeing is by address: arena pointers are ignored, anything else goes to
+ * free(), so trees may be freed from any task. cJSON_Print* results must
+ * be released with cJSON_free(), never free().
+ */
+
+typedef struct {
+    uint32_t requests;        /* resets so far */
+    uint32_t spills;          /* allocations that did not fit an arena */
+    size_t   peak_used;       /* largest arena use by one request */
+    size_t   arena_bytes;     /* size of each arena */
+} atom_json_arena_stats_t;
+
+typedef struct {
+    int    turns;
+    /* Internal heap after the stock-malloc run and after the arena run */
+    size_t heap_free[2];
+    size_t heap_largest[2];
+    int    frag_pct[2];       /* 100 - largest block * 100 / free */
+    int64_t elapsed_us[2];
+} atom_json_soak_t;
+
+/**
+ * Install the cJSON hooks. Call once at boot before other tasks use cJSON.
+ */
+esp_err_t atom_json_arena_init(void);
+
+/**
+ * Give the calling task an arena for the rest of its life.
+ * @return ESP_ERR_NO_MEM if no slot or PSRAM is left (task uses the heap).
+ */
+esp_err_t atom_json_arena_attach(void);
+
+/**
+ * Release the calling task's arena slot and its memory.
+ */
+void atom_json_arena_detach(void);
+
+/**
+ * End of request: drop everything the calling task allocated from its
+ * arena. No cJSON tree or string from the request may be used afterwards.
+ */
+void atom_json_arena_reset(void);
+
+void atom_json_arena_get_stats(atom_json_arena_stats_t *out);
+
+/**
+ * Soak benchmark: run `turns` synthetic agent turns (history, tool calls,
+ * parsed responses, printed bodies, with long-lived allocations interleaved)
+ * first on the stock allocator and then through an arena on the calling
+ * task, and report internal heap fragmentation after each run.
+ */
+esp_err_t atom_json_arena_soak(int turns, atom_json_soak_t *out);
@@ -1,14 +1,25 @@
 #include "context_builder.h"
 #include "mimi_config.h"
 #include "memory/memory_store.h"
+#include "llm/llm_proxy.h"
 
 #include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
+#include <time.h>
 #include "esp_log.h"
+#include "esp_heap_caps.h"
 #include "cJSON.h"
 
 static const char *TAG = "context";
 
+/* Last built prompt. It depends only on the prompt files and, through the
+ * daily notes, on the date, so it is reused until either changes. */
+static char    *s_cache     = NULL;
+static size_t   s_cache_len = 0;
+static uint32_t s_cache_gen = 0;
+static int      s_cache_day = -1;
+
 static size_t append_file(char *buf, size_t size, size_t offset, const char *path, const char *header)
 {
     FILE *f = fopen(path, "r");
@@ -25,7 +36,22 @@ static size_t append_file(char *buf, size_t size, size_t offset, const char *pat
     return offset;
 }
 
-esp_err_t context_build_system_prompt(char *buf, size_t size)
+static int today(void)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    return tm.tm_year * 366 + tm.tm_yday;
+}
+
+/* Room for a memory section at off: at most 4 KB, leaving space for "\n". */
+static size_t section_cap(size_t size, size_t off)
+{
+    size_t room = size - off - 1;
+    return room < 4096 ? room : 4096;
+}
+
+static size_t build_prompt(char *buf, size_t size)
 {
     size_t off = 0;
 
@@ -61,16 +87,55 @@ esp_err_t context_build_system_prompt(char *buf, size_t size)
     off = append_file(buf, size, off, MIMI_SOUL_FILE, "Personality");
     off = append_file(buf, size, off, MIMI_USER_FILE, "User Info");
 
-    /* Long-term memory */
-    char mem_buf[4096];
-    if (memory_read_long_term(mem_buf, sizeof(mem_buf)) == ESP_OK && mem_buf[0]) {
-        off += snprintf(buf + off, size - off, "\n## Long-term Memory\n\n%s\n", mem_buf);
+    /* Long-term memory, read straight into place */
+    size_t hdr = off;
+    off += snprintf(buf + off, size - off, "\n## Long-term Memory\n\n");
+    if (off < size - 1 && memory_read_long_term(buf + off, section_cap(size, off)) == ESP_OK && buf[off]) {
+        off += strlen(buf + off);
+        off += snprintf(buf + off, size - off, "\n");
+    } else {
+        off = hdr;
+        buf[off] = '\0';
     }
 
+    /* Stable prefix ends here (prompt cache); daily notes change often */
+    off += snprintf(buf + off, size - off, "%s", LLM_SYSTEM_CACHE_BREAK);
+
     /* Recent daily notes (last 3 days) */
-    char recent_buf[4096];
-    if (memory_read_recent(recent_buf, sizeof(recent_buf), 3) == ESP_OK && recent_buf[0]) {
-        off += snprintf(buf + off, size - off, "\n## Recent Notes\n\n%s\n", recent_buf);
+    hdr = off;
+    off += snprintf(buf + off, size - off, "\n## Recent Notes\n\n");
+    if (off < size - 1 && memory_read_recent(buf + off, section_cap(size, off), 3) == ESP_OK && buf[off]) {
+        off += strlen(buf + off);
+        off += snprintf(buf + off, size - off, "\n");
+    } else {
+        off = hdr;
+        buf[off] = '\0';
+    }
+    return off;
+}
+
+esp_err_t context_build_system_prompt(char *buf, size_t size)
+{
+    uint32_t gen = memory_generation();
+    int day = today();
+
+    if (s_cache && s_cache_gen == gen && s_cache_day == day && s_cache_len < size) {
+        memcpy(buf, s_cache, s_cache_len + 1);
+        ESP_LOGI(TAG, "System prompt cached: %d bytes", (int)s_cache_len);
+        return ESP_OK;
+    }
+
+    size_t off = build_prompt(buf, size);
+
+    if (!s_cache) {
+        s_cache = heap_caps_malloc(MIMI_CONTEXT_BUF_SIZE, MALLOC_CAP_SPIRAM);
+        if (!s_cache) s_cache = malloc(MIMI_CONTEXT_BUF_SIZE);
+    }
+    if (s_cache && off < MIMI_CONTEXT_BUF_SIZE) {
+        memcpy(s_cache, buf, off + 1);
+        s_cache_len = off;
+        s_cache_gen = gen;
+        s_cache_day = day;
     }
 
     ESP_LOGI(TAG, "System prompt built: %d bytes", (int)off);
@@ -99,7 +164,7 @@ esp_err_t context_build_messages(const char *history_json, const char *user_mess
     if (json_str) {
         strncpy(buf, json_str, size - 1);
         buf[size - 1] = '\0';
-        free(json_str);
+        cJSON_free(json_str);
     } else {
         snprintf(buf, size, "[{\"role\":\"user\",\"content\":\"%s\"}]", user_message);
     }
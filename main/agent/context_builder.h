@@ -6,6 +6,8 @@
 /**
  * Build the system prompt from bootstrap files (SOUL.md, USER.md)
  * and memory context (MEMORY.md + recent daily notes).
+ * The result is cached in PSRAM and reused until memory_generation()
+ * changes or the date rolls over.
  *
  * @param buf   Output buffer (caller allocates, recommend MIMI_CONTEXT_BUF_SIZE)
  * @param size  Buffer size
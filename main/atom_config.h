@@ -95,18 +95,62 @@
 #define ATOM_DISCORD_MAX_RESP_LEN       1900
 /* Deferred response timeout: must respond within 3 seconds */
 #define ATOM_DISCORD_DEFER_TIMEOUT_MS   2500
+/* Interaction token lifetime is 15 min; keep a margin for the follow-up call */
+#define ATOM_DISCORD_REPLY_DEADLINE_MS  (14 * 60 * 1000)
 
 /* LINE webhook endpoint */
 #define ATOM_LINE_WEBHOOK_PATH          "/line/webhook"
 /* Development fallback: skip LINE signature verification. */
 #define ATOM_LINE_SKIP_SIGNATURE_VERIFY 1
+/* replyToken expires about a minute after the event; past this, push instead */
+#define ATOM_LINE_REPLY_DEADLINE_MS     (50 * 1000)
+
+/* Admission control: when the predicted time to a reply exceeds these, the
+ * webhook answers "busy, try again in N s" right away instead of queueing */
+#define ATOM_DISCORD_ADMIT_MAX_MS       (60 * 1000)
+#define ATOM_LINE_ADMIT_MAX_MS          (40 * 1000)
+#define ATOM_ADMIT_MIN_RETRY_S          10
 
 /* ── Agent Loop ── */
 #define ATOM_AGENT_STACK                (16 * 1024)
 #define ATOM_AGENT_PRIO                 6
 #define ATOM_AGENT_CORE                 1
+/* Agent workers: different users run concurrently, one user stays in order.
+ * Each worker has its own stack + PSRAM buffers (~45KB) */
+#define ATOM_AGENT_WORKERS              2
+/* Per-worker backlog for a user who sends while their turn is running */
+#define ATOM_AGENT_WORKER_QUEUE_LEN     4
+#define ATOM_AGENT_DISPATCH_STACK       (4 * 1024)
 #define ATOM_AGENT_MAX_TOOL_ITER        5
 #define ATOM_MAX_TOOL_CALLS             4
+/* Per-call tool result buffer */
+#define ATOM_TOOL_OUTPUT_SIZE           (8 * 1024)
+
+/* ── cJSON arena ── */
+/* cJSON allocations of an agent request come from a per-worker PSRAM bump
+ * arena, released in one step when the request ends. Requests that outgrow
+ * it spill to the PSRAM heap. One extra slot serves the json_arena soak. */
+#define ATOM_JSON_ARENA_BYTES           (64 * 1024)
+#define ATOM_JSON_ARENA_SLOTS           (ATOM_AGENT_WORKERS + 1)
+
+/* ── Idle-time background jobs ── */
+/* Deferred maintenance (CF summarization) run by one low-priority task.
+ * Summarization is a full LLM request (TLS, proxy read buffers), so the
+ * stack matches the agent workers that made that call before. */
+#define ATOM_IDLE_STACK                 ATOM_AGENT_STACK
+#define ATOM_IDLE_PRIO                  2
+#define ATOM_IDLE_CORE                  1
+#define ATOM_IDLE_QUEUE_LEN             4
+/* Start a job only while the inbound bus is empty and at most this many
+ * LLM requests are in flight (0 = never alongside an interactive call) */
+#define ATOM_IDLE_MAX_LLM_INFLIGHT      0
+#define ATOM_IDLE_POLL_MS               500
+
+/* ── Tool worker pool ── */
+/* Parallel-safe tool calls of one turn run on these workers (0 = sequential) */
+#define ATOM_TOOL_WORKERS               2
+#define ATOM_TOOL_WORKER_STACK          (8 * 1024)
+#define ATOM_TOOL_WORKER_PRIO           5
 /* Max LLM send tokens target */
 #define ATOM_LLM_MAX_TOKENS             1024
 
@@ -117,9 +161,18 @@
 #define ATOM_OPENAI_API_URL             "https://api.openai.com/v1/chat/completions"
 #define ATOM_LLM_API_VERSION            "2023-06-01"
 #define ATOM_LLM_STREAM_BUF_SIZE        (12 * 1024)
+/* 1 = request "stream": true and parse SSE deltas as they arrive */
+#define ATOM_LLM_USE_STREAM             1
+/* Keep-alive pool: drop pooled LLM connections idle longer than this */
+#define ATOM_LLM_KEEPALIVE_IDLE_MS      (30 * 1000)
 
 /* ── Message Bus ── */
-#define ATOM_BUS_QUEUE_LEN              4
+/* Message slots per direction, pooled in PSRAM (bursts wait up to 1 s) */
+#define ATOM_BUS_QUEUE_LEN              32
+/* Merge a user's follow-ups sent within this window into one LLM turn
+ * (0 = off). The hold never exceeds _MAX_MS from the first message. */
+#define ATOM_BUS_COALESCE_MS            1500
+#define ATOM_BUS_COALESCE_MAX_MS        4000
 #define ATOM_OUTBOUND_STACK             (8 * 1024)
 #define ATOM_OUTBOUND_PRIO              5
 #define ATOM_OUTBOUND_CORE              0
@@ -136,19 +189,57 @@
 /* System prompt buffer size */
 #define ATOM_CONTEXT_BUF_SIZE           (12 * 1024)
 
-/* ── Session Ring Buffer ── */
-/* 3 exchanges = 6 messages (user + assistant per exchange) */
-#define ATOM_SESSION_MAX_EXCHANGES      3
-#define ATOM_SESSION_MAX_MSGS           (ATOM_SESSION_MAX_EXCHANGES * 2)
-/* Max chars per stored message */
-#define ATOM_SESSION_MSG_MAX_LEN        512
+/* ── Session History ── */
+/* Per-user byte budget; messages are stored at their real length and
+ * the oldest are dropped when it is exceeded (4 bytes overhead each) */
+#define ATOM_SESSION_USER_BYTES         3072
+/* Max bytes kept of a single message (cut on a UTF-8 boundary) */
+#define ATOM_SESSION_MSG_MAX_LEN        1024
+/* Session slots: share of free PSRAM at boot, clamped to [MIN, MAX].
+ * Without PSRAM, MIN slots in internal RAM. LRU eviction beyond that. */
+#define ATOM_SESSION_PSRAM_PCT          25
+#define ATOM_SESSION_MIN_USERS          8
+#define ATOM_SESSION_MAX_USERS          512
+/* Write-behind log: appends are buffered in RAM and written by a background
+ * task every FLUSH_MS or once FLUSH_BYTES are pending. The log is rewritten
+ * from RAM at boot and whenever it grows past LOG_MAX_BYTES. */
+#define ATOM_SESSION_LOG_FILE           "/spiffs/session.log"
+#define ATOM_SESSION_LOG_MAX_BYTES      (256 * 1024)
+#define ATOM_SESSION_LOG_BUF_BYTES      (16 * 1024)
+#define ATOM_SESSION_FLUSH_BYTES        (4 * 1024)
+#define ATOM_SESSION_FLUSH_MS           (10 * 1000)
+#define ATOM_SESSION_LOG_STACK          (4 * 1024)
+#define ATOM_SESSION_LOG_PRIO           2
 
 /* ── Cloudflare History ── */
 #define ATOM_CF_SUMMARY_PATH            "/summary"
-#define ATOM_CF_SAVE_PATH               "/save"
+#define ATOM_CF_SAVE_BATCH_PATH         "/save_batch"
+#define ATOM_CF_TURN_PATH               "/turn"
+/* Finished exchanges wait this long to ride along with the user's next
+ * /turn before the writer saves them on its own */
+#define ATOM_CF_TURN_STAGE_SLOTS        4
+#define ATOM_CF_TURN_HOLD_MS            (2 * 60 * 1000)
+/* Writer task: turns queued within the window go out in one request */
+#define ATOM_CF_SAVE_QUEUE_LEN          16
+#define ATOM_CF_SAVE_BATCH_MAX          8
+#define ATOM_CF_SAVE_BATCH_WINDOW_MS    300
+#define ATOM_CF_SAVE_STACK              (6 * 1024)
+#define ATOM_CF_SAVE_PRIO               3
 #define ATOM_CF_TIMEOUT_MS              5000
+/* Offline journal: writes the Worker did not accept, replayed oldest-first */
+#define ATOM_CF_JOURNAL_FILE            "/spiffs/cf_journal.jsonl"
+#define ATOM_CF_JOURNAL_MAX_BYTES       (32 * 1024)
+#define ATOM_CF_JOURNAL_MAX_TEXT        1500
+#define ATOM_CF_JOURNAL_LINE_MAX        4096
+/* Replay pacing: gap between successful batches, wait after a failure */
+#define ATOM_CF_JOURNAL_REPLAY_GAP_MS   2000
+#define ATOM_CF_JOURNAL_RETRY_MS        (30 * 1000)
 /* Max summary size */
 #define ATOM_CF_SUMMARY_MAX_LEN         2048
+/* Per-user summary cache: entries younger than the TTL skip the network,
+ * older ones are revalidated with If-None-Match */
+#define ATOM_CF_SUMMARY_CACHE_SLOTS     4
+#define ATOM_CF_SUMMARY_TTL_MS          (10 * 60 * 1000)
 
 /* ── Serial CLI ── */
 #define ATOM_CLI_STACK                  (4 * 1024)
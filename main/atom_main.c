@@ -4,10 +4,13 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_event.h"
 #include "esp_system.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "esp_spiffs.h"
 #include "esp_netif.h"
 #include "esp_wifi.h"
@@ -21,11 +24,14 @@
 #include "memory/memory_store.h"
 #include "memory/atom_session.h"
 #include "agent/atom_context.h"
+#include "agent/atom_json_arena.h"
+#include "agent/atom_idle.h"
 #include "cloudflare/cf_history.h"
 #include "discord/discord_server.h"
 #include "cli/serial_cli.h"
 #include "proxy/http_proxy.h"
 #include "tools/tool_registry.h"
+#include "tools/tool_pool.h"
 #include "rgb/rgb.h"
 #include "display/display.h"
 
@@ -178,34 +184,166 @@ static esp_err_t init_spiffs(void)
 
 /* ── AtomClaw Agent Loop ─────────────────────────────────────────────── */
 
-static void atom_agent_task(void *arg)
+#if ATOM_LLM_USE_STREAM
+typedef struct {
+    int64_t start_us;
+    bool    first_token;
+} stream_ctx_t;
+
+static void stream_on_text(const char *delta, size_t len, void *ctx)
 {
-    ESP_LOGI(TAG, "AtomClaw agent started on core %d", xPortGetCoreID());
-
-    /* Prefer PSRAM; fallback to internal RAM so ATOMS3 (no PSRAM) can still run. */
-    char *system_prompt = alloc_prefer_psram(ATOM_CONTEXT_BUF_SIZE, "system_prompt");
-    char *history_json  = alloc_prefer_psram(ATOM_LLM_STREAM_BUF_SIZE, "history_json");
-    char *tool_output   = alloc_prefer_psram(8 * 1024, "tool_output");
-    char *cf_summary    = alloc_prefer_psram(ATOM_CF_SUMMARY_MAX_LEN, "cf_summary");
-
-    if (!system_prompt || !history_json || !tool_output || !cf_summary) {
-        ESP_LOGE(TAG, "Agent buffer allocation failed");
-        free(system_prompt);
-        free(history_json);
-        free(tool_output);
-        free(cf_summary);
-        vTaskDelete(NULL);
-        return;
+    stream_ctx_t *sc = (stream_ctx_t *)ctx;
+    if (!sc->first_token) {
+        sc->first_token = true;
+        ESP_LOGI(TAG, "First token after %d ms",
+                 (int)((esp_timer_get_time() - sc->start_us) / 1000));
+    }
+}
+
+static void stream_on_tool_use(const llm_tool_call_t *call, void *ctx)
+{
+    ESP_LOGI(TAG, "Tool call ready: %s (%d bytes input)", call->name, (int)call->input_len);
+}
+#endif
+
+/* Idle-time job: regenerate the CF summary for one user. arg is a strdup'd chat_id. */
+static void summarize_job(void *arg)
+{
+    char *user_id = (char *)arg;
+    ESP_LOGI(TAG, "Generating summary for user %s", user_id);
+
+    /* 直近履歴から要約プロンプトを組み立てる */
+    const char *sum_system =
+        "You are a concise summarizer. Summarize the conversation "
+        "in 3-5 sentences focusing on key facts and user preferences. "
+        "Write in third person about 'the user'. "
+        "Reply with only the summary text, no extra commentary.";
+
+    cJSON *sum_msgs = atom_session_get_history(user_id, 0);
+    if (sum_msgs) {
+        llm_response_t sum_resp = {0};
+        if (llm_chat_tools(sum_system, sum_msgs, NULL, &sum_resp) == ESP_OK
+            && sum_resp.text && sum_resp.text_len > 0) {
+            /* 要約は次の /turn で Cloudflare KV に保存 */
+            cf_stage_summary(user_id, sum_resp.text);
+        }
+        llm_response_free(&sum_resp);
+        cJSON_Delete(sum_msgs);
+    }
+    free(user_id);
+}
+
+/* ── Agent engine: dispatcher + worker pool ─────────────────────────────
+ * One dispatcher pops the inbound bus and hands each message to a worker.
+ * A chat_id is owned by at most one worker at a time: while a worker still
+ * has messages for that user queued or in flight, new ones from the same
+ * user go to the same worker, so per-user order and session updates stay
+ * serial. Messages from other users go to any idle worker.
+ *
+ * The dispatcher never waits on a worker: it only pops a message that can
+ * be placed right now (its user's worker has room, or a worker is idle),
+ * so a user with a full backlog or a busy pool leaves the rest of the bus
+ * flowing in deadline order. */
+
+typedef struct {
+    int            id;
+    QueueHandle_t  queue;               /* messages assigned to this worker */
+    char           chat_id[64];         /* owned user ("" when idle) */
+    int            pending;             /* assigned but not yet finished */
+
+    /* Per-worker buffers (PSRAM preferred) */
+    char          *system_prompt;
+    char          *tool_output;         /* one slot per tool call */
+    char          *cf_summary;
+} agent_worker_t;
+
+static agent_worker_t    s_workers[ATOM_AGENT_WORKERS];
+static int               s_worker_count = 0;
+static SemaphoreHandle_t s_route_lock = NULL;
+
+/* Pick the worker for chat_id and count the message against it.
+ * Returns NULL if the user's worker has no queue room left, or the user
+ * is not owned and every worker is busy. Caller must hold s_route_lock. */
+static agent_worker_t *route_locked(const char *chat_id)
+{
+    agent_worker_t *idle = NULL;
+    for (int i = 0; i < s_worker_count; i++) {
+        agent_worker_t *w = &s_workers[i];
+        if (w->pending > 0 && strcmp(w->chat_id, chat_id) == 0) {
+            /* pending counts the queued ones plus at most one in flight */
+            if (w->pending >= ATOM_AGENT_WORKER_QUEUE_LEN) return NULL;
+            w->pending++;
+            return w;
+        }
+        if (!idle && w->pending == 0) idle = w;
+    }
+    if (idle) {
+        strncpy(idle->chat_id, chat_id, sizeof(idle->chat_id) - 1);
+        idle->chat_id[sizeof(idle->chat_id) - 1] = '\0';
+        idle->pending = 1;
     }
+    return idle;
+}
+
+/* Bus accept callback: reserve a worker for msg, or leave it queued. */
+static bool dispatch_accept(const mimi_msg_t *msg, void *ctx)
+{
+    xSemaphoreTake(s_route_lock, portMAX_DELAY);
+    agent_worker_t *w = route_locked(msg->chat_id);
+    xSemaphoreGive(s_route_lock);
+    *(agent_worker_t **)ctx = w;
+    return w != NULL;
+}
+
+static void agent_dispatch_task(void *arg)
+{
+    ESP_LOGI(TAG, "Agent dispatcher started (%d workers)", s_worker_count);
+
+    while (1) {
+        mimi_msg_t msg;
+        agent_worker_t *w = NULL;
+        if (message_bus_pop_inbound_if(&msg, UINT32_MAX, dispatch_accept, &w) != ESP_OK) {
+            continue;
+        }
+        /* Room was reserved in dispatch_accept(); only this task sends */
+        xQueueSend(w->queue, &msg, 0);
+    }
+}
+
+/* Mark one message finished; releases the user when nothing is left and
+ * lets the dispatcher place messages that were waiting for room. */
+static void agent_worker_done(agent_worker_t *w)
+{
+    xSemaphoreTake(s_route_lock, portMAX_DELAY);
+    if (--w->pending == 0) {
+        w->chat_id[0] = '\0';
+    }
+    xSemaphoreGive(s_route_lock);
+    message_bus_wake_inbound();
+}
+
+static void atom_agent_task(void *arg)
+{
+    agent_worker_t *w = (agent_worker_t *)arg;
+    ESP_LOGI(TAG, "AtomClaw agent worker %d started on core %d", w->id, xPortGetCoreID());
+
+    char *system_prompt = w->system_prompt;
+    char *tool_output   = w->tool_output;
+    char *cf_summary    = w->cf_summary;
 
     const char *tools_json = tool_registry_get_tools_json();
 
+    /* cJSON for each request comes from this worker's arena */
+    atom_json_arena_attach();
+
     while (1) {
         mimi_msg_t msg;
-        esp_err_t err = message_bus_pop_inbound(&msg, portMAX_DELAY);
-        if (err != ESP_OK) continue;
+        if (xQueueReceive(w->queue, &msg, portMAX_DELAY) != pdTRUE) continue;
+        int64_t started_us = esp_timer_get_time();
+        esp_err_t err;
 
-        ESP_LOGI(TAG, "AtomClaw processing from %s (user=%s)", msg.channel, msg.chat_id);
+        ESP_LOGI(TAG, "[w%d] AtomClaw processing from %s (user=%s)",
+                 w->id, msg.channel, msg.chat_id);
 
         /* 1. Check CF availability for this request */
         bool cf_ok = cf_history_is_configured()
@@ -222,14 +360,12 @@ static void atom_agent_task(void *arg)
         atom_context_build_system(system_prompt, ATOM_CONTEXT_BUF_SIZE, cf_summary);
 
         /* 4. Load local ring buffer history.
-         *    CF mode: all stored messages (up to ATOM_SESSION_MAX_MSGS).
+         *    CF mode: all stored messages (up to ATOM_SESSION_USER_BYTES of text).
          *    Local-only mode: last 2 exchanges (4 messages) to keep context short. */
         int max_msgs = cf_ok ? 0 : 4;
-        atom_session_get_history_json(msg.chat_id, history_json,
-                                      ATOM_LLM_STREAM_BUF_SIZE, max_msgs);
 
         /* 5. Build messages array */
-        cJSON *messages = cJSON_Parse(history_json);
+        cJSON *messages = atom_session_get_history(msg.chat_id, max_msgs);
         if (!messages) messages = cJSON_CreateArray();
 
         cJSON *user_msg_j = cJSON_CreateObject();
@@ -237,13 +373,26 @@ static void atom_agent_task(void *arg)
         cJSON_AddStringToObject(user_msg_j, "content", msg.content);
         cJSON_AddItemToArray(messages, user_msg_j);
 
+        /* Serialize system prompt, tools and history once for all iterations */
+        llm_conv_t *conv = llm_conv_create(system_prompt, tools_json, messages);
+
         /* 6. ReAct loop (max ATOM_AGENT_MAX_TOOL_ITER iterations) */
         char *final_text = NULL;
         int iteration = 0;
 
-        while (iteration < ATOM_AGENT_MAX_TOOL_ITER) {
+        while (conv && iteration < ATOM_AGENT_MAX_TOOL_ITER) {
             llm_response_t resp;
-            err = llm_chat_tools(system_prompt, messages, tools_json, &resp);
+#if ATOM_LLM_USE_STREAM
+            stream_ctx_t sc = { .start_us = esp_timer_get_time() };
+            llm_stream_cb_t cb = {
+                .on_text     = stream_on_text,
+                .on_tool_use = stream_on_tool_use,
+                .ctx         = &sc,
+            };
+            err = llm_conv_chat_stream(conv, &cb, &resp);
+#else
+            err = llm_conv_chat(conv, &resp);
+#endif
 
             if (err != ESP_OK) {
                 ESP_LOGE(TAG, "LLM error: %s", esp_err_to_name(err));
@@ -252,7 +401,7 @@ static void atom_agent_task(void *arg)
 
             if (!resp.tool_use) {
                 if (resp.text && resp.text_len > 0) {
-                    final_text = strdup(resp.text);
+                    final_text = msg_text_new(resp.text, resp.text_len);
                 }
                 llm_response_free(&resp);
                 break;
@@ -279,34 +428,43 @@ static void atom_agent_task(void *arg)
                 cJSON_AddItemToArray(asst_content, ub);
             }
             cJSON_AddItemToObject(asst_msg, "content", asst_content);
-            cJSON_AddItemToArray(messages, asst_msg);
+            llm_conv_append(conv, asst_msg);
+
+            tool_job_t jobs[ATOM_MAX_TOOL_CALLS];
+            for (int i = 0; i < resp.call_count; i++) {
+                jobs[i] = (tool_job_t){
+                    .name        = resp.calls[i].name,
+                    .input       = resp.calls[i].input,
+                    .output      = tool_output + i * ATOM_TOOL_OUTPUT_SIZE,
+                    .output_size = ATOM_TOOL_OUTPUT_SIZE,
+                };
+            }
+            tool_pool_run(jobs, resp.call_count);
 
             cJSON *results_content = cJSON_CreateArray();
             for (int i = 0; i < resp.call_count; i++) {
-                const llm_tool_call_t *call = &resp.calls[i];
-                tool_output[0] = '\0';
-                tool_registry_execute(call->name, call->input, tool_output, 8*1024);
                 cJSON *rb = cJSON_CreateObject();
                 cJSON_AddStringToObject(rb, "type",        "tool_result");
-                cJSON_AddStringToObject(rb, "tool_use_id", call->id);
-                cJSON_AddStringToObject(rb, "content",     tool_output);
+                cJSON_AddStringToObject(rb, "tool_use_id", resp.calls[i].id);
+                cJSON_AddStringToObject(rb, "content",     jobs[i].output);
                 cJSON_AddItemToArray(results_content, rb);
             }
             cJSON *result_msg = cJSON_CreateObject();
             cJSON_AddStringToObject(result_msg, "role", "user");
             cJSON_AddItemToObject(result_msg, "content", results_content);
-            cJSON_AddItemToArray(messages, result_msg);
+            llm_conv_append(conv, result_msg);
 
             llm_response_free(&resp);
             iteration++;
         }
 
-        cJSON_Delete(messages);
+        llm_conv_free(conv);
 
-        /* 7. Prepare response text */
-        const char *response_text = (final_text && final_text[0])
-            ? final_text
-            : "Sorry, I couldn't process your request.";
+        /* 7. Prepare response text. One shared buffer is handed to the
+         *    session, the outbound bus and CF staging by reference. */
+        char *response_text = (final_text && final_text[0])
+            ? msg_text_ref(final_text)
+            : msg_text_dup("Sorry, I couldn't process your request.");
 
         /* 8. Save to local ring buffer */
         atom_session_append(msg.chat_id, "user",      msg.content);
@@ -317,61 +475,107 @@ static void atom_agent_task(void *arg)
         strncpy(out.channel, msg.channel, sizeof(out.channel) - 1);
         strncpy(out.chat_id, msg.chat_id, sizeof(out.chat_id) - 1);
         strncpy(out.meta,    msg.meta,    sizeof(out.meta) - 1);
-        out.content = strdup(response_text);
+        out.deadline_us = msg.deadline_us;
+        out.content = msg_text_ref(response_text);
         if (out.content) {
             if (message_bus_push_outbound(&out) != ESP_OK) {
                 ESP_LOGW(TAG, "Outbound queue full, dropping response");
-                free(out.content);
+                msg_text_unref(out.content);
             }
         }
 
-        /* 10. Async CF save (both turns) — CF mode only */
-        if (cf_ok) {
-            uint32_t now = (uint32_t)time(NULL);
-            cf_save_async(msg.chat_id, "user",      msg.content,   now);
-            cf_save_async(msg.chat_id, "assistant", response_text, now + 1);
+        /* 10. Stage the exchange for the next /turn — CF mode only */
+        if (cf_ok && response_text) {
+            cf_stage_turn(msg.chat_id, msg.content, response_text, (uint32_t)time(NULL));
         }
 
         /* 11. ESP32側で要約生成 (CF mode + needs_summarize フラグが立っている場合)
-         *     Cloudflare Worker は AI を呼ばない。要約生成は ESP32 の LLM が担う。 */
+         *     Cloudflare Worker は AI を呼ばない。要約生成は ESP32 の LLM が担う。
+         *     Deferred to the idle scheduler so the next message is not kept waiting. */
         if (cf_ok && cf_res.needs_summarize) {
-            ESP_LOGI(TAG, "Generating summary for user %s (history_count=%d)",
+            ESP_LOGI(TAG, "Queue summary for user %s (history_count=%d)",
                      msg.chat_id, cf_res.history_count);
-
-            /* 直近履歴から要約プロンプトを組み立てる */
-            char *sum_history = alloc_prefer_psram(4096, "sum_history");
-            if (sum_history) {
-                atom_session_get_history_json(msg.chat_id, sum_history, 4096, 0);
-
-                const char *sum_system =
-                    "You are a concise summarizer. Summarize the conversation "
-                    "in 3-5 sentences focusing on key facts and user preferences. "
-                    "Write in third person about 'the user'. "
-                    "Reply with only the summary text, no extra commentary.";
-
-                cJSON *sum_msgs = cJSON_Parse(sum_history);
-                if (!sum_msgs) sum_msgs = cJSON_CreateArray();
-
-                llm_response_t sum_resp = {0};
-                if (llm_chat_tools(sum_system, sum_msgs, NULL, &sum_resp) == ESP_OK
-                    && sum_resp.text && sum_resp.text_len > 0) {
-                    /* 要約を Cloudflare KV に保存 */
-                    cf_update_summary(msg.chat_id, sum_resp.text);
-                }
-                llm_response_free(&sum_resp);
-                cJSON_Delete(sum_msgs);
-                heap_caps_free(sum_history);
+            char *user = strdup(msg.chat_id);
+            if (user && atom_idle_submit(summarize_job, user) != ESP_OK) {
+                free(user);
             }
         }
 
-        free(final_text);
-        free(msg.content);
+        msg_text_unref(response_text);
+        msg_text_unref(final_text);
+        msg_text_unref(msg.content);
+
+        /* Every cJSON tree of this request is gone; release them at once */
+        atom_json_arena_reset();
+
+        /* Feeds the service-time estimate used for admission control */
+        message_bus_turn_done((uint32_t)((esp_timer_get_time() - started_us) / 1000));
+        agent_worker_done(w);
 
         ESP_LOGI(TAG, "Free PSRAM: %d bytes",
                  (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
     }
 }
 
+static void agent_worker_free(agent_worker_t *w)
+{
+    free(w->system_prompt);
+    free(w->tool_output);
+    free(w->cf_summary);
+    if (w->queue) vQueueDelete(w->queue);
+    memset(w, 0, sizeof(*w));
+}
+
+static esp_err_t atom_agent_start(void)
+{
+    s_route_lock = xSemaphoreCreateMutex();
+    if (!s_route_lock) return ESP_ERR_NO_MEM;
+
+    for (int i = 0; i < ATOM_AGENT_WORKERS; i++) {
+        agent_worker_t *w = &s_workers[s_worker_count];
+        w->id = i;
+
+        /* Prefer PSRAM; fallback to internal RAM so ATOMS3 (no PSRAM) can still run. */
+        w->system_prompt = alloc_prefer_psram(ATOM_CONTEXT_BUF_SIZE, "system_prompt");
+        /* One result buffer per tool call slot so calls can run concurrently */
+        w->tool_output   = alloc_prefer_psram(ATOM_MAX_TOOL_CALLS * ATOM_TOOL_OUTPUT_SIZE,
+                                              "tool_output");
+        w->cf_summary    = alloc_prefer_psram(ATOM_CF_SUMMARY_MAX_LEN, "cf_summary");
+        w->queue = xQueueCreate(ATOM_AGENT_WORKER_QUEUE_LEN, sizeof(mimi_msg_t));
+
+        if (!w->system_prompt || !w->tool_output ||
+            !w->cf_summary || !w->queue) {
+            ESP_LOGE(TAG, "Agent worker %d allocation failed", i);
+            agent_worker_free(w);
+            break;
+        }
+
+        char name[16];
+        snprintf(name, sizeof(name), "atom_agent%d", i);
+        if (xTaskCreatePinnedToCore(atom_agent_task, name, ATOM_AGENT_STACK, w,
+                                    ATOM_AGENT_PRIO, NULL, ATOM_AGENT_CORE) != pdPASS) {
+            agent_worker_free(w);
+            break;
+        }
+        s_worker_count++;
+    }
+
+    if (s_worker_count == 0) {
+        ESP_LOGE(TAG, "No agent worker could be started");
+        return ESP_FAIL;
+    }
+    if (s_worker_count < ATOM_AGENT_WORKERS) {
+        ESP_LOGW(TAG, "Started %d of %d agent workers", s_worker_count, ATOM_AGENT_WORKERS);
+    }
+
+    if (xTaskCreatePinnedToCore(agent_dispatch_task, "atom_dispatch", ATOM_AGENT_DISPATCH_STACK,
+                                NULL, ATOM_AGENT_PRIO, NULL,
+                                ATOM_AGENT_CORE) != pdPASS) {
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
 /* ── Outbound dispatch: routes response back to channel ──────────────── */
 
 static void outbound_dispatch_task(void *arg)
@@ -384,18 +588,29 @@ static void outbound_dispatch_task(void *arg)
 
         ESP_LOGI(TAG, "Dispatch → %s:%s", msg.channel, msg.chat_id);
 
+        /* Reply token already past its deadline: the reply would be rejected */
+        bool expired = msg.deadline_us && esp_timer_get_time() >= msg.deadline_us;
+
         if (strcmp(msg.channel, ATOM_CHAN_DISCORD) == 0) {
-            /* meta holds the Discord interaction token */
+            /* meta holds the Discord interaction token. No bot token is
+             * configured, so there is no push path once it has expired. */
+            if (expired) {
+                ESP_LOGW(TAG, "Discord token for %s expired, sending anyway", msg.chat_id);
+            }
             discord_follow_up(msg.meta, msg.content);
         } else if (strcmp(msg.channel, ATOM_CHAN_LINE) == 0) {
-            /* meta holds LINE replyToken */
-            line_follow_up(msg.meta, msg.content);
+            /* meta holds LINE replyToken; fall back to push by userId */
+            if (expired || line_follow_up(msg.meta, msg.content) != ESP_OK) {
+                ESP_LOGW(TAG, "LINE reply %s, pushing to %s",
+                         expired ? "deadline missed" : "failed", msg.chat_id);
+                line_push(msg.chat_id, msg.content);
+            }
         } else {
             /* CLI or other future channels */
             ESP_LOGI(TAG, "[%s] %s", msg.channel, msg.content);
         }
 
-        free(msg.content);
+        msg_text_unref(msg.content);
     }
 }
 
@@ -415,7 +630,8 @@ void app_main(void)
     ESP_LOGI(TAG, "PSRAM:         %d bytes",
              (int)heap_caps_get_free_size(MALLOC_CAP_SPIRAM));
 
-    /* Core init */
+    /* Core init. cJSON hooks go first so no tree outlives a hook change. */
+    ESP_ERROR_CHECK(atom_json_arena_init());
     ESP_ERROR_CHECK(init_nvs());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
@@ -477,10 +693,13 @@ void app_main(void)
     ESP_ERROR_CHECK(message_bus_init());
     ESP_ERROR_CHECK(memory_store_init());
     ESP_ERROR_CHECK(atom_session_init());
+    ESP_ERROR_CHECK(atom_context_init());
     ESP_ERROR_CHECK(http_proxy_init());
     ESP_ERROR_CHECK(llm_proxy_init());
     ESP_ERROR_CHECK(tool_registry_init());
+    ESP_ERROR_CHECK(tool_pool_init());
     ESP_ERROR_CHECK(cf_history_init());
+    ESP_ERROR_CHECK(atom_idle_init());
     ESP_LOGI(TAG, "CF history: %s",
              cf_history_is_configured()
              ? "enabled (cloud history + summary)"
@@ -495,18 +714,16 @@ void app_main(void)
         /* Start Discord HTTP server */
         ESP_ERROR_CHECK(discord_server_start());
 
-        /* Start agent loop */
-        BaseType_t agent_ok = xTaskCreatePinnedToCore(atom_agent_task, "atom_agent",
-                                                       ATOM_AGENT_STACK, NULL,
-                                                       ATOM_AGENT_PRIO, NULL, ATOM_AGENT_CORE);
+        /* Start agent workers + dispatcher */
+        esp_err_t agent_err = atom_agent_start();
 
         /* Start outbound dispatcher */
         BaseType_t out_ok = xTaskCreatePinnedToCore(outbound_dispatch_task, "outbound",
                                                      ATOM_OUTBOUND_STACK, NULL,
                                                      ATOM_OUTBOUND_PRIO, NULL, ATOM_OUTBOUND_CORE);
-        if (agent_ok != pdPASS || out_ok != pdPASS) {
-            ESP_LOGE(TAG, "Failed to create tasks: agent=%d outbound=%d",
-                     (int)agent_ok, (int)out_ok);
+        if (agent_err != ESP_OK || out_ok != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create tasks: agent=%s outbound=%d",
+                     esp_err_to_name(agent_err), (int)out_ok);
             rgb_set(255, 0, 0);
             return;
         }
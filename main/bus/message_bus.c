@@ -1,19 +1,320 @@
 #include "message_bus.h"
 #include "device_config.h"
 #include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
 static const char *TAG = "bus";
 
-static QueueHandle_t s_inbound_queue;
-static QueueHandle_t s_outbound_queue;
+/* ── Shared message text ─────────────────────────────────────────────── */
+
+#define MSG_TEXT_MAGIC  0x4D545854u     /* "MTXT" */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t refs;
+    size_t   len;
+    char     text[];
+} msg_text_hdr_t;
+
+static msg_text_hdr_t *text_hdr(const char *t)
+{
+    msg_text_hdr_t *h = (msg_text_hdr_t *)(t - offsetof(msg_text_hdr_t, text));
+    if (h->magic != MSG_TEXT_MAGIC) {
+        ESP_LOGE(TAG, "Not a msg_text: %p", t);
+        abort();
+    }
+    return h;
+}
+
+char *msg_text_new(const char *s, size_t len)
+{
+    size_t size = sizeof(msg_text_hdr_t) + len + 1;
+    msg_text_hdr_t *h = heap_caps_malloc(size, MALLOC_CAP_SPIRAM);
+    if (!h) h = malloc(size);
+    if (!h) return NULL;
+    h->magic = MSG_TEXT_MAGIC;
+    h->refs  = 1;
+    h->len   = len;
+    if (s && len) memcpy(h->text, s, len);
+    h->text[len] = '\0';
+    return h->text;
+}
+
+char *msg_text_dup(const char *s)
+{
+    return s ? msg_text_new(s, strlen(s)) : NULL;
+}
+
+char *msg_text_ref(char *t)
+{
+    if (t) __atomic_add_fetch(&text_hdr(t)->refs, 1, __ATOMIC_RELAXED);
+    return t;
+}
+
+void msg_text_unref(char *t)
+{
+    if (!t) return;
+    msg_text_hdr_t *h = text_hdr(t);
+    if (__atomic_sub_fetch(&h->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+        h->magic = 0;
+        free(h);
+    }
+}
+
+size_t msg_text_len(const char *t)
+{
+    return t ? text_hdr(t)->len : 0;
+}
+
+/* ── Rings ───────────────────────────────────────────────────────────────
+ *
+ * Each direction owns a pool of message slots (PSRAM) and two bounded MPMC
+ * rings of slot indices: "free" and "ready". Push takes a free index, fills
+ * the slot and publishes the index on ready; pop does the reverse. Both rings
+ * are Vyukov-style sequence rings, so producers and consumers never take a
+ * lock, and since each ring holds every index of its pool, publishing an
+ * index never fails.
+ *
+ * Blocking is done with task notifications: a waiter registers its handle,
+ * re-checks the ring and sleeps; whoever publishes to the ring notifies all
+ * registered waiters. Waiters always re-check after waking, so a stray
+ * notification only costs a loop iteration.
+ */
+
+#define BUS_WAITERS     4
+
+typedef struct {
+    uint32_t seq;
+    uint16_t idx;
+} bus_cell_t;
+
+typedef struct {
+    bus_cell_t   *cells;
+    uint32_t      mask;
+    uint32_t      enq;
+    uint32_t      deq;
+    TaskHandle_t  waiters[BUS_WAITERS];
+} bus_ring_t;
+
+typedef struct {
+    const char  *name;
+    mimi_msg_t  *slots;
+    uint32_t    *seqs;          /* arrival order per slot (inbound EDF ties) */
+    int64_t     *arrived;       /* esp_timer time of arrival per slot (inbound) */
+    bus_ring_t   free;
+    bus_ring_t   ready;
+    uint32_t     depth;         /* slots holding a message not yet popped */
+    uint32_t     high_water;
+    uint32_t     pushed;
+    uint32_t     dropped;
+    uint32_t     coalesced;
+} bus_lane_t;
+
+static bus_lane_t s_in  = { .name = "Inbound" };
+static bus_lane_t s_out = { .name = "Outbound" };
+static uint32_t   s_in_seq;
+
+/* Load estimate for admission control: inbound messages popped but not yet
+ * reported done, and a moving average of how long a turn takes. */
+static uint32_t   s_in_service;
+static uint32_t   s_service_ms;
+
+/* Inbound is served earliest deadline first. The consumer drains the ready
+ * ring into this pick list and takes the best entry; producers never touch
+ * it, so only concurrent consumers serialize on s_pick_lock.
+ *
+ * Coalescing: a user's messages stay in the pick list until
+ * CFG_BUS_COALESCE_MS passes without a follow-up (at most
+ * CFG_BUS_COALESCE_MAX_MS after the first), then leave as one message.
+ * Discord is exempt: every interaction token waits for its own reply. */
+static uint16_t         *s_pick;
+static uint32_t          s_pick_count;
+static SemaphoreHandle_t s_pick_lock;
+static uint32_t          s_in_wakes;    /* bumped by message_bus_wake_inbound() */
+
+static void *bus_calloc(size_t n, size_t size)
+{
+    void *p = heap_caps_calloc(n, size, MALLOC_CAP_SPIRAM);
+    return p ? p : calloc(n, size);
+}
+
+static esp_err_t ring_init(bus_ring_t *r, uint32_t cap)
+{
+    uint32_t size = 1;
+    while (size < cap) size <<= 1;
+    r->cells = bus_calloc(size, sizeof(bus_cell_t));
+    if (!r->cells) return ESP_ERR_NO_MEM;
+    for (uint32_t i = 0; i < size; i++) r->cells[i].seq = i;
+    r->mask = size - 1;
+    return ESP_OK;
+}
+
+/* Pairs with the fence in ring_wait_pop(): either the waiter sees the
+ * published index (or wake count) or we see the waiter. */
+static void ring_notify(bus_ring_t *r)
+{
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < BUS_WAITERS; i++) {
+        TaskHandle_t t = __atomic_load_n(&r->waiters[i], __ATOMIC_ACQUIRE);
+        if (t) xTaskNotifyGive(t);
+    }
+}
+
+static bool ring_push(bus_ring_t *r, uint16_t idx)
+{
+    uint32_t pos = __atomic_load_n(&r->enq, __ATOMIC_RELAXED);
+    for (;;) {
+        bus_cell_t *c = &r->cells[pos & r->mask];
+        uint32_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        int32_t dif = (int32_t)(seq - pos);
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&r->enq, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                c->idx = idx;
+                __atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+                break;
+            }
+        } else if (dif < 0) {
+            return false;                       /* full */
+        } else {
+            pos = __atomic_load_n(&r->enq, __ATOMIC_RELAXED);
+        }
+    }
+
+    ring_notify(r);
+    return true;
+}
+
+static bool ring_pop(bus_ring_t *r, uint16_t *idx)
+{
+    uint32_t pos = __atomic_load_n(&r->deq, __ATOMIC_RELAXED);
+    for (;;) {
+        bus_cell_t *c = &r->cells[pos & r->mask];
+        uint32_t seq = __atomic_load_n(&c->seq, __ATOMIC_ACQUIRE);
+        int32_t dif = (int32_t)(seq - (pos + 1));
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&r->deq, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *idx = c->idx;
+                __atomic_store_n(&c->seq, pos + r->mask + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+        } else if (dif < 0) {
+            return false;                       /* empty */
+        } else {
+            pos = __atomic_load_n(&r->deq, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/* Pop an index, blocking up to ticks (portMAX_DELAY = forever). With wake
+ * set, also gives up early once *wake no longer equals seen. */
+static bool ring_wait_pop(bus_ring_t *r, uint16_t *idx, TickType_t ticks,
+                          const uint32_t *wake, uint32_t seen)
+{
+    if (ring_pop(r, idx)) return true;
+    if (ticks == 0) return false;
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    TickType_t start = xTaskGetTickCount();
+    for (;;) {
+        int slot = -1;
+        for (int i = 0; i < BUS_WAITERS && slot < 0; i++) {
+            TaskHandle_t expected = NULL;
+            if (__atomic_compare_exchange_n(&r->waiters[i], &expected, self, false,
+                                            __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+                slot = i;
+            }
+        }
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        bool got = ring_pop(r, idx);
+        bool woken = !got && wake && __atomic_load_n(wake, __ATOMIC_SEQ_CST) != seen;
+        TickType_t wait = portMAX_DELAY;
+        if (!got && ticks != portMAX_DELAY) {
+            TickType_t spent = xTaskGetTickCount() - start;
+            wait = spent < ticks ? ticks - spent : 0;
+        }
+        /* No waiter slot left: poll instead of sleeping unnoticed */
+        if (!got && slot < 0 && wait > pdMS_TO_TICKS(10)) wait = pdMS_TO_TICKS(10);
+        if (!got && !woken && wait > 0) ulTaskNotifyTake(pdTRUE, wait);
+
+        if (slot >= 0) __atomic_store_n(&r->waiters[slot], NULL, __ATOMIC_RELAXED);
+        if (got || ring_pop(r, idx)) return true;
+        if (wake && __atomic_load_n(wake, __ATOMIC_SEQ_CST) != seen) return false;
+        if (ticks != portMAX_DELAY && xTaskGetTickCount() - start >= ticks) return false;
+    }
+}
+
+static esp_err_t lane_init(bus_lane_t *l, uint32_t slots)
+{
+    l->slots = bus_calloc(slots, sizeof(mimi_msg_t));
+    l->seqs  = bus_calloc(slots, sizeof(uint32_t));
+    l->arrived = bus_calloc(slots, sizeof(int64_t));
+    if (!l->slots || !l->seqs || !l->arrived ||
+        ring_init(&l->free, slots) != ESP_OK || ring_init(&l->ready, slots) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint32_t i = 0; i < slots; i++) ring_push(&l->free, (uint16_t)i);
+    return ESP_OK;
+}
+
+static esp_err_t lane_push(bus_lane_t *l, const mimi_msg_t *msg, uint32_t *seq)
+{
+    uint16_t idx;
+    if (!ring_wait_pop(&l->free, &idx, pdMS_TO_TICKS(1000), NULL, 0)) {
+        __atomic_add_fetch(&l->dropped, 1, __ATOMIC_RELAXED);
+        ESP_LOGW(TAG, "%s queue full, dropping message", l->name);
+        return ESP_ERR_NO_MEM;
+    }
+    l->slots[idx] = *msg;
+    if (seq) l->seqs[idx] = __atomic_fetch_add(seq, 1, __ATOMIC_RELAXED);
+    l->arrived[idx] = esp_timer_get_time();
+
+    uint32_t depth = __atomic_add_fetch(&l->depth, 1, __ATOMIC_RELAXED);
+    uint32_t hw = __atomic_load_n(&l->high_water, __ATOMIC_RELAXED);
+    while (depth > hw &&
+           !__atomic_compare_exchange_n(&l->high_water, &hw, depth, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    __atomic_add_fetch(&l->pushed, 1, __ATOMIC_RELAXED);
+
+    ring_push(&l->ready, idx);                  /* cannot fail: ring holds every index */
+    return ESP_OK;
+}
+
+/* Hand a popped slot back to the free ring. */
+static void lane_free(bus_lane_t *l, uint16_t idx)
+{
+    __atomic_sub_fetch(&l->depth, 1, __ATOMIC_RELAXED);
+    ring_push(&l->free, idx);
+}
+
+static void lane_release(bus_lane_t *l, uint16_t idx, mimi_msg_t *msg)
+{
+    *msg = l->slots[idx];
+    lane_free(l, idx);
+}
+
+static TickType_t to_ticks(uint32_t timeout_ms)
+{
+    return (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+}
 
 esp_err_t message_bus_init(void)
 {
-    s_inbound_queue = xQueueCreate(CFG_BUS_QUEUE_LEN, sizeof(mimi_msg_t));
-    s_outbound_queue = xQueueCreate(CFG_BUS_QUEUE_LEN, sizeof(mimi_msg_t));
+    s_pick_lock = xSemaphoreCreateMutex();
+    s_pick = bus_calloc(CFG_BUS_QUEUE_LEN, sizeof(uint16_t));
 
-    if (!s_inbound_queue || !s_outbound_queue) {
+    if (!s_pick_lock || !s_pick ||
+        lane_init(&s_in, CFG_BUS_QUEUE_LEN) != ESP_OK ||
+        lane_init(&s_out, CFG_BUS_QUEUE_LEN) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to create message queues");
         return ESP_ERR_NO_MEM;
     }
@@ -22,38 +323,252 @@ esp_err_t message_bus_init(void)
     return ESP_OK;
 }
 
+/* True if slot a should be served before slot b */
+static bool slot_before(uint16_t a, uint16_t b)
+{
+    int64_t da = s_in.slots[a].deadline_us, db = s_in.slots[b].deadline_us;
+    if (da != db) {
+        if (da == 0) return false;
+        if (db == 0) return true;
+        return da < db;
+    }
+    return (int32_t)(s_in.seqs[a] - s_in.seqs[b]) < 0;
+}
+
 esp_err_t message_bus_push_inbound(const mimi_msg_t *msg)
 {
-    if (xQueueSend(s_inbound_queue, msg, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        ESP_LOGW(TAG, "Inbound queue full, dropping message");
-        return ESP_ERR_NO_MEM;
+    return lane_push(&s_in, msg, &s_in_seq);
+}
+
+static bool coalesces(uint16_t idx)
+{
+    return CFG_BUS_COALESCE_MS > 0 &&
+           strcmp(s_in.slots[idx].channel, MIMI_CHAN_DISCORD) != 0;
+}
+
+static bool same_user(uint16_t a, uint16_t b)
+{
+    return strcmp(s_in.slots[a].chat_id, s_in.slots[b].chat_id) == 0 &&
+           strcmp(s_in.slots[a].channel, s_in.slots[b].channel) == 0;
+}
+
+/* When the held messages of idx's user may leave. Caller holds s_pick_lock. */
+static int64_t pick_due(uint16_t idx)
+{
+    if (!coalesces(idx)) return 0;
+    int64_t first = s_in.arrived[idx], last = first;
+    for (uint32_t i = 0; i < s_pick_count; i++) {
+        uint16_t o = s_pick[i];
+        if (!same_user(o, idx)) continue;
+        if (s_in.arrived[o] < first) first = s_in.arrived[o];
+        if (s_in.arrived[o] > last)  last  = s_in.arrived[o];
+    }
+    int64_t due = last + (int64_t)CFG_BUS_COALESCE_MS * 1000;
+    int64_t cap = first + (int64_t)CFG_BUS_COALESCE_MAX_MS * 1000;
+    return due < cap ? due : cap;
+}
+
+/* Move idx and the rest of its user's messages out of the pick list, in
+ * arrival order. Caller holds s_pick_lock. */
+static int pick_take(uint16_t idx, uint16_t *group)
+{
+    int n = 0;
+    for (uint32_t i = 0; i < s_pick_count; ) {
+        uint16_t o = s_pick[i];
+        if (o == idx || (coalesces(idx) && same_user(o, idx))) {
+            int k = n++;
+            while (k > 0 && (int32_t)(s_in.seqs[o] - s_in.seqs[group[k - 1]]) < 0) {
+                group[k] = group[k - 1];
+                k--;
+            }
+            group[k] = o;
+            s_pick[i] = s_pick[--s_pick_count];
+        } else {
+            i++;
+        }
     }
+    return n;
+}
+
+/* Join a group into one message: texts in arrival order, one per line,
+ * routed on the newest message's reply token and deadline. */
+static esp_err_t merge_group(const uint16_t *group, int n, mimi_msg_t *msg)
+{
+    size_t total = n - 1;
+    for (int i = 0; i < n; i++) total += msg_text_len(s_in.slots[group[i]].content);
+    char *text = msg_text_new(NULL, total);
+    if (!text) return ESP_ERR_NO_MEM;
+
+    char *p = text;
+    for (int i = 0; i < n; i++) {
+        char *part = s_in.slots[group[i]].content;
+        size_t len = msg_text_len(part);
+        if (i > 0) *p++ = '\n';
+        if (len) memcpy(p, part, len);
+        p += len;
+        msg_text_unref(part);
+    }
+
+    *msg = s_in.slots[group[n - 1]];
+    msg->content = text;
+    for (int i = 0; i < n; i++) lane_free(&s_in, group[i]);
+
+    __atomic_add_fetch(&s_in.coalesced, n - 1, __ATOMIC_RELAXED);
+    ESP_LOGI(TAG, "Coalesced %d messages from %s:%s", n, msg->channel, msg->chat_id);
     return ESP_OK;
 }
 
+/* Earliest-deadline due entry that accept takes, or -1. Entries accept
+ * turns down are skipped, not reordered. Caller holds s_pick_lock. */
+static int pick_best(int64_t now, int64_t *next_due,
+                     message_bus_accept_t accept, void *ctx)
+{
+    bool skip[CFG_BUS_QUEUE_LEN] = {0};
+    for (;;) {
+        int best = -1;
+        for (uint32_t i = 0; i < s_pick_count; i++) {
+            if (skip[i]) continue;
+            int64_t due = pick_due(s_pick[i]);
+            if (due > now) {
+                if (due < *next_due) *next_due = due;
+            } else if (best < 0 || slot_before(s_pick[i], s_pick[best])) {
+                best = (int)i;
+            }
+        }
+        if (best < 0 || !accept || accept(&s_in.slots[s_pick[best]], ctx)) return best;
+        skip[best] = true;
+    }
+}
+
+static esp_err_t pick_inbound(mimi_msg_t *msg, uint32_t timeout_ms,
+                              message_bus_accept_t accept, void *ctx)
+{
+    TickType_t ticks = to_ticks(timeout_ms);
+    TickType_t start = xTaskGetTickCount();
+    uint16_t group[CFG_BUS_QUEUE_LEN];
+
+    for (;;) {
+        /* Read before picking, so a wake that lands mid-pick is not lost */
+        uint32_t wakes = __atomic_load_n(&s_in_wakes, __ATOMIC_SEQ_CST);
+        int64_t now = esp_timer_get_time();
+        int64_t next_due = INT64_MAX;
+        int n = 0;
+        uint16_t idx;
+
+        xSemaphoreTake(s_pick_lock, portMAX_DELAY);
+        while (ring_pop(&s_in.ready, &idx)) s_pick[s_pick_count++] = idx;
+        int best = pick_best(now, &next_due, accept, ctx);
+        if (best >= 0) n = pick_take(s_pick[best], group);
+        xSemaphoreGive(s_pick_lock);
+
+        if (n == 1) {
+            lane_release(&s_in, group[0], msg);
+            return ESP_OK;
+        }
+        if (n > 1) {
+            if (merge_group(group, n, msg) == ESP_OK) return ESP_OK;
+            /* Out of memory: hand them over one at a time instead */
+            xSemaphoreTake(s_pick_lock, portMAX_DELAY);
+            for (int i = 1; i < n; i++) s_pick[s_pick_count++] = group[i];
+            xSemaphoreGive(s_pick_lock);
+            lane_release(&s_in, group[0], msg);
+            return ESP_OK;
+        }
+
+        /* Nothing due (or accepted) yet: sleep until something is
+         * published, a consumer is woken or the first held user is due,
+         * then re-pick */
+        TickType_t wait = portMAX_DELAY;
+        if (ticks != portMAX_DELAY) {
+            TickType_t spent = xTaskGetTickCount() - start;
+            if (spent >= ticks) return ESP_ERR_TIMEOUT;
+            wait = ticks - spent;
+        }
+        if (next_due != INT64_MAX) {
+            TickType_t hold = pdMS_TO_TICKS((next_due - now + 999) / 1000);
+            if (hold == 0) hold = 1;
+            if (hold < wait) wait = hold;
+        }
+        if (ring_wait_pop(&s_in.ready, &idx, wait, &s_in_wakes, wakes)) {
+            xSemaphoreTake(s_pick_lock, portMAX_DELAY);
+            s_pick[s_pick_count++] = idx;
+            xSemaphoreGive(s_pick_lock);
+        }
+    }
+}
+
 esp_err_t message_bus_pop_inbound(mimi_msg_t *msg, uint32_t timeout_ms)
 {
-    TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
-    if (xQueueReceive(s_inbound_queue, msg, ticks) != pdTRUE) {
-        return ESP_ERR_TIMEOUT;
+    return message_bus_pop_inbound_if(msg, timeout_ms, NULL, NULL);
+}
+
+esp_err_t message_bus_pop_inbound_if(mimi_msg_t *msg, uint32_t timeout_ms,
+                                     message_bus_accept_t accept, void *ctx)
+{
+    esp_err_t err = pick_inbound(msg, timeout_ms, accept, ctx);
+    if (err == ESP_OK) __atomic_add_fetch(&s_in_service, 1, __ATOMIC_RELAXED);
+    return err;
+}
+
+void message_bus_wake_inbound(void)
+{
+    __atomic_add_fetch(&s_in_wakes, 1, __ATOMIC_SEQ_CST);
+    ring_notify(&s_in.ready);
+}
+
+void message_bus_turn_done(uint32_t service_ms)
+{
+    uint32_t n = __atomic_load_n(&s_in_service, __ATOMIC_RELAXED);
+    while (n > 0 &&
+           !__atomic_compare_exchange_n(&s_in_service, &n, n - 1, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
     }
-    return ESP_OK;
+    /* EWMA over roughly the last 8 turns */
+    uint32_t avg = __atomic_load_n(&s_service_ms, __ATOMIC_RELAXED);
+    avg = avg ? (uint32_t)(((uint64_t)avg * 7 + service_ms) / 8) : service_ms;
+    __atomic_store_n(&s_service_ms, avg, __ATOMIC_RELAXED);
+}
+
+void message_bus_get_load(message_bus_load_t *load)
+{
+    load->queued     = __atomic_load_n(&s_in.depth, __ATOMIC_RELAXED);
+    load->capacity   = CFG_BUS_QUEUE_LEN;
+    load->in_service = __atomic_load_n(&s_in_service, __ATOMIC_RELAXED);
+    load->service_ms = __atomic_load_n(&s_service_ms, __ATOMIC_RELAXED);
+}
+
+int message_bus_inbound_waiting(void)
+{
+    return (int)__atomic_load_n(&s_in.depth, __ATOMIC_RELAXED);
 }
 
 esp_err_t message_bus_push_outbound(const mimi_msg_t *msg)
 {
-    if (xQueueSend(s_outbound_queue, msg, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        ESP_LOGW(TAG, "Outbound queue full, dropping message");
-        return ESP_ERR_NO_MEM;
-    }
-    return ESP_OK;
+    return lane_push(&s_out, msg, NULL);
 }
 
 esp_err_t message_bus_pop_outbound(mimi_msg_t *msg, uint32_t timeout_ms)
 {
-    TickType_t ticks = (timeout_ms == UINT32_MAX) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
-    if (xQueueReceive(s_outbound_queue, msg, ticks) != pdTRUE) {
+    uint16_t idx;
+    if (!ring_wait_pop(&s_out.ready, &idx, to_ticks(timeout_ms), NULL, 0)) {
         return ESP_ERR_TIMEOUT;
     }
+    lane_release(&s_out, idx, msg);
     return ESP_OK;
 }
+
+static void lane_stats(const bus_lane_t *l, message_bus_stats_t *st)
+{
+    st->capacity   = CFG_BUS_QUEUE_LEN;
+    st->depth      = __atomic_load_n(&l->depth, __ATOMIC_RELAXED);
+    st->high_water = __atomic_load_n(&l->high_water, __ATOMIC_RELAXED);
+    st->pushed     = __atomic_load_n(&l->pushed, __ATOMIC_RELAXED);
+    st->dropped    = __atomic_load_n(&l->dropped, __ATOMIC_RELAXED);
+    st->coalesced  = __atomic_load_n(&l->coalesced, __ATOMIC_RELAXED);
+}
+
+void message_bus_get_stats(message_bus_stats_t *in, message_bus_stats_t *out)
+{
+    if (in)  lane_stats(&s_in, in);
+    if (out) lane_stats(&s_out, out);
+}
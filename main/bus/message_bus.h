@@ -1,8 +1,10 @@
 #pragma once
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include "esp_err.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/queue.h"
 
 /* Channel identifiers */
 #define MIMI_CHAN_TELEGRAM   "telegram"
@@ -17,34 +19,110 @@ typedef struct {
     char channel[16];       /* "telegram", "websocket", "cli", "discord" */
     char chat_id[64];       /* Telegram chat_id, WS client id, Discord/LINE user_id */
     char meta[128];         /* Channel-specific metadata (e.g. Discord interaction_token) */
-    char *content;          /* Heap-allocated message text (caller must free) */
+    char *content;          /* Shared message text (msg_text_*), holder owns one reference */
+    int64_t deadline_us;    /* Absolute esp_timer deadline for the reply token (0 = none) */
 } mimi_msg_t;
 
 /**
- * Initialize the message bus (inbound + outbound FreeRTOS queues).
+ * Immutable, reference-counted message text.
+ *
+ * The returned pointer is the NUL-terminated text itself, so it can be passed
+ * anywhere a const char * is expected; a small header in front of it holds
+ * the length and reference count. The text must not be modified once shared.
+ * Session, Cloudflare staging and the channel senders take a reference
+ * instead of copying, and the last msg_text_unref() frees the block.
+ * Allocated from PSRAM when available.
+ */
+char *msg_text_new(const char *s, size_t len);   /* copies len bytes of s; s == NULL
+                                                    leaves them for the caller
+                                                    to fill before sharing */
+char *msg_text_dup(const char *s);
+char *msg_text_ref(char *t);                     /* NULL-safe, returns t */
+void msg_text_unref(char *t);                    /* NULL-safe */
+size_t msg_text_len(const char *t);
+
+/* Per-direction counters, see message_bus_get_stats() */
+typedef struct {
+    uint32_t capacity;      /* message slots in the pool */
+    uint32_t depth;         /* messages queued right now */
+    uint32_t high_water;    /* largest depth seen since boot */
+    uint32_t pushed;
+    uint32_t dropped;       /* pushes that gave up on a full pool */
+    uint32_t coalesced;     /* inbound messages merged into an earlier one */
+} message_bus_stats_t;
+
+/**
+ * Initialize the message bus: a pool of CFG_BUS_QUEUE_LEN message slots per
+ * direction (PSRAM) and lock-free index rings for inbound and outbound.
  */
 esp_err_t message_bus_init(void);
 
 /**
  * Push a message to the inbound queue (towards Agent Loop).
- * The bus takes ownership of msg->content.
+ * The bus takes over the caller's reference to msg->content on success.
  */
 esp_err_t message_bus_push_inbound(const mimi_msg_t *msg);
 
 /**
  * Pop a message from the inbound queue (blocking).
- * Caller must free msg->content when done.
+ * Messages are served earliest deadline first; messages without a deadline
+ * come after all timed ones, in arrival order. Follow-ups a user sends within
+ * CFG_BUS_COALESCE_MS are merged into one message (newline-separated) that
+ * carries the newest message's meta and deadline.
+ * Caller must msg_text_unref(msg->content) when done.
  */
 esp_err_t message_bus_pop_inbound(mimi_msg_t *msg, uint32_t timeout_ms);
 
+/* Return true to take msg; called with the pick list locked, must not block */
+typedef bool (*message_bus_accept_t)(const mimi_msg_t *msg, void *ctx);
+
+/**
+ * Same as message_bus_pop_inbound(), but only takes a message accept()
+ * returns true for: the earliest-deadline message accept() takes is popped,
+ * the ones it turns down stay queued in order. accept() is called at most
+ * once with true per pop. When accept()'s answer may have changed, call
+ * message_bus_wake_inbound() so a blocked consumer picks again.
+ */
+esp_err_t message_bus_pop_inbound_if(mimi_msg_t *msg, uint32_t timeout_ms,
+                                     message_bus_accept_t accept, void *ctx);
+
+/** Make consumers blocked in message_bus_pop_inbound_if() pick again. */
+void message_bus_wake_inbound(void);
+
+/**
+ * Number of messages waiting in the inbound queue.
+ */
+int message_bus_inbound_waiting(void);
+
+/* Inbound load, for admission control */
+typedef struct {
+    uint32_t queued;        /* waiting in the inbound queue */
+    uint32_t capacity;      /* inbound message slots */
+    uint32_t in_service;    /* popped, not yet reported done */
+    uint32_t service_ms;    /* moving average turn time (0 = no sample yet) */
+} message_bus_load_t;
+
+/**
+ * Report that the agent finished one popped inbound message (a coalesced
+ * message counts once) and how long the agent spent on it.
+ */
+void message_bus_turn_done(uint32_t service_ms);
+
+void message_bus_get_load(message_bus_load_t *load);
+
+/**
+ * Snapshot the inbound and outbound counters. Either pointer may be NULL.
+ */
+void message_bus_get_stats(message_bus_stats_t *in, message_bus_stats_t *out);
+
 /**
  * Push a message to the outbound queue (towards channels).
- * The bus takes ownership of msg->content.
+ * The bus takes over the caller's reference to msg->content on success.
  */
 esp_err_t message_bus_push_outbound(const mimi_msg_t *msg);
 
 /**
  * Pop a message from the outbound queue (blocking).
- * Caller must free msg->content when done.
+ * Caller must msg_text_unref(msg->content) when done.
  */
 esp_err_t message_bus_pop_outbound(mimi_msg_t *msg, uint32_t timeout_ms);
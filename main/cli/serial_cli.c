@@ -4,9 +4,11 @@
 #include "memory/memory_store.h"
 #include "proxy/http_proxy.h"
 #include "tools/tool_web_search.h"
+#include "bus/message_bus.h"
 #if CONFIG_DEVICE_ATOMCLAW
 #include "atom_config.h"
 #include "memory/atom_session.h"
+#include "agent/atom_json_arena.h"
 #else
 #include "mimi_config.h"
 #include "telegram/telegram_bot.h"
@@ -263,6 +265,88 @@ static int cmd_session_clear(int argc, char **argv)
     return 0;
 }
 
+#if CONFIG_DEVICE_ATOMCLAW
+/* --- session_stats command --- */
+static struct {
+    struct arg_int *bench;
+    struct arg_int *seed;
+    struct arg_end *end;
+} session_stats_args;
+
+static int cmd_session_stats(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&session_stats_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, session_stats_args.end, argv[0]);
+        return 1;
+    }
+
+    atom_session_stats_t st;
+    atom_session_get_stats(&st);
+    printf("Users:    %d / %d slots\n", st.users, st.slots);
+    printf("Messages: %u\n", (unsigned)st.msgs);
+    printf("Arena:    %u / %u bytes used\n",
+           (unsigned)st.bytes_used, (unsigned)st.bytes_total);
+
+    if (session_stats_args.bench->count == 0) return 0;
+
+    int n = session_stats_args.bench->ival[0];
+    uint32_t seed = session_stats_args.seed->count ? (uint32_t)session_stats_args.seed->ival[0] : 1;
+    atom_session_bench_t b;
+    if (atom_session_bench(n, seed, &b) != ESP_OK) {
+        printf("Benchmark failed.\n");
+        return 1;
+    }
+    printf("\nBenchmark: %d messages, %u bytes, %d bytes per user\n",
+           b.msgs, (unsigned)b.bytes_in, b.user_bytes);
+    printf("  arena:       %d.%02d msgs, %d bytes retained, %d truncated\n",
+           b.arena_avg_msgs / 100, b.arena_avg_msgs % 100,
+           b.arena_avg_bytes, b.arena_truncated);
+    printf("  fixed x%d:    %d.%02d msgs, %d bytes retained, %d truncated\n",
+           b.fixed_slots, b.fixed_avg_msgs / 100, b.fixed_avg_msgs % 100,
+           b.fixed_avg_bytes, b.fixed_truncated);
+    return 0;
+}
+
+/* --- json_arena command --- */
+static struct {
+    struct arg_int *soak;
+    struct arg_end *end;
+} json_arena_args;
+
+static int cmd_json_arena(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&json_arena_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, json_arena_args.end, argv[0]);
+        return 1;
+    }
+
+    atom_json_arena_stats_t st;
+    atom_json_arena_get_stats(&st);
+    printf("Requests: %u\n", (unsigned)st.requests);
+    printf("Peak:     %u / %u bytes per request\n",
+           (unsigned)st.peak_used, (unsigned)st.arena_bytes);
+    printf("Spills:   %u allocations to heap\n", (unsigned)st.spills);
+
+    if (json_arena_args.soak->count == 0) return 0;
+
+    atom_json_soak_t sk;
+    if (atom_json_arena_soak(json_arena_args.soak->ival[0], &sk) != ESP_OK) {
+        printf("Soak failed.\n");
+        return 1;
+    }
+    static const char *const name[2] = { "malloc", "arena " };
+    printf("\nSoak: %d turns, internal heap after each run\n", sk.turns);
+    for (int i = 0; i < 2; i++) {
+        printf("  %s  free=%u largest=%u frag=%d%% time=%lld ms\n", name[i],
+               (unsigned)sk.heap_free[i], (unsigned)sk.heap_largest[i],
+               sk.frag_pct[i], (long long)(sk.elapsed_us[i] / 1000));
+    }
+    return 0;
+}
+#endif
+
 /* --- heap_info command --- */
 static int cmd_heap_info(int argc, char **argv)
 {
@@ -275,6 +359,65 @@ static int cmd_heap_info(int argc, char **argv)
     return 0;
 }
 
+/* --- bus_stats command --- */
+static int cmd_bus_stats(int argc, char **argv)
+{
+    message_bus_stats_t st[2];
+    message_bus_get_stats(&st[0], &st[1]);
+    const char *names[2] = { "Inbound", "Outbound" };
+    for (int i = 0; i < 2; i++) {
+        printf("%-9s depth %u/%u, high water %u, pushed %u, dropped %u\n",
+               names[i], (unsigned)st[i].depth, (unsigned)st[i].capacity,
+               (unsigned)st[i].high_water, (unsigned)st[i].pushed,
+               (unsigned)st[i].dropped);
+    }
+    printf("Coalesced: %u inbound follow-ups merged\n", (unsigned)st[0].coalesced);
+
+    message_bus_load_t ld;
+    message_bus_get_load(&ld);
+    printf("Service:   %u in progress, avg turn %u ms\n",
+           (unsigned)ld.in_service, (unsigned)ld.service_ms);
+    return 0;
+}
+
+/* --- llm_cache_stats command --- */
+static struct {
+    struct arg_lit *reset;
+    struct arg_end *end;
+} cache_stats_args;
+
+static int cmd_llm_cache_stats(int argc, char **argv)
+{
+    int nerrors = arg_parse(argc, argv, (void **)&cache_stats_args);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, cache_stats_args.end, argv[0]);
+        return 1;
+    }
+
+    llm_cache_stats_t st;
+    llm_get_cache_stats(&st);
+
+    uint64_t total_in = st.input_tokens + st.cache_creation_tokens + st.cache_read_tokens;
+    printf("Calls:          %u (cache hits: %u)\n",
+           (unsigned)st.calls, (unsigned)st.cache_hits);
+    printf("Input tokens:   %llu uncached, %llu cache write, %llu cache read\n",
+           (unsigned long long)st.input_tokens,
+           (unsigned long long)st.cache_creation_tokens,
+           (unsigned long long)st.cache_read_tokens);
+    printf("Output tokens:  %llu\n", (unsigned long long)st.output_tokens);
+    printf("Cache hit rate: %d%% of input tokens\n",
+           total_in ? (int)(st.cache_read_tokens * 100 / total_in) : 0);
+    printf("Last call:      in=%u out=%u cache_write=%u cache_read=%u\n",
+           (unsigned)st.last.input_tokens, (unsigned)st.last.output_tokens,
+           (unsigned)st.last.cache_creation_tokens, (unsigned)st.last.cache_read_tokens);
+
+    if (cache_stats_args.reset->count > 0) {
+        llm_reset_cache_stats();
+        printf("Counters reset.\n");
+    }
+    return 0;
+}
+
 /* --- set_proxy command --- */
 static struct {
     struct arg_str *host;
@@ -551,6 +694,31 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&sess_clear_cmd);
 
+#if CONFIG_DEVICE_ATOMCLAW
+    /* session_stats */
+    session_stats_args.bench = arg_int0("b", "bench", "<n>", "Also run the storage benchmark with n messages");
+    session_stats_args.seed = arg_int0("s", "seed", "<seed>", "Benchmark RNG seed");
+    session_stats_args.end = arg_end(2);
+    esp_console_cmd_t sess_stats_cmd = {
+        .command = "session_stats",
+        .help = "Show session memory usage and optionally benchmark it",
+        .func = &cmd_session_stats,
+        .argtable = &session_stats_args,
+    };
+    esp_console_cmd_register(&sess_stats_cmd);
+
+    /* json_arena */
+    json_arena_args.soak = arg_int0("s", "soak", "<turns>", "Run the heap fragmentation soak");
+    json_arena_args.end = arg_end(1);
+    esp_console_cmd_t json_arena_cmd = {
+        .command = "json_arena",
+        .help = "Show cJSON arena usage and optionally soak-test it",
+        .func = &cmd_json_arena,
+        .argtable = &json_arena_args,
+    };
+    esp_console_cmd_register(&json_arena_cmd);
+#endif
+
     /* heap_info */
     esp_console_cmd_t heap_cmd = {
         .command = "heap_info",
@@ -559,6 +727,25 @@ esp_err_t serial_cli_init(void)
     };
     esp_console_cmd_register(&heap_cmd);
 
+    /* bus_stats */
+    esp_console_cmd_t bus_stats_cmd = {
+        .command = "bus_stats",
+        .help = "Show message bus depth, high water and drops",
+        .func = &cmd_bus_stats,
+    };
+    esp_console_cmd_register(&bus_stats_cmd);
+
+    /* llm_cache_stats */
+    cache_stats_args.reset = arg_lit0("r", "reset", "Reset counters after printing");
+    cache_stats_args.end = arg_end(1);
+    esp_console_cmd_t cache_stats_cmd = {
+        .command = "llm_cache_stats",
+        .help = "Show LLM token usage and prompt-cache hits",
+        .func = &cmd_llm_cache_stats,
+        .argtable = &cache_stats_args,
+    };
+    esp_console_cmd_register(&cache_stats_cmd);
+
     /* set_search_key */
     search_key_args.key = arg_str1(NULL, NULL, "<key>", "Brave Search API key");
     search_key_args.end = arg_end(1);
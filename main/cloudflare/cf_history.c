@@ -1,18 +1,26 @@
 #include "cf_history.h"
+#include "cf_journal.h"
 #include "atom_config.h"
+#include "bus/message_bus.h"
 
 #include <string.h>
+#include <strings.h>
 #include <stdlib.h>
 #include <time.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
+#include "esp_random.h"
 #include "nvs_flash.h"
 #include "nvs.h"
 #include "cJSON.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
 
 static const char *TAG = "cf_history";
 
@@ -25,6 +33,7 @@ typedef struct {
     char  *buf;
     size_t size;
     size_t pos;
+    char   etag[32];    /* ETag response header, if any */
 } http_buf_t;
 
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
@@ -36,10 +45,409 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
         memcpy(rb->buf + rb->pos, evt->data, copy);
         rb->pos += copy;
         rb->buf[rb->pos] = '\0';
+    } else if (evt->event_id == HTTP_EVENT_ON_HEADER && rb &&
+               strcasecmp(evt->header_key, "ETag") == 0) {
+        strncpy(rb->etag, evt->header_value, sizeof(rb->etag) - 1);
+        rb->etag[sizeof(rb->etag) - 1] = '\0';
     }
     return ESP_OK;
 }
 
+/* ── Summary cache ───────────────────────────────────────────────────── */
+
+/*
+ * Per-user copy of the last /summary answer, kept in PSRAM. An entry younger
+ * than ATOM_CF_SUMMARY_TTL_MS is served without touching the network. An
+ * older one is revalidated with If-None-Match; the Worker answers 304 while
+ * its version counter is unchanged. Writes made by this device (/save_batch,
+ * /update_summary) return the new version and refresh the entry in place,
+ * so our own turns do not invalidate it.
+ */
+
+typedef struct {
+    char     user_id[64];
+    char     etag[32];
+    char     summary[ATOM_CF_SUMMARY_MAX_LEN];
+    bool     needs_summarize;
+    int      history_count;
+    int64_t  checked_us;    /* last fetch or revalidation; 0 = unused slot */
+} summary_entry_t;
+
+static summary_entry_t  *s_cache = NULL;
+static SemaphoreHandle_t s_cache_lock = NULL;
+
+/* Caller must hold s_cache_lock. */
+static summary_entry_t *cache_find(const char *user_id)
+{
+    if (!s_cache) return NULL;
+    for (int i = 0; i < ATOM_CF_SUMMARY_CACHE_SLOTS; i++) {
+        if (s_cache[i].checked_us && strcmp(s_cache[i].user_id, user_id) == 0) {
+            return &s_cache[i];
+        }
+    }
+    return NULL;
+}
+
+/* Find or take over the least recently checked slot. Caller must hold s_cache_lock. */
+static summary_entry_t *cache_slot(const char *user_id)
+{
+    summary_entry_t *e = cache_find(user_id);
+    if (e || !s_cache) return e;
+
+    e = &s_cache[0];
+    for (int i = 1; i < ATOM_CF_SUMMARY_CACHE_SLOTS; i++) {
+        if (s_cache[i].checked_us < e->checked_us) e = &s_cache[i];
+    }
+    memset(e, 0, sizeof(*e));
+    strncpy(e->user_id, user_id, sizeof(e->user_id) - 1);
+    return e;
+}
+
+/* Copy an entry to the caller. A pending needs_summarize is handed out
+ * once, so cached hits do not queue the same summary job again. */
+static void cache_copy_out(summary_entry_t *e, char *buf, size_t buf_size,
+                           cf_summary_result_t *result)
+{
+    strncpy(buf, e->summary, buf_size - 1);
+    buf[buf_size - 1] = '\0';
+    if (result) {
+        result->needs_summarize = e->needs_summarize;
+        result->history_count   = e->history_count;
+    }
+    e->needs_summarize = false;
+}
+
+/* Apply a write acknowledged by the Worker. summary may be NULL (turn save). */
+static void cache_apply_write(const char *user_id, const char *etag, int history_count,
+                              bool needs_summarize, const char *summary)
+{
+    if (!s_cache_lock || !etag || !etag[0]) return;
+    xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+    summary_entry_t *e = cache_find(user_id);
+    if (e) {
+        strncpy(e->etag, etag, sizeof(e->etag) - 1);
+        e->etag[sizeof(e->etag) - 1] = '\0';
+        if (history_count >= 0) {
+            e->history_count   = history_count;
+            e->needs_summarize = needs_summarize;
+        }
+        if (summary) {
+            strncpy(e->summary, summary, sizeof(e->summary) - 1);
+            e->summary[sizeof(e->summary) - 1] = '\0';
+            e->needs_summarize = false;
+        }
+        e->checked_us = esp_timer_get_time();
+    }
+    xSemaphoreGive(s_cache_lock);
+}
+
+/* Parse a { summary, needs_summarize, history_count } body into the
+ * caller's buffers and, when the Worker sent an ETag, into the cache. */
+static void summary_store(const char *user_id, const char *json, const char *etag,
+                          char *buf, size_t buf_size, cf_summary_result_t *result)
+{
+    cJSON *root = cJSON_Parse(json);
+
+    bool needs_summarize = false;
+    int  history_count   = 0;
+    if (root) {
+        cJSON *js = cJSON_GetObjectItem(root, "summary");
+        if (js && js->valuestring) {
+            strncpy(buf, js->valuestring, buf_size - 1);
+            buf[buf_size - 1] = '\0';
+        }
+        cJSON *jns = cJSON_GetObjectItem(root, "needs_summarize");
+        cJSON *jhc = cJSON_GetObjectItem(root, "history_count");
+        if (jns) needs_summarize = cJSON_IsTrue(jns);
+        if (jhc) history_count   = jhc->valueint;
+        cJSON_Delete(root);
+    }
+    if (result) {
+        result->needs_summarize = needs_summarize;
+        result->history_count   = history_count;
+    }
+
+    if (etag[0] && s_cache_lock) {
+        xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+        summary_entry_t *e = cache_slot(user_id);
+        if (e) {
+            strncpy(e->etag, etag, sizeof(e->etag) - 1);
+            strncpy(e->summary, buf, sizeof(e->summary) - 1);
+            e->history_count   = history_count;
+            e->needs_summarize = false;     /* handed out with this response */
+            e->checked_us      = esp_timer_get_time();
+        }
+        xSemaphoreGive(s_cache_lock);
+    }
+
+    ESP_LOGI(TAG, "CF summary: %d bytes, needs_summarize=%d",
+             (int)strlen(buf), needs_summarize);
+}
+
+/* ── Turn ids ────────────────────────────────────────────────────────── */
+
+/*
+ * Every turn gets an id when it is staged or queued, "<boot nonce>-<n>".
+ * It travels with the turn through /turn, /save_batch and the journal, so
+ * a write the Worker applied but whose response was lost is skipped when
+ * it is sent again.
+ */
+
+static uint32_t s_boot_nonce = 0;
+static uint32_t s_turn_no    = 0;
+
+/* Reserve count consecutive turn numbers, returns the first. */
+static uint32_t turn_no_alloc(uint32_t count)
+{
+    return __atomic_fetch_add(&s_turn_no, count, __ATOMIC_RELAXED) + 1;
+}
+
+static void turn_id_format(uint32_t turn_no, char *buf, size_t size)
+{
+    snprintf(buf, size, "%08lx-%lu", (unsigned long)s_boot_nonce, (unsigned long)turn_no);
+}
+
+/* ── Staged turns ────────────────────────────────────────────────────── */
+
+/*
+ * The finished exchange (and a freshly generated summary, if any) is held
+ * here instead of being written right away. The next cf_get_summary() for
+ * the same user that has to go to the network anyway sends it along in one
+ * POST /turn, which saves it and returns the current summary. Anything not
+ * picked up within ATOM_CF_TURN_HOLD_MS, or displaced before it was, goes
+ * to the writer queue (/save_batch for the exchange, /update_summary for
+ * the summary); nothing here sends inline.
+ */
+
+typedef struct {
+    char     user_id[64];
+    char    *user_text;         /* msg_text reference, NULL = no exchange staged */
+    char    *assistant_text;    /* msg_text reference */
+    uint32_t timestamp;
+    uint32_t turn_no;           /* user turn; the assistant turn is turn_no + 1 */
+    char    *summary;           /* msg_text reference, NULL = no summary staged */
+    int64_t  staged_us;         /* 0 = unused slot */
+} staged_turn_t;
+
+static staged_turn_t     s_stage[ATOM_CF_TURN_STAGE_SLOTS];
+static SemaphoreHandle_t s_stage_lock = NULL;
+
+static void save_enqueue(cf_journal_type_t type, const char *user_id, const char *role,
+                         char *content, uint32_t timestamp, uint32_t turn_no);
+
+/* Caller must hold s_stage_lock. */
+static staged_turn_t *stage_find(const char *user_id, bool alloc)
+{
+    staged_turn_t *free_slot = NULL;
+    for (int i = 0; i < ATOM_CF_TURN_STAGE_SLOTS; i++) {
+        staged_turn_t *st = &s_stage[i];
+        if (st->staged_us && strcmp(st->user_id, user_id) == 0) return st;
+        if (!free_slot && !st->staged_us) free_slot = st;
+    }
+    if (alloc && free_slot) {
+        strncpy(free_slot->user_id, user_id, sizeof(free_slot->user_id) - 1);
+        free_slot->user_id[sizeof(free_slot->user_id) - 1] = '\0';
+        free_slot->staged_us = esp_timer_get_time();
+    }
+    return alloc ? free_slot : NULL;
+}
+
+/* Move a slot's contents to out and free the slot. Caller must hold s_stage_lock. */
+static void stage_detach(staged_turn_t *st, staged_turn_t *out)
+{
+    *out = *st;
+    memset(st, 0, sizeof(*st));
+}
+
+/* Hand a detached entry to the writer queue, which takes over its references. */
+static void stage_write_out(staged_turn_t *st)
+{
+    if (st->user_text) {
+        save_enqueue(CF_JOURNAL_SAVE, st->user_id, "user",      st->user_text,
+                     st->timestamp, st->turn_no);
+        save_enqueue(CF_JOURNAL_SAVE, st->user_id, "assistant", st->assistant_text,
+                     st->timestamp + 1, st->turn_no + 1);
+    }
+    if (st->summary) {
+        save_enqueue(CF_JOURNAL_SUMMARY, st->user_id, NULL, st->summary, 0, 0);
+    }
+}
+
+/* Put a detached entry back after a failed /turn; the writer flushes it
+ * later. Falls back to writing it out if the user staged something new. */
+static void stage_put_back(staged_turn_t *st)
+{
+    bool kept = false;
+    xSemaphoreTake(s_stage_lock, portMAX_DELAY);
+    staged_turn_t *slot = stage_find(st->user_id, true);
+    if (slot && !slot->user_text && !slot->summary) {
+        *slot = *st;
+        kept = true;
+    }
+    xSemaphoreGive(s_stage_lock);
+    if (!kept) stage_write_out(st);
+}
+
+/* Writer task: flush entries nobody picked up in time. */
+static void stage_flush_expired(void)
+{
+    int64_t now = esp_timer_get_time();
+    for (int i = 0; i < ATOM_CF_TURN_STAGE_SLOTS; i++) {
+        staged_turn_t st = {0};
+        xSemaphoreTake(s_stage_lock, portMAX_DELAY);
+        if (s_stage[i].staged_us &&
+            now - s_stage[i].staged_us >= (int64_t)ATOM_CF_TURN_HOLD_MS * 1000) {
+            stage_detach(&s_stage[i], &st);
+        }
+        xSemaphoreGive(s_stage_lock);
+        if (st.staged_us) stage_write_out(&st);
+    }
+}
+
+void cf_stage_turn(const char *user_id, char *user_text,
+                   char *assistant_text, uint32_t timestamp)
+{
+    if (!timestamp) timestamp = (uint32_t)time(NULL);
+    char *ut = user_text      ? msg_text_ref(user_text)      : msg_text_dup("");
+    char *at = assistant_text ? msg_text_ref(assistant_text) : msg_text_dup("");
+    uint32_t turn_no = turn_no_alloc(2);
+    if (!s_stage_lock) {
+        save_enqueue(CF_JOURNAL_SAVE, user_id, "user",      ut, timestamp,     turn_no);
+        save_enqueue(CF_JOURNAL_SAVE, user_id, "assistant", at, timestamp + 1, turn_no + 1);
+        return;
+    }
+
+    staged_turn_t prev = {0};
+    bool staged = false;
+
+    xSemaphoreTake(s_stage_lock, portMAX_DELAY);
+    staged_turn_t *st = (ut && at) ? stage_find(user_id, true) : NULL;
+    if (st) {
+        /* An older exchange still waiting goes out through the writer */
+        if (st->user_text) {
+            strcpy(prev.user_id, st->user_id);
+            prev.user_text      = st->user_text;
+            prev.assistant_text = st->assistant_text;
+            prev.timestamp      = st->timestamp;
+            prev.turn_no        = st->turn_no;
+        }
+        st->user_text      = ut;
+        st->assistant_text = at;
+        st->timestamp      = timestamp;
+        st->turn_no        = turn_no;
+        staged = true;
+    }
+    xSemaphoreGive(s_stage_lock);
+
+    if (prev.user_text) stage_write_out(&prev);
+    if (!staged) {
+        /* No free slot: save directly */
+        save_enqueue(CF_JOURNAL_SAVE, user_id, "user",      ut, timestamp,     turn_no);
+        save_enqueue(CF_JOURNAL_SAVE, user_id, "assistant", at, timestamp + 1, turn_no + 1);
+    }
+}
+
+void cf_stage_summary(const char *user_id, const char *summary)
+{
+    if (!user_id || !summary) return;
+
+    /* The cached copy reflects it immediately */
+    if (s_cache_lock) {
+        xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+        summary_entry_t *e = cache_find(user_id);
+        if (e) {
+            strncpy(e->summary, summary, sizeof(e->summary) - 1);
+            e->summary[sizeof(e->summary) - 1] = '\0';
+            e->needs_summarize = false;
+        }
+        xSemaphoreGive(s_cache_lock);
+    }
+
+    char *dup = msg_text_dup(summary);
+    if (dup && s_stage_lock) {
+        char *old = NULL;
+        xSemaphoreTake(s_stage_lock, portMAX_DELAY);
+        staged_turn_t *st = stage_find(user_id, true);
+        if (st) {
+            old = st->summary;
+            st->summary = dup;
+            dup = NULL;
+        }
+        xSemaphoreGive(s_stage_lock);
+        msg_text_unref(old);
+    }
+    /* No slot: the writer sends it */
+    save_enqueue(CF_JOURNAL_SUMMARY, user_id, NULL, dup, 0, 0);
+}
+
+/* POST /turn with the staged entry; fills buf/result like GET /summary. */
+static esp_err_t post_turn(const staged_turn_t *st, char *buf, size_t buf_size,
+                           cf_summary_result_t *result)
+{
+    cJSON *body  = cJSON_CreateObject();
+    cJSON_AddStringToObject(body, "user_id", st->user_id);
+    cJSON *turns = cJSON_AddArrayToObject(body, "turns");
+    if (st->user_text) {
+        const char *roles[2] = { "user", "assistant" };
+        const char *texts[2] = { st->user_text, st->assistant_text };
+        for (int i = 0; i < 2; i++) {
+            char id[CF_TURN_ID_LEN];
+            turn_id_format(st->turn_no + i, id, sizeof(id));
+            cJSON *t = cJSON_CreateObject();
+            cJSON_AddStringToObject(t, "id",        id);
+            cJSON_AddStringToObject(t, "role",      roles[i]);
+            cJSON_AddStringToObject(t, "content",   texts[i]);
+            cJSON_AddNumberToObject(t, "timestamp", (double)(st->timestamp + i));
+            cJSON_AddItemToArray(turns, t);
+        }
+    }
+    if (st->summary) cJSON_AddStringToObject(body, "summary", st->summary);
+    char *body_str = cJSON_PrintUnformatted(body);
+    cJSON_Delete(body);
+    if (!body_str) return ESP_ERR_NO_MEM;
+
+    char *raw = calloc(1, buf_size);
+    if (!raw) { cJSON_free(body_str); return ESP_ERR_NO_MEM; }
+    http_buf_t rb = { .buf = raw, .size = buf_size, .pos = 0 };
+
+    char url[160];
+    snprintf(url, sizeof(url), "%s%s", s_worker_url, ATOM_CF_TURN_PATH);
+
+    esp_http_client_config_t cfg = {
+        .url               = url,
+        .method            = HTTP_METHOD_POST,
+        .timeout_ms        = ATOM_CF_TIMEOUT_MS,
+        .crt_bundle_attach = esp_crt_bundle_attach,
+        .event_handler     = http_event_handler,
+        .user_data         = &rb,
+    };
+    esp_http_client_handle_t client = esp_http_client_init(&cfg);
+    if (!client) { free(raw); cJSON_free(body_str); return ESP_FAIL; }
+
+    esp_http_client_set_header(client, "Content-Type", "application/json");
+    if (s_auth_token[0]) {
+        char bearer[80];
+        snprintf(bearer, sizeof(bearer), "Bearer %s", s_auth_token);
+        esp_http_client_set_header(client, "Authorization", bearer);
+    }
+    esp_http_client_set_post_field(client, body_str, strlen(body_str));
+
+    esp_err_t ret = esp_http_client_perform(client);
+    int status    = esp_http_client_get_status_code(client);
+    esp_http_client_cleanup(client);
+    cJSON_free(body_str);
+
+    if (ret != ESP_OK || status != 200) {
+        ESP_LOGW(TAG, "CF turn: err=%s HTTP=%d", esp_err_to_name(ret), status);
+        free(raw);
+        return ESP_FAIL;
+    }
+
+    summary_store(st->user_id, raw, rb.etag, buf, buf_size, result);
+    free(raw);
+    return ESP_OK;
+}
+
 /* ── Summary fetch ───────────────────────────────────────────────────── */
 
 esp_err_t cf_get_summary(const char *user_id, char *buf, size_t buf_size,
@@ -53,6 +461,60 @@ esp_err_t cf_get_summary(const char *user_id, char *buf, size_t buf_size,
         return ESP_OK;
     }
 
+    /* Fresh cache entry: no network at all */
+    char etag[32] = "";
+    if (s_cache_lock) {
+        xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+        summary_entry_t *e = cache_find(user_id);
+        if (e && esp_timer_get_time() - e->checked_us < (int64_t)ATOM_CF_SUMMARY_TTL_MS * 1000) {
+            cache_copy_out(e, buf, buf_size, result);
+            xSemaphoreGive(s_cache_lock);
+            ESP_LOGI(TAG, "CF summary: cache hit (%d bytes)", (int)strlen(buf));
+            return ESP_OK;
+        }
+        if (e) strcpy(etag, e->etag);
+        xSemaphoreGive(s_cache_lock);
+    }
+
+    /* Something staged for this user: save it and fetch in one request.
+     * Not while older writes are journaled: the writer journals the staged
+     * turn behind them instead, so KV sees them in order. */
+    if (s_stage_lock && !cf_journal_pending()) {
+        staged_turn_t st = {0};
+        xSemaphoreTake(s_stage_lock, portMAX_DELAY);
+        staged_turn_t *slot = stage_find(user_id, false);
+        if (slot) stage_detach(slot, &st);
+        xSemaphoreGive(s_stage_lock);
+
+        if (st.staged_us) {
+            if (post_turn(&st, buf, buf_size, result) == ESP_OK) {
+                msg_text_unref(st.user_text);
+                msg_text_unref(st.assistant_text);
+                msg_text_unref(st.summary);
+                return ESP_OK;
+            }
+            stage_put_back(&st);
+
+            /* Serve what we have rather than nothing; with no entry, try a
+             * plain GET (a Worker without /turn still answers it) */
+            bool served = false;
+            if (s_cache_lock) {
+                xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+                summary_entry_t *e = cache_find(user_id);
+                if (e) {
+                    cache_copy_out(e, buf, buf_size, result);
+                    served = true;
+                }
+                xSemaphoreGive(s_cache_lock);
+            }
+            if (served) {
+                ESP_LOGW(TAG, "CF turn failed, serving cached summary (%d bytes)",
+                         (int)strlen(buf));
+                return ESP_OK;
+            }
+        }
+    }
+
     char url[192];
     snprintf(url, sizeof(url), "%s%s?user_id=%s",
              s_worker_url, ATOM_CF_SUMMARY_PATH, user_id);
@@ -79,135 +541,315 @@ esp_err_t cf_get_summary(const char *user_id, char *buf, size_t buf_size,
         snprintf(bearer, sizeof(bearer), "Bearer %s", s_auth_token);
         esp_http_client_set_header(client, "Authorization", bearer);
     }
+    if (etag[0]) {
+        esp_http_client_set_header(client, "If-None-Match", etag);
+    }
 
     esp_err_t ret = esp_http_client_perform(client);
     int status    = esp_http_client_get_status_code(client);
     esp_http_client_cleanup(client);
 
+    if (ret == ESP_OK && status == 304 && s_cache_lock) {
+        free(raw);
+        xSemaphoreTake(s_cache_lock, portMAX_DELAY);
+        summary_entry_t *e = cache_find(user_id);
+        if (e) {
+            e->checked_us = esp_timer_get_time();
+            cache_copy_out(e, buf, buf_size, result);
+        }
+        xSemaphoreGive(s_cache_lock);
+        ESP_LOGI(TAG, "CF summary: not modified (%d bytes)", (int)strlen(buf));
+        return ESP_OK;
+    }
+
     if (ret != ESP_OK || status != 200) {
         ESP_LOGW(TAG, "CF summary fetch: err=%s HTTP=%d", esp_err_to_name(ret), status);
         free(raw);
         return ESP_FAIL;
     }
 
-    /* Parse { summary, needs_summarize, history_count } */
-    cJSON *root = cJSON_Parse(raw);
+    summary_store(user_id, raw, rb.etag, buf, buf_size, result);
     free(raw);
-
-    if (root) {
-        cJSON *js = cJSON_GetObjectItem(root, "summary");
-        if (js && js->valuestring) {
-            strncpy(buf, js->valuestring, buf_size - 1);
-            buf[buf_size - 1] = '\0';
-        }
-        if (result) {
-            cJSON *jns = cJSON_GetObjectItem(root, "needs_summarize");
-            cJSON *jhc = cJSON_GetObjectItem(root, "history_count");
-            if (jns) result->needs_summarize = cJSON_IsTrue(jns);
-            if (jhc) result->history_count   = jhc->valueint;
-        }
-        cJSON_Delete(root);
-    }
-
-    ESP_LOGI(TAG, "CF summary: %d bytes, needs_summarize=%d",
-             (int)strlen(buf), result ? result->needs_summarize : 0);
     return ESP_OK;
 }
 
-/* ── Async save task ─────────────────────────────────────────────────── */
+/* ── Batched save writer ─────────────────────────────────────────────── */
+
+/*
+ * cf_save_async() only enqueues. One persistent writer task drains the queue:
+ * after the first turn arrives it waits ATOM_CF_SAVE_BATCH_WINDOW_MS for more
+ * (the assistant turn, other users' turns), then sends them all in a single
+ * POST /save_batch. The HTTP client is kept open between batches so the TLS
+ * session to the Worker is reused. Summaries flushed from the stage share
+ * the queue and go out as /update_summary in queue order.
+ */
 
 typedef struct {
-    char user_id[32];
-    char role[16];
-    char *content;      /* heap-allocated, task frees it */
-    uint32_t timestamp;
-} save_task_args_t;
+    cf_journal_type_t type;
+    char user_id[64];
+    char role[16];      /* SAVE only */
+    char turn_id[CF_TURN_ID_LEN];   /* SAVE only, "" = none (old journal records) */
+    char *content;      /* msg_text reference (turn or summary), writer releases it */
+    uint32_t timestamp; /* SAVE only */
+} save_item_t;
+
+static esp_err_t update_summary_send(const char *user_id, const char *summary);
+
+static QueueHandle_t s_save_queue = NULL;
+static esp_http_client_handle_t s_save_client = NULL;
+static char       s_save_resp_buf[1024];
+static http_buf_t s_save_resp = { .buf = s_save_resp_buf, .size = sizeof(s_save_resp_buf) };
+
+/* Refresh cached summaries from { users: { id: { etag, history_count, needs_summarize } } } */
+static void apply_batch_response(const char *json)
+{
+    cJSON *root  = cJSON_Parse(json);
+    cJSON *users = root ? cJSON_GetObjectItem(root, "users") : NULL;
+    cJSON *u;
+    cJSON_ArrayForEach(u, users) {
+        cJSON *je  = cJSON_GetObjectItem(u, "etag");
+        cJSON *jhc = cJSON_GetObjectItem(u, "history_count");
+        cJSON *jns = cJSON_GetObjectItem(u, "needs_summarize");
+        if (!je || !je->valuestring || !jhc) continue;
+        cache_apply_write(u->string, je->valuestring, jhc->valueint,
+                          cJSON_IsTrue(jns), NULL);
+    }
+    cJSON_Delete(root);
+}
 
-static void save_task(void *arg)
+static char *build_batch_body(const save_item_t *items, int count)
 {
-    save_task_args_t *a = (save_task_args_t *)arg;
+    cJSON *body  = cJSON_CreateObject();
+    cJSON *arr   = cJSON_AddArrayToObject(body, "items");
+    for (int i = 0; i < count; i++) {
+        cJSON *it = cJSON_CreateObject();
+        if (items[i].turn_id[0]) cJSON_AddStringToObject(it, "id", items[i].turn_id);
+        cJSON_AddStringToObject(it, "user_id",   items[i].user_id);
+        cJSON_AddStringToObject(it, "role",      items[i].role);
+        cJSON_AddStringToObject(it, "content",   items[i].content);
+        cJSON_AddNumberToObject(it, "timestamp", (double)items[i].timestamp);
+        cJSON_AddItemToArray(arr, it);
+    }
+    char *body_str = cJSON_PrintUnformatted(body);
+    cJSON_Delete(body);
+    return body_str;
+}
 
-    if (s_worker_url[0] == '\0') {
-        ESP_LOGD(TAG, "No CF Worker URL, skipping save");
-        goto done;
+static esp_err_t send_batch(const char *body_str)
+{
+    if (!s_save_client) {
+        char url[160];
+        snprintf(url, sizeof(url), "%s%s", s_worker_url, ATOM_CF_SAVE_BATCH_PATH);
+
+        esp_http_client_config_t cfg = {
+            .url               = url,
+            .method            = HTTP_METHOD_POST,
+            .timeout_ms        = ATOM_CF_TIMEOUT_MS,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+            .keep_alive_enable = true,
+            .event_handler     = http_event_handler,
+            .user_data         = &s_save_resp,
+        };
+        s_save_client = esp_http_client_init(&cfg);
+        if (!s_save_client) return ESP_FAIL;
+
+        esp_http_client_set_header(s_save_client, "Content-Type", "application/json");
+        if (s_auth_token[0]) {
+            char bearer[80];
+            snprintf(bearer, sizeof(bearer), "Bearer %s", s_auth_token);
+            esp_http_client_set_header(s_save_client, "Authorization", bearer);
+        }
     }
 
-    /* Build URL */
-    char url[160];
-    snprintf(url, sizeof(url), "%s%s", s_worker_url, ATOM_CF_SAVE_PATH);
+    s_save_resp.pos = 0;
+    s_save_resp.buf[0] = '\0';
+    esp_http_client_set_post_field(s_save_client, body_str, strlen(body_str));
+    esp_err_t ret = esp_http_client_perform(s_save_client);
+    if (ret == ESP_OK) {
+        int st = esp_http_client_get_status_code(s_save_client);
+        ESP_LOGD(TAG, "CF save_batch HTTP %d", st);
+        if (st < 200 || st >= 300) ret = ESP_FAIL;
+        else apply_batch_response(s_save_resp.buf);
+    }
+    if (ret != ESP_OK) {
+        /* Drop the connection; the next batch starts fresh */
+        esp_http_client_cleanup(s_save_client);
+        s_save_client = NULL;
+    }
+    return ret;
+}
 
-    /* Build JSON body */
-    cJSON *body = cJSON_CreateObject();
-    cJSON_AddStringToObject(body, "user_id",   a->user_id);
-    cJSON_AddStringToObject(body, "role",      a->role);
-    cJSON_AddStringToObject(body, "content",   a->content);
-    cJSON_AddNumberToObject(body, "timestamp", (double)a->timestamp);
-    char *body_str = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+/* Next time the journal may be replayed (esp_timer us) */
+static int64_t s_replay_due_us = 0;
 
-    if (!body_str) goto done;
+/* Send one step of journaled writes: the leading run of turns as one
+ * batch, or a single summary. Paced so a backlog drains steadily. */
+static void journal_replay(void)
+{
+    if (!cf_journal_pending() || esp_timer_get_time() < s_replay_due_us) return;
 
-    esp_http_client_config_t cfg = {
-        .url               = url,
-        .method            = HTTP_METHOD_POST,
-        .timeout_ms        = ATOM_CF_TIMEOUT_MS,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-    };
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    if (!client) { free(body_str); goto done; }
+    cf_journal_rec_t recs[ATOM_CF_SAVE_BATCH_MAX];
+    int n = cf_journal_peek(recs, ATOM_CF_SAVE_BATCH_MAX);
+    int done = 0;
+    uint32_t through = 0;   /* drop by sequence number: appends may evict meanwhile */
+    esp_err_t ret = ESP_OK;
 
-    esp_http_client_set_header(client, "Content-Type", "application/json");
-    if (s_auth_token[0]) {
-        char bearer[80];
-        snprintf(bearer, sizeof(bearer), "Bearer %s", s_auth_token);
-        esp_http_client_set_header(client, "Authorization", bearer);
+    if (n > 0 && recs[0].type == CF_JOURNAL_SUMMARY) {
+        if (recs[0].text) ret = update_summary_send(recs[0].user_id, recs[0].text);
+        done = 1;
+    } else {
+        save_item_t items[ATOM_CF_SAVE_BATCH_MAX];
+        int count = 0;
+        for (; done < n && recs[done].type != CF_JOURNAL_SUMMARY; done++) {
+            cf_journal_rec_t *r = &recs[done];
+            if (r->type != CF_JOURNAL_SAVE || !r->text) continue;   /* corrupt line */
+            memset(&items[count], 0, sizeof(items[count]));
+            items[count].type = CF_JOURNAL_SAVE;
+            strcpy(items[count].user_id, r->user_id);
+            strcpy(items[count].role, r->role);
+            strcpy(items[count].turn_id, r->turn_id);
+            items[count].content   = r->text;    /* borrowed, freed with recs */
+            items[count].timestamp = r->timestamp;
+            count++;
+        }
+        if (count > 0) {
+            char *body_str = build_batch_body(items, count);
+            ret = body_str ? send_batch(body_str) : ESP_ERR_NO_MEM;
+            cJSON_free(body_str);
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        if (i < done && recs[i].seq > through) through = recs[i].seq;
+        cf_journal_rec_free(&recs[i]);
     }
-    esp_http_client_set_post_field(client, body_str, strlen(body_str));
 
-    esp_err_t ret = esp_http_client_perform(client);
     if (ret == ESP_OK) {
-        int st = esp_http_client_get_status_code(client);
-        ESP_LOGD(TAG, "CF save HTTP %d", st);
+        cf_journal_drop(through);
+        ESP_LOGI(TAG, "CF journal: replayed %d record(s)", done);
+        s_replay_due_us = esp_timer_get_time() + (int64_t)ATOM_CF_JOURNAL_REPLAY_GAP_MS * 1000;
     } else {
-        ESP_LOGW(TAG, "CF save failed: %s", esp_err_to_name(ret));
+        s_replay_due_us = esp_timer_get_time() + (int64_t)ATOM_CF_JOURNAL_RETRY_MS * 1000;
     }
+}
 
-    esp_http_client_cleanup(client);
-    free(body_str);
+/* Send one run of turns (/save_batch) or one summary (/update_summary);
+ * journal them if the Worker cannot be reached, or behind an existing
+ * backlog so they reach KV after it. */
+static void write_items(const save_item_t *items, int count)
+{
+    esp_err_t ret;
+    if (cf_journal_pending()) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (items[0].type == CF_JOURNAL_SUMMARY) {
+        ret = update_summary_send(items[0].user_id, items[0].content);
+    } else {
+        char *body_str = build_batch_body(items, count);
+        ret = body_str ? send_batch(body_str) : ESP_ERR_NO_MEM;
+        cJSON_free(body_str);
+    }
 
-done:
-    free(a->content);
-    free(a);
-    vTaskDelete(NULL);
+    if (ret == ESP_OK) {
+        /* Worker reachable again: replay any backlog right away */
+        s_replay_due_us = 0;
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        cf_journal_append(items[i].type, items[i].user_id, items[i].role,
+                          items[i].turn_id, items[i].content, items[i].timestamp);
+    }
+    if (ret == ESP_ERR_INVALID_STATE) {
+        ESP_LOGD(TAG, "CF journal backlog, queued %d record(s) behind it", count);
+        return;
+    }
+    ESP_LOGW(TAG, "CF write (%d record(s)) failed: %s, journaling",
+             count, esp_err_to_name(ret));
+    s_replay_due_us = esp_timer_get_time() + (int64_t)ATOM_CF_JOURNAL_RETRY_MS * 1000;
 }
 
-void cf_save_async(const char *user_id, const char *role,
-                   const char *content, uint32_t timestamp)
+static void save_writer_task(void *arg)
 {
-    save_task_args_t *a = calloc(1, sizeof(save_task_args_t));
-    if (!a) return;
+    save_item_t items[ATOM_CF_SAVE_BATCH_MAX];
+
+    while (1) {
+        stage_flush_expired();
+        journal_replay();
 
-    strncpy(a->user_id, user_id, sizeof(a->user_id) - 1);
-    strncpy(a->role, role, sizeof(a->role) - 1);
-    a->content   = strdup(content ? content : "");
-    a->timestamp = timestamp ? timestamp : (uint32_t)time(NULL);
+        TickType_t idle = pdMS_TO_TICKS(ATOM_CF_TURN_HOLD_MS / 4);
+        if (cf_journal_pending()) {
+            int64_t left_ms = (s_replay_due_us - esp_timer_get_time()) / 1000;
+            if (left_ms < 0) left_ms = 0;
+            if (pdMS_TO_TICKS(left_ms) < idle) idle = pdMS_TO_TICKS(left_ms);
+        }
+        if (xQueueReceive(s_save_queue, &items[0], idle) != pdTRUE) continue;
+        int count = 1;
+
+        /* Coalesce whatever arrives within the batch window */
+        TickType_t until = xTaskGetTickCount() + pdMS_TO_TICKS(ATOM_CF_SAVE_BATCH_WINDOW_MS);
+        while (count < ATOM_CF_SAVE_BATCH_MAX) {
+            TickType_t now  = xTaskGetTickCount();
+            TickType_t wait = (int32_t)(until - now) > 0 ? until - now : 0;
+            if (xQueueReceive(s_save_queue, &items[count], wait) != pdTRUE) break;
+            count++;
+        }
 
-    if (!a->content) { free(a); return; }
+        /* In queue order: each run of turns as one batch, summaries singly */
+        for (int i = 0; i < count; ) {
+            int end = i + 1;
+            if (items[i].type == CF_JOURNAL_SAVE) {
+                while (end < count && items[end].type == CF_JOURNAL_SAVE) end++;
+            }
+            write_items(&items[i], end - i);
+            i = end;
+        }
 
-    BaseType_t ret = xTaskCreate(save_task, "cf_save", 4096, a, 3, NULL);
-    if (ret != pdPASS) {
-        ESP_LOGW(TAG, "Failed to create cf_save task");
-        free(a->content);
-        free(a);
+        for (int i = 0; i < count; i++) msg_text_unref(items[i].content);
     }
 }
 
-/* ── Update summary (ESP32-generated) ───────────────────────────────── */
+/* Queue a turn or summary for the writer. Consumes the caller's reference
+ * to content (a msg_text) whether or not it is queued. turn_no 0 gives a
+ * turn a new id. */
+static void save_enqueue(cf_journal_type_t type, const char *user_id, const char *role,
+                         char *content, uint32_t timestamp, uint32_t turn_no)
+{
+    if (!content) return;
+    if (!s_save_queue) {
+        ESP_LOGD(TAG, "No CF Worker URL, skipping save");
+        msg_text_unref(content);
+        return;
+    }
 
-esp_err_t cf_update_summary(const char *user_id, const char *summary)
+    save_item_t item = { .type = type };
+    strncpy(item.user_id, user_id, sizeof(item.user_id) - 1);
+    if (role) strncpy(item.role, role, sizeof(item.role) - 1);
+    item.content = content;
+    if (type == CF_JOURNAL_SAVE) {
+        item.timestamp = timestamp ? timestamp : (uint32_t)time(NULL);
+        turn_id_format(turn_no ? turn_no : turn_no_alloc(1), item.turn_id, sizeof(item.turn_id));
+    }
+
+    if (xQueueSend(s_save_queue, &item, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "CF save queue full, dropping %s",
+                 type == CF_JOURNAL_SUMMARY ? "summary" : "turn");
+        msg_text_unref(item.content);
+    }
+}
+
+void cf_save_async(const char *user_id, const char *role,
+                   const char *content, uint32_t timestamp)
 {
-    if (!user_id || !summary || s_worker_url[0] == '\0') return ESP_OK;
+    if (!s_save_queue) {
+        ESP_LOGD(TAG, "No CF Worker URL, skipping save");
+        return;
+    }
+    save_enqueue(CF_JOURNAL_SAVE, user_id, role, msg_text_dup(content ? content : ""), timestamp, 0);
+}
 
+/* ── Update summary (ESP32-generated) ───────────────────────────────── */
+
+static esp_err_t update_summary_send(const char *user_id, const char *summary)
+{
     char url[192];
     snprintf(url, sizeof(url), "%s/update_summary", s_worker_url);
 
@@ -218,14 +860,19 @@ esp_err_t cf_update_summary(const char *user_id, const char *summary)
     cJSON_Delete(body);
     if (!body_str) return ESP_ERR_NO_MEM;
 
+    char resp_buf[128] = "";
+    http_buf_t rb = { .buf = resp_buf, .size = sizeof(resp_buf), .pos = 0 };
+
     esp_http_client_config_t cfg = {
         .url               = url,
         .method            = HTTP_METHOD_POST,
         .timeout_ms        = ATOM_CF_TIMEOUT_MS,
         .crt_bundle_attach = esp_crt_bundle_attach,
+        .event_handler     = http_event_handler,
+        .user_data         = &rb,
     };
     esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    if (!client) { free(body_str); return ESP_FAIL; }
+    if (!client) { cJSON_free(body_str); return ESP_FAIL; }
 
     esp_http_client_set_header(client, "Content-Type", "application/json");
     if (s_auth_token[0]) {
@@ -236,13 +883,39 @@ esp_err_t cf_update_summary(const char *user_id, const char *summary)
     esp_http_client_set_post_field(client, body_str, strlen(body_str));
 
     esp_err_t ret = esp_http_client_perform(client);
+    if (ret == ESP_OK) {
+        int st = esp_http_client_get_status_code(client);
+        if (st < 200 || st >= 300) ret = ESP_FAIL;
+    }
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "CF summary updated (%d bytes)", (int)strlen(summary));
+        /* Response: { ok, etag } — keep the cached copy current */
+        cJSON *root = cJSON_Parse(resp_buf);
+        cJSON *je   = root ? cJSON_GetObjectItem(root, "etag") : NULL;
+        if (je && je->valuestring) {
+            cache_apply_write(user_id, je->valuestring, -1, false, summary);
+        }
+        cJSON_Delete(root);
     } else {
         ESP_LOGW(TAG, "CF update_summary failed: %s", esp_err_to_name(ret));
     }
     esp_http_client_cleanup(client);
-    free(body_str);
+    cJSON_free(body_str);
+    return ret;
+}
+
+esp_err_t cf_update_summary(const char *user_id, const char *summary)
+{
+    if (!user_id || !summary || s_worker_url[0] == '\0') return ESP_OK;
+
+    /* Behind any backlog, which may hold older turns or summaries */
+    if (cf_journal_pending()) {
+        return cf_journal_append(CF_JOURNAL_SUMMARY, user_id, NULL, NULL, summary, 0);
+    }
+    esp_err_t ret = update_summary_send(user_id, summary);
+    if (ret != ESP_OK) {
+        cf_journal_append(CF_JOURNAL_SUMMARY, user_id, NULL, NULL, summary, 0);
+    }
     return ret;
 }
 
@@ -269,5 +942,35 @@ esp_err_t cf_history_init(void)
 
     ESP_LOGI(TAG, "CF history init. Worker URL: %s",
              s_worker_url[0] ? s_worker_url : "(not configured)");
+
+    if (s_worker_url[0] == '\0') return ESP_OK;
+
+    s_boot_nonce = esp_random();
+    cf_journal_init();
+
+    /* Summary cache: PSRAM preferred, internal RAM fallback */
+    s_cache = heap_caps_calloc(ATOM_CF_SUMMARY_CACHE_SLOTS, sizeof(summary_entry_t),
+                               MALLOC_CAP_SPIRAM);
+    if (!s_cache) {
+        s_cache = calloc(ATOM_CF_SUMMARY_CACHE_SLOTS, sizeof(summary_entry_t));
+    }
+    s_cache_lock = s_cache ? xSemaphoreCreateMutex() : NULL;
+    if (!s_cache_lock) {
+        ESP_LOGW(TAG, "Summary cache unavailable, fetching every turn");
+        free(s_cache);
+        s_cache = NULL;
+    }
+
+    s_save_queue = xQueueCreate(ATOM_CF_SAVE_QUEUE_LEN, sizeof(save_item_t));
+    if (!s_save_queue) return ESP_ERR_NO_MEM;
+    s_stage_lock = xSemaphoreCreateMutex();
+    if (!s_stage_lock) return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate(save_writer_task, "cf_save", ATOM_CF_SAVE_STACK, NULL,
+                    ATOM_CF_SAVE_PRIO, NULL) != pdPASS) {
+        ESP_LOGW(TAG, "Failed to create cf_save writer task");
+        vQueueDelete(s_save_queue);
+        s_save_queue = NULL;
+    }
     return ESP_OK;
 }
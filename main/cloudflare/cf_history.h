@@ -15,10 +15,14 @@
  *
  * Provides:
  *   - Summary fetch:    GET  /summary?user_id=...
- *   - History save:     POST /save  (fire-and-forget, async)
+ *   - Turn:             POST /turn  (staged exchange + summary in, summary out)
+ *   - History save:     POST /save_batch  (fire-and-forget, batched)
  *   - Summary update:   POST /update_summary  (ESP32が生成した要約を保存)
  *
- * On failure: logs a warning and continues — no retry, no crash.
+ * On failure: writes are journaled to SPIFFS (cf_journal.h) and replayed
+ * by the writer task; while a backlog remains, new writes are journaled
+ * behind it so KV sees them in order. Summary fetches log a warning and
+ * continue.
  */
 
 /**
@@ -47,6 +51,13 @@ typedef struct {
 /**
  * Fetch the conversation summary for a user.
  *
+ * Served from the per-user cache when the entry is younger than
+ * ATOM_CF_SUMMARY_TTL_MS. Otherwise, if an exchange or summary is staged
+ * for the user, one POST /turn saves it and returns the summary; if not,
+ * the cached entry is revalidated with If-None-Match. When /turn fails the
+ * staged entry stays for the writer, and the cached entry (any age) is
+ * served, or fetched with GET /summary if there is none.
+ *
  * @param user_id   Discord user ID string.
  * @param buf       Output buffer for the summary text.
  * @param buf_size  Size of buf.
@@ -59,8 +70,9 @@ esp_err_t cf_get_summary(const char *user_id, char *buf, size_t buf_size,
 /**
  * Asynchronously save a conversation turn.
  *
- * Creates a short-lived FreeRTOS task that posts to /save and exits.
- * Caller is NOT blocked; failure is silently ignored.
+ * Queues the turn for the writer task, which coalesces turns arriving
+ * close together into one POST /save_batch.
+ * Caller is NOT blocked; failure (or a full queue) is logged and ignored.
  *
  * @param user_id    Discord user ID.
  * @param role       "user" or "assistant".
@@ -70,6 +82,28 @@ esp_err_t cf_get_summary(const char *user_id, char *buf, size_t buf_size,
 void cf_save_async(const char *user_id, const char *role,
                    const char *content, uint32_t timestamp);
 
+/**
+ * Stage a finished exchange for the user's next /turn.
+ *
+ * Not sent immediately: the next cf_get_summary() for this user that needs
+ * the network carries it. If none comes within ATOM_CF_TURN_HOLD_MS the
+ * writer task saves it via /save_batch. Caller is NOT blocked.
+ *
+ * Both texts must be msg_text buffers (bus/message_bus.h); a reference is
+ * taken on each instead of copying them, the caller keeps its own.
+ *
+ * @param timestamp  Unix time of the user turn (assistant = +1). 0 = now.
+ */
+void cf_stage_turn(const char *user_id, char *user_text,
+                   char *assistant_text, uint32_t timestamp);
+
+/**
+ * Stage an ESP32-generated summary for the user's next /turn.
+ * Updates the cached summary right away; when no staging slot is free the
+ * writer task sends it (/update_summary). Caller is NOT blocked.
+ */
+void cf_stage_summary(const char *user_id, const char *summary);
+
 /**
  * Push an ESP32-generated summary to Cloudflare KV.
  *
@@ -77,6 +111,7 @@ void cf_save_async(const char *user_id, const char *role,
  *
  * @param user_id  Discord user ID.
  * @param summary  ESP32のLLMが生成した要約テキスト。
- * @return ESP_OK on success.
+ * @return ESP_OK on success. On failure, or while older writes are
+ *         journaled, the summary is journaled for replay.
  */
 esp_err_t cf_update_summary(const char *user_id, const char *summary);
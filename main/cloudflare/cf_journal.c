@@ -0,0 +1,281 @@
+#include "cf_journal.h"
+#include "atom_config.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+#include "esp_log.h"
+#include "cJSON.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "cf_journal";
+
+#define JOURNAL_TMP_FILE  ATOM_CF_JOURNAL_FILE ".tmp"
+
+static SemaphoreHandle_t s_lock = NULL;
+static long              s_size = 0;     /* bytes currently in the file */
+static uint32_t          s_next_seq = 1; /* sequence number of the next record */
+
+/* Read one line into buf. Over-long lines are consumed and returned empty.
+ * Returns false at EOF. */
+static bool read_line(FILE *f, char *buf, size_t size)
+{
+    if (!fgets(buf, size, f)) return false;
+    size_t len = strlen(buf);
+    if (len > 0 && buf[len - 1] == '\n') {
+        buf[len - 1] = '\0';
+        return true;
+    }
+    if (feof(f)) return true;
+    int c;
+    while ((c = fgetc(f)) != EOF && c != '\n') {}
+    buf[0] = '\0';
+    return true;
+}
+
+/* Every record line starts with {"n":<seq>, ; 0 = no readable number. */
+static uint32_t line_seq(const char *line)
+{
+    if (strncmp(line, "{\"n\":", 5) != 0) return 0;
+    return (uint32_t)strtoul(line + 5, NULL, 10);
+}
+
+static bool line_is_summary_of(const char *line, const char *user_id)
+{
+    if (!strstr(line, "\"t\":\"m\"")) return false;
+    cJSON *rec = cJSON_Parse(line);
+    cJSON *ju  = rec ? cJSON_GetObjectItem(rec, "u") : NULL;
+    bool match = ju && ju->valuestring && strcmp(ju->valuestring, user_id) == 0;
+    cJSON_Delete(rec);
+    return match;
+}
+
+/* Rewrite the file without the records numbered up to through_seq (and
+ * lines without a number), without the oldest lines until at most
+ * keep_bytes remain (-1 = no limit), and without summaries of
+ * summary_user (NULL = none). The file is only replaced once the copy is
+ * complete; on failure it is left as it was. Caller must hold s_lock. */
+static esp_err_t rewrite_locked(uint32_t through_seq, long keep_bytes, const char *summary_user)
+{
+    FILE *in = fopen(ATOM_CF_JOURNAL_FILE, "r");
+    if (!in) {
+        s_size = 0;
+        return ESP_OK;
+    }
+    FILE *out = fopen(JOURNAL_TMP_FILE, "w");
+    char *line = malloc(ATOM_CF_JOURNAL_LINE_MAX);
+    if (!out || !line) {
+        fclose(in);
+        if (out) fclose(out);
+        free(line);
+        remove(JOURNAL_TMP_FILE);
+        return ESP_ERR_NO_MEM;
+    }
+
+    bool ok = true;
+    long remaining = s_size;
+    long written   = 0;
+    while (ok && read_line(in, line, ATOM_CF_JOURNAL_LINE_MAX)) {
+        long len = (long)strlen(line) + 1;
+        bool drop = line_seq(line) <= through_seq ||
+                    (keep_bytes >= 0 && remaining > keep_bytes) ||
+                    (summary_user && line_is_summary_of(line, summary_user));
+        remaining -= len;
+        if (drop) continue;
+        ok = fputs(line, out) >= 0 && fputc('\n', out) != EOF;
+        written += len;
+    }
+    fclose(in);
+    free(line);
+    if (fclose(out) != 0) ok = false;
+
+    if (!ok) {
+        ESP_LOGE(TAG, "Journal rewrite failed, keeping the old file");
+        remove(JOURNAL_TMP_FILE);
+        return ESP_FAIL;
+    }
+
+    /* SPIFFS rename does not replace; init recovers the tmp file if we
+     * stop between these two calls */
+    remove(ATOM_CF_JOURNAL_FILE);
+    if (written == 0) {
+        remove(JOURNAL_TMP_FILE);
+    } else if (rename(JOURNAL_TMP_FILE, ATOM_CF_JOURNAL_FILE) != 0) {
+        ESP_LOGE(TAG, "Journal rename failed");
+        written = 0;
+    }
+    s_size = written;
+    return ESP_OK;
+}
+
+esp_err_t cf_journal_init(void)
+{
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_lock) return ESP_ERR_NO_MEM;
+
+    /* A tmp file without the journal means a rewrite stopped after removing
+     * the old file: the tmp copy is complete. With both present it stopped
+     * earlier and the tmp copy may be partial. */
+    struct stat st;
+    if (stat(JOURNAL_TMP_FILE, &st) == 0) {
+        if (stat(ATOM_CF_JOURNAL_FILE, &st) != 0 &&
+            rename(JOURNAL_TMP_FILE, ATOM_CF_JOURNAL_FILE) == 0) {
+            ESP_LOGW(TAG, "Recovered journal from interrupted rewrite");
+        } else {
+            remove(JOURNAL_TMP_FILE);
+        }
+    }
+
+    s_size = (stat(ATOM_CF_JOURNAL_FILE, &st) == 0) ? (long)st.st_size : 0;
+    if (s_size > 0) {
+        /* Continue numbering after the newest record */
+        FILE *f = fopen(ATOM_CF_JOURNAL_FILE, "r");
+        char *line = malloc(ATOM_CF_JOURNAL_LINE_MAX);
+        while (f && line && read_line(f, line, ATOM_CF_JOURNAL_LINE_MAX)) {
+            uint32_t seq = line_seq(line);
+            if (seq >= s_next_seq) s_next_seq = seq + 1;
+        }
+        if (f) fclose(f);
+        free(line);
+        ESP_LOGI(TAG, "Journal has %ld bytes waiting for replay", s_size);
+    }
+    return ESP_OK;
+}
+
+esp_err_t cf_journal_append(cf_journal_type_t type, const char *user_id,
+                            const char *role, const char *turn_id,
+                            const char *text, uint32_t timestamp)
+{
+    if (!s_lock || !user_id || !text) return ESP_ERR_INVALID_STATE;
+
+    char *clipped = strndup(text, ATOM_CF_JOURNAL_MAX_TEXT);
+    if (!clipped) return ESP_ERR_NO_MEM;
+    size_t n = strlen(clipped);
+    if (n == ATOM_CF_JOURNAL_MAX_TEXT) {
+        /* Do not leave half a UTF-8 sequence at the cut */
+        while (n > 0 && ((unsigned char)clipped[n - 1] & 0xC0) == 0x80) n--;
+        if (n > 0 && ((unsigned char)clipped[n - 1] & 0xC0) == 0xC0) n--;
+        clipped[n] = '\0';
+    }
+
+    /* Numbered and written under one lock hold, so file order is seq order
+     * and cf_journal_drop() never passes over an unsent record */
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+
+    /* "n" goes first, see line_seq() */
+    cJSON *rec = cJSON_CreateObject();
+    char t[2] = { (char)type, '\0' };
+    cJSON_AddNumberToObject(rec, "n", (double)s_next_seq);
+    cJSON_AddStringToObject(rec, "t", t);
+    cJSON_AddStringToObject(rec, "u", user_id);
+    if (type == CF_JOURNAL_SAVE) {
+        cJSON_AddStringToObject(rec, "r", role ? role : "user");
+        cJSON_AddNumberToObject(rec, "ts", (double)timestamp);
+        if (turn_id && turn_id[0]) cJSON_AddStringToObject(rec, "i", turn_id);
+    }
+    cJSON_AddStringToObject(rec, "x", clipped);
+    free(clipped);
+    char *line = cJSON_PrintUnformatted(rec);
+    cJSON_Delete(rec);
+    if (!line) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+
+    long len = (long)strlen(line) + 1;
+    if (len > ATOM_CF_JOURNAL_LINE_MAX) {
+        xSemaphoreGive(s_lock);
+        cJSON_free(line);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (type == CF_JOURNAL_SUMMARY && s_size > 0) {
+        /* Only the newest summary per user is worth replaying */
+        rewrite_locked(0, -1, user_id);
+    }
+    if (s_size + len > ATOM_CF_JOURNAL_MAX_BYTES) {
+        /* Evict oldest down to 3/4 of the cap so this does not run every append */
+        long before = s_size;
+        rewrite_locked(0, ATOM_CF_JOURNAL_MAX_BYTES * 3 / 4 - len, NULL);
+        ESP_LOGW(TAG, "Journal full, evicted %ld bytes of oldest records", before - s_size);
+    }
+
+    esp_err_t ret = ESP_FAIL;
+    FILE *f = fopen(ATOM_CF_JOURNAL_FILE, "a");
+    if (f) {
+        if (fputs(line, f) >= 0 && fputc('\n', f) != EOF) {
+            s_size += len;
+            s_next_seq++;
+            ret = ESP_OK;
+        }
+        fclose(f);
+    }
+    xSemaphoreGive(s_lock);
+
+    cJSON_free(line);
+    if (ret != ESP_OK) ESP_LOGW(TAG, "Journal append failed");
+    return ret;
+}
+
+bool cf_journal_pending(void)
+{
+    return s_size > 0;
+}
+
+int cf_journal_peek(cf_journal_rec_t *recs, int max)
+{
+    if (!s_lock) return 0;
+
+    char *line = malloc(ATOM_CF_JOURNAL_LINE_MAX);
+    if (!line) return 0;
+
+    int n = 0;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    FILE *f = fopen(ATOM_CF_JOURNAL_FILE, "r");
+    while (f && n < max && read_line(f, line, ATOM_CF_JOURNAL_LINE_MAX)) {
+        cJSON *rec = cJSON_Parse(line);
+        cJSON *jt  = rec ? cJSON_GetObjectItem(rec, "t") : NULL;
+        cJSON *ju  = rec ? cJSON_GetObjectItem(rec, "u") : NULL;
+        cJSON *jx  = rec ? cJSON_GetObjectItem(rec, "x") : NULL;
+
+        /* Unreadable lines are returned too (text NULL) so drop() clears them */
+        cf_journal_rec_t *r = &recs[n++];
+        memset(r, 0, sizeof(*r));
+        r->seq = line_seq(line);
+        if (jt && jt->valuestring && ju && ju->valuestring && jx && jx->valuestring) {
+            r->type = (cf_journal_type_t)jt->valuestring[0];
+            strncpy(r->user_id, ju->valuestring, sizeof(r->user_id) - 1);
+            cJSON *jr  = cJSON_GetObjectItem(rec, "r");
+            cJSON *jts = cJSON_GetObjectItem(rec, "ts");
+            cJSON *ji  = cJSON_GetObjectItem(rec, "i");
+            if (jr && jr->valuestring) strncpy(r->role, jr->valuestring, sizeof(r->role) - 1);
+            if (ji && ji->valuestring) strncpy(r->turn_id, ji->valuestring, sizeof(r->turn_id) - 1);
+            if (jts) r->timestamp = (uint32_t)jts->valuedouble;
+            r->text = strdup(jx->valuestring);
+        }
+        cJSON_Delete(rec);
+    }
+    if (f) fclose(f);
+    xSemaphoreGive(s_lock);
+
+    free(line);
+    return n;
+}
+
+esp_err_t cf_journal_drop(uint32_t through_seq)
+{
+    if (!s_lock) return ESP_OK;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t ret = rewrite_locked(through_seq, -1, NULL);
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+void cf_journal_rec_free(cf_journal_rec_t *rec)
+{
+    free(rec->text);
+    rec->text = NULL;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * cf_journal.h
+ *
+ * AtomClaw: durable journal for Cloudflare writes that could not be sent.
+ *
+ * Failed /save_batch turns and /update_summary payloads are appended as
+ * one JSON line each to ATOM_CF_JOURNAL_FILE on SPIFFS. The cf_history
+ * writer task replays them oldest-first once the Worker answers again.
+ *
+ * Each record carries a sequence number, so a replay removes exactly the
+ * records it sent even if an append evicted or superseded some meanwhile.
+ * A new summary replaces any journaled summary of the same user.
+ *
+ * The file is capped at ATOM_CF_JOURNAL_MAX_BYTES; when an append would
+ * exceed it, the oldest records are evicted. All functions are thread-safe.
+ */
+
+typedef enum {
+    CF_JOURNAL_SAVE    = 's',   /* one conversation turn (/save_batch) */
+    CF_JOURNAL_SUMMARY = 'm',   /* ESP32-generated summary (/update_summary) */
+} cf_journal_type_t;
+
+/* Turn id the Worker uses to skip turns it already applied */
+#define CF_TURN_ID_LEN  20
+
+typedef struct {
+    uint32_t seq;               /* increases with every append; 0 = unreadable line */
+    cf_journal_type_t type;
+    char     user_id[64];
+    char     role[16];          /* SAVE only */
+    char     turn_id[CF_TURN_ID_LEN];   /* SAVE only, "" for old records */
+    char    *text;              /* content or summary, heap-allocated */
+    uint32_t timestamp;         /* SAVE only */
+} cf_journal_rec_t;
+
+/**
+ * Open the journal (SPIFFS must be mounted).
+ */
+esp_err_t cf_journal_init(void);
+
+/**
+ * Append one record. text is copied (and truncated to
+ * ATOM_CF_JOURNAL_MAX_TEXT chars, the Worker keeps 2000 at most).
+ * role, turn_id and timestamp are only stored for SAVE records.
+ */
+esp_err_t cf_journal_append(cf_journal_type_t type, const char *user_id,
+                            const char *role, const char *turn_id,
+                            const char *text, uint32_t timestamp);
+
+/**
+ * True if records are waiting for replay.
+ */
+bool cf_journal_pending(void);
+
+/**
+ * Read up to max oldest records without removing them. Unreadable lines
+ * are returned with text NULL. Free each with cf_journal_rec_free().
+ *
+ * @return Number of records read.
+ */
+int cf_journal_peek(cf_journal_rec_t *recs, int max);
+
+/**
+ * Remove the records numbered up to through_seq (after they were
+ * replayed), plus any unreadable lines.
+ */
+esp_err_t cf_journal_drop(uint32_t through_seq);
+
+void cf_journal_rec_free(cf_journal_rec_t *rec);
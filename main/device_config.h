@@ -8,6 +8,8 @@
 #endif
 
 #define CFG_BUS_QUEUE_LEN           ATOM_BUS_QUEUE_LEN
+#define CFG_BUS_COALESCE_MS         ATOM_BUS_COALESCE_MS
+#define CFG_BUS_COALESCE_MAX_MS     ATOM_BUS_COALESCE_MAX_MS
 
 #define CFG_SPIFFS_BASE             ATOM_SPIFFS_BASE
 #define CFG_SPIFFS_MEMORY_DIR       ATOM_SPIFFS_MEMORY_DIR
@@ -29,7 +31,12 @@
 #define CFG_LLM_API_VERSION         ATOM_LLM_API_VERSION
 #define CFG_LLM_MAX_TOKENS          ATOM_LLM_MAX_TOKENS
 #define CFG_LLM_STREAM_BUF_SIZE     ATOM_LLM_STREAM_BUF_SIZE
+#define CFG_LLM_KEEPALIVE_IDLE_MS   ATOM_LLM_KEEPALIVE_IDLE_MS
 #define CFG_MAX_TOOL_CALLS          ATOM_MAX_TOOL_CALLS
+#define CFG_TOOL_OUTPUT_SIZE        ATOM_TOOL_OUTPUT_SIZE
+#define CFG_TOOL_WORKERS            ATOM_TOOL_WORKERS
+#define CFG_TOOL_WORKER_STACK       ATOM_TOOL_WORKER_STACK
+#define CFG_TOOL_WORKER_PRIO        ATOM_TOOL_WORKER_PRIO
 
 #define CFG_NVS_LLM                 ATOM_NVS_LLM
 #define CFG_NVS_PROXY               ATOM_NVS_PROXY
@@ -43,6 +50,8 @@
 #include "mimi_config.h"
 
 #define CFG_BUS_QUEUE_LEN           MIMI_BUS_QUEUE_LEN
+#define CFG_BUS_COALESCE_MS         MIMI_BUS_COALESCE_MS
+#define CFG_BUS_COALESCE_MAX_MS     MIMI_BUS_COALESCE_MAX_MS
 
 #define CFG_SPIFFS_BASE             MIMI_SPIFFS_BASE
 #define CFG_SPIFFS_MEMORY_DIR       MIMI_SPIFFS_MEMORY_DIR
@@ -64,7 +73,12 @@
 #define CFG_LLM_API_VERSION         MIMI_LLM_API_VERSION
 #define CFG_LLM_MAX_TOKENS          MIMI_LLM_MAX_TOKENS
 #define CFG_LLM_STREAM_BUF_SIZE     MIMI_LLM_STREAM_BUF_SIZE
+#define CFG_LLM_KEEPALIVE_IDLE_MS   MIMI_LLM_KEEPALIVE_IDLE_MS
 #define CFG_MAX_TOOL_CALLS          MIMI_MAX_TOOL_CALLS
+#define CFG_TOOL_OUTPUT_SIZE        MIMI_TOOL_OUTPUT_SIZE
+#define CFG_TOOL_WORKERS            MIMI_TOOL_WORKERS
+#define CFG_TOOL_WORKER_STACK       MIMI_TOOL_WORKER_STACK
+#define CFG_TOOL_WORKER_PRIO        MIMI_TOOL_WORKER_PRIO
 
 #define CFG_NVS_LLM                 MIMI_NVS_LLM
 #define CFG_NVS_PROXY               MIMI_NVS_PROXY
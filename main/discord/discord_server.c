@@ -1,6 +1,7 @@
 #include "discord_server.h"
 #include "atom_config.h"
 #include "bus/message_bus.h"
+#include "llm/json_writer.h"
 
 #include <string.h>
 #include <stdlib.h>
@@ -8,6 +9,7 @@
 #include <stdint.h>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_http_server.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
@@ -202,23 +204,134 @@ static esp_err_t line_signature_is_valid(const char *signature_b64, const char *
 }
 #endif
 
-static esp_err_t line_reply_text(const char *reply_token, const char *text)
+/* ── Admission control ───────────────────────────────────────────────── */
+
+/* Predicted time until a message admitted now gets its reply: the backlog
+ * ahead of it spread over the agent workers, plus one average turn. */
+static uint32_t predicted_reply_ms(void)
+{
+    message_bus_load_t ld;
+    message_bus_get_load(&ld);
+    uint32_t ahead = ld.queued + ld.in_service;
+    uint32_t wait = 0;
+    if (ahead >= ATOM_AGENT_WORKERS) {
+        wait = (ahead - ATOM_AGENT_WORKERS + 1) * ld.service_ms / ATOM_AGENT_WORKERS;
+    }
+    return wait + ld.service_ms;
+}
+
+static void busy_text(char *buf, size_t size, uint32_t retry_s)
+{
+    if (retry_s < ATOM_ADMIT_MIN_RETRY_S) retry_s = ATOM_ADMIT_MIN_RETRY_S;
+    snprintf(buf, size, "I'm busy right now, please try again in %u s.", (unsigned)retry_s);
+}
+
+/* Hand a busy reply to the outbound task: the follow-up is a TLS POST that
+ * would otherwise hold the httpd task. meta carries the reply token, as
+ * for agent replies. */
+static void send_busy(const char *channel, const char *chat_id,
+                      const char *token, const char *busy)
+{
+    mimi_msg_t out = {0};
+    strncpy(out.channel, channel, sizeof(out.channel) - 1);
+    strncpy(out.chat_id, chat_id, sizeof(out.chat_id) - 1);
+    strncpy(out.meta,    token,   sizeof(out.meta) - 1);
+    out.content = msg_text_dup(busy);
+    if (!out.content) return;
+    if (message_bus_push_outbound(&out) != ESP_OK) {
+        ESP_LOGW(TAG, "Outbound queue full, busy reply to %s dropped", chat_id);
+        msg_text_unref(out.content);
+    }
+}
+
+/* Decide whether to queue a message. When not, fills busy with the reply
+ * to send instead. */
+static bool admit(const char *channel, uint32_t max_ms, char *busy, size_t busy_size)
+{
+    message_bus_load_t ld;
+    message_bus_get_load(&ld);
+    uint32_t eta = predicted_reply_ms();
+    if (ld.queued < ld.capacity && eta <= max_ms) return true;
+
+    busy_text(busy, busy_size, (eta + 999) / 1000);
+    ESP_LOGW(TAG, "Shedding %s message: eta %u ms (queued %u/%u, in service %u)",
+             channel, (unsigned)eta, (unsigned)ld.queued, (unsigned)ld.capacity,
+             (unsigned)ld.in_service);
+    return false;
+}
+
+/* ── Reply bodies ────────────────────────────────────────────────────── */
+
+/* Reply bodies are serialized straight from the (shared, read-only) reply
+ * text: one counting pass sizes the buffer, the second fills it. No cJSON
+ * tree and no intermediate copy of the text. */
+typedef struct {
+    const char *key;        /* LINE: "replyToken" / "to"; Discord: NULL */
+    const char *target;
+    const char *text;
+    size_t      text_len;
+} reply_body_t;
+
+static void write_reply_body(json_writer_t *w, const reply_body_t *b)
+{
+    json_writer_lit(w, "{");
+    if (b->key) {
+        json_writer_key(w, b->key);
+        json_writer_string(w, b->target, strlen(b->target));
+        json_writer_lit(w, ",\"messages\":[{\"type\":\"text\",");
+        json_writer_key(w, "text");
+        json_writer_string(w, b->text, b->text_len);
+        json_writer_lit(w, "}]");
+    } else {
+        json_writer_key(w, "content");
+        json_writer_string(w, b->text, b->text_len);
+    }
+    json_writer_lit(w, "}");
+}
+
+static char *build_reply_body(const reply_body_t *b, size_t *out_len)
 {
-    if (!reply_token || !text || !s_line_access_token[0]) return ESP_ERR_INVALID_ARG;
-
-    cJSON *body = cJSON_CreateObject();
-    cJSON_AddStringToObject(body, "replyToken", reply_token);
-    cJSON *messages = cJSON_AddArrayToObject(body, "messages");
-    cJSON *msg = cJSON_CreateObject();
-    cJSON_AddStringToObject(msg, "type", "text");
-    cJSON_AddStringToObject(msg, "text", text);
-    cJSON_AddItemToArray(messages, msg);
-    char *body_str = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    json_writer_t w;
+    json_writer_init(&w, NULL, 0, NULL, NULL);
+    write_reply_body(&w, b);
+    json_writer_finish(&w);
+
+    size_t len = w.total;
+    char *buf = malloc(len + 1);
+    if (!buf) return NULL;
+    json_writer_init(&w, buf, len + 1, NULL, NULL);
+    write_reply_body(&w, b);
+    if (json_writer_finish(&w) != ESP_OK) {
+        free(buf);
+        return NULL;
+    }
+    *out_len = len;
+    return buf;
+}
+
+/* Longest prefix of s, at most max bytes, that does not split a UTF-8 sequence. */
+static size_t utf8_prefix(const char *s, size_t max)
+{
+    size_t n = strlen(s);
+    if (n <= max) return n;
+    while (max > 0 && ((unsigned char)s[max] & 0xC0) == 0x80) max--;
+    return max;
+}
+
+/* POST one text message to a LINE Messaging API endpoint.
+ * target_key/target: "replyToken" for reply, "to" (userId) for push. */
+static esp_err_t line_send_text(const char *url, const char *target_key,
+                                const char *target, const char *text)
+{
+    if (!target || !text || !s_line_access_token[0]) return ESP_ERR_INVALID_ARG;
+
+    reply_body_t b = { target_key, target, text, strlen(text) };
+    size_t body_len = 0;
+    char *body_str = build_reply_body(&b, &body_len);
     if (!body_str) return ESP_ERR_NO_MEM;
 
     esp_http_client_config_t cfg = {
-        .url               = "https://api.line.me/v2/bot/message/reply",
+        .url               = url,
         .method            = HTTP_METHOD_POST,
         .timeout_ms        = 10000,
         .crt_bundle_attach = esp_crt_bundle_attach,
@@ -233,19 +346,19 @@ static esp_err_t line_reply_text(const char *reply_token, const char *text)
     snprintf(auth, sizeof(auth), "Bearer %s", s_line_access_token);
     esp_http_client_set_header(client, "Content-Type", "application/json");
     esp_http_client_set_header(client, "Authorization", auth);
-    esp_http_client_set_post_field(client, body_str, strlen(body_str));
+    esp_http_client_set_post_field(client, body_str, (int)body_len);
 
     esp_err_t ret = esp_http_client_perform(client);
     if (ret == ESP_OK) {
         int code = esp_http_client_get_status_code(client);
         if (code < 200 || code >= 300) {
-            ESP_LOGW(TAG, "LINE reply HTTP %d", code);
+            ESP_LOGW(TAG, "LINE %s HTTP %d", target_key, code);
             ret = ESP_FAIL;
         } else {
-            ESP_LOGI(TAG, "LINE reply OK");
+            ESP_LOGI(TAG, "LINE %s OK", target_key);
         }
     } else {
-        ESP_LOGW(TAG, "LINE reply failed: %s", esp_err_to_name(ret));
+        ESP_LOGW(TAG, "LINE %s failed: %s", target_key, esp_err_to_name(ret));
     }
 
     esp_http_client_cleanup(client);
@@ -255,7 +368,14 @@ static esp_err_t line_reply_text(const char *reply_token, const char *text)
 
 esp_err_t line_follow_up(const char *reply_token, const char *text)
 {
-    return line_reply_text(reply_token, text);
+    return line_send_text("https://api.line.me/v2/bot/message/reply",
+                          "replyToken", reply_token, text);
+}
+
+esp_err_t line_push(const char *user_id, const char *text)
+{
+    return line_send_text("https://api.line.me/v2/bot/message/push",
+                          "to", user_id, text);
 }
 
 /* ── /interactions POST handler ──────────────────────────────────────── */
@@ -367,6 +487,19 @@ static esp_err_t interactions_handler(httpd_req_t *req)
             strncpy(input_text, val->valuestring, sizeof(input_text)-1);
     }
 
+    /* Overloaded: answer now (CHANNEL_MESSAGE_WITH_SOURCE, ephemeral)
+     * rather than defer a reply that would come too late */
+    char busy[96];
+    if (!admit(ATOM_CHAN_DISCORD, ATOM_DISCORD_ADMIT_MAX_MS, busy, sizeof(busy))) {
+        char resp[160];
+        snprintf(resp, sizeof(resp),
+                 "{\"type\":4,\"data\":{\"content\":\"%s\",\"flags\":64}}", busy);
+        httpd_resp_set_type(req, "application/json");
+        httpd_resp_sendstr(req, resp);
+        cJSON_Delete(root);
+        return ESP_OK;
+    }
+
     /* Respond immediately: DEFERRED_CHANNEL_MESSAGE_WITH_SOURCE */
     httpd_resp_set_type(req, "application/json");
     httpd_resp_sendstr(req, "{\"type\":5}");
@@ -378,11 +511,15 @@ static esp_err_t interactions_handler(httpd_req_t *req)
     strncpy(msg.channel, ATOM_CHAN_DISCORD, sizeof(msg.channel)-1);
     strncpy(msg.chat_id, user_id,           sizeof(msg.chat_id)-1);
     strncpy(msg.meta,    itoken,            sizeof(msg.meta)-1);
-    msg.content = strdup(input_text);
+    msg.deadline_us = esp_timer_get_time() + (int64_t)ATOM_DISCORD_REPLY_DEADLINE_MS * 1000;
+    msg.content = msg_text_dup(input_text);
     if (msg.content) {
         if (message_bus_push_inbound(&msg) != ESP_OK) {
             ESP_LOGW(TAG, "Inbound queue full, dropping Discord message");
-            free(msg.content);
+            msg_text_unref(msg.content);
+            /* Already deferred: settle the interaction instead of leaving it pending */
+            busy_text(busy, sizeof(busy), 0);
+            send_busy(ATOM_CHAN_DISCORD, user_id, itoken, busy);
         }
     }
 
@@ -439,20 +576,29 @@ static esp_err_t line_webhook_handler(httpd_req_t *req)
     cJSON *msg_type = message ? cJSON_GetObjectItem(message, "type") : NULL;
     cJSON *text = message ? cJSON_GetObjectItem(message, "text") : NULL;
 
-    if (type && type->valuestring && strcmp(type->valuestring, "message") == 0 &&
+    bool is_text = type && type->valuestring && strcmp(type->valuestring, "message") == 0 &&
         msg_type && msg_type->valuestring && strcmp(msg_type->valuestring, "text") == 0 &&
         reply_token && reply_token->valuestring &&
         user_id && user_id->valuestring &&
-        text && text->valuestring) {
+        text && text->valuestring;
+
+    /* Shed messages get an immediate "busy" reply on their replyToken */
+    char busy[96];
+    if (is_text && !admit(ATOM_CHAN_LINE, ATOM_LINE_ADMIT_MAX_MS, busy, sizeof(busy))) {
+        send_busy(ATOM_CHAN_LINE, user_id->valuestring, reply_token->valuestring, busy);
+    } else if (is_text) {
         mimi_msg_t in = {0};
         strncpy(in.channel, ATOM_CHAN_LINE, sizeof(in.channel) - 1);
         strncpy(in.chat_id, user_id->valuestring, sizeof(in.chat_id) - 1);
         strncpy(in.meta, reply_token->valuestring, sizeof(in.meta) - 1);
-        in.content = strdup(text->valuestring);
+        in.deadline_us = esp_timer_get_time() + (int64_t)ATOM_LINE_REPLY_DEADLINE_MS * 1000;
+        in.content = msg_text_dup(text->valuestring);
         if (in.content) {
             if (message_bus_push_inbound(&in) != ESP_OK) {
                 ESP_LOGW(TAG, "Inbound queue full, dropping LINE message");
-                free(in.content);
+                msg_text_unref(in.content);
+                busy_text(busy, sizeof(busy), 0);
+                send_busy(ATOM_CHAN_LINE, in.chat_id, in.meta, busy);
             } else {
                 ESP_LOGI(TAG, "Queued LINE message from %s", in.chat_id);
             }
@@ -534,13 +680,9 @@ esp_err_t discord_follow_up(const char *interaction_token, const char *text)
              ATOM_DISCORD_API_BASE "/webhooks/%s/%s/messages/@original",
              s_app_id, interaction_token);
 
-    cJSON *body = cJSON_CreateObject();
-    char truncated[ATOM_DISCORD_MAX_RESP_LEN + 1];
-    strncpy(truncated, text, ATOM_DISCORD_MAX_RESP_LEN);
-    truncated[ATOM_DISCORD_MAX_RESP_LEN] = '\0';
-    cJSON_AddStringToObject(body, "content", truncated);
-    char *body_str = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
+    reply_body_t b = { NULL, NULL, text, utf8_prefix(text, ATOM_DISCORD_MAX_RESP_LEN) };
+    size_t body_len = 0;
+    char *body_str = build_reply_body(&b, &body_len);
     if (!body_str) return ESP_ERR_NO_MEM;
 
     esp_http_client_config_t cfg = {
@@ -553,7 +695,7 @@ esp_err_t discord_follow_up(const char *interaction_token, const char *text)
     if (!client) { free(body_str); return ESP_FAIL; }
 
     esp_http_client_set_header(client, "Content-Type", "application/json");
-    esp_http_client_set_post_field(client, body_str, strlen(body_str));
+    esp_http_client_set_post_field(client, body_str, (int)body_len);
 
     esp_err_t ret = esp_http_client_perform(client);
     if (ret == ESP_OK) {
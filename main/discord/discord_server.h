@@ -51,3 +51,13 @@ esp_err_t discord_follow_up(const char *interaction_token, const char *text);
  * @return ESP_OK on success.
  */
 esp_err_t line_follow_up(const char *reply_token, const char *text);
+
+/**
+ * Send a LINE push message to a user.
+ * Used when the replyToken has expired (or was rejected).
+ *
+ * @param user_id  LINE userId (the inbound chat_id).
+ * @param text     Message text to send.
+ * @return ESP_OK on success.
+ */
+esp_err_t line_push(const char *user_id, const char *text);
@@ -130,9 +130,9 @@ static esp_err_t ws_handler(httpd_req_t *req)
         mimi_msg_t msg = {0};
         strncpy(msg.channel, MIMI_CHAN_WEBSOCKET, sizeof(msg.channel) - 1);
         strncpy(msg.chat_id, chat_id, sizeof(msg.chat_id) - 1);
-        msg.content = strdup(content->valuestring);
-        if (msg.content) {
-            message_bus_push_inbound(&msg);
+        msg.content = msg_text_dup(content->valuestring);
+        if (msg.content && message_bus_push_inbound(&msg) != ESP_OK) {
+            msg_text_unref(msg.content);
         }
     }
 
@@ -196,7 +196,7 @@ esp_err_t ws_server_send(const char *chat_id, const char *text)
     };
 
     esp_err_t ret = httpd_ws_send_frame_async(s_server, client->fd, &ws_pkt);
-    free(json_str);
+    cJSON_free(json_str);
 
     if (ret != ESP_OK) {
         ESP_LOGW(TAG, "Failed to send to %s: %s", chat_id, esp_err_to_name(ret));
@@ -0,0 +1,215 @@
+#include "json_pull.h"
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+
+void json_pull_init(json_pull_t *jp, const char *data, size_t len)
+{
+    jp->p = data;
+    jp->end = data + len;
+    jp->err = false;
+    jp->first = false;
+}
+
+static void jp_ws(json_pull_t *jp)
+{
+    while (jp->p < jp->end &&
+           (*jp->p == ' ' || *jp->p == '\n' || *jp->p == '\r' || *jp->p == '\t')) {
+        jp->p++;
+    }
+}
+
+static bool jp_fail(json_pull_t *jp)
+{
+    jp->err = true;
+    return false;
+}
+
+char json_pull_peek(json_pull_t *jp)
+{
+    if (jp->err) return '\0';
+    jp_ws(jp);
+    return jp->p < jp->end ? *jp->p : '\0';
+}
+
+bool json_pull_enter(json_pull_t *jp, char open)
+{
+    if (json_pull_peek(jp) != open) return false;
+    jp->p++;
+    jp->first = true;
+    return true;
+}
+
+/* Handle the separator before the next member/element, or the close. */
+static bool jp_next(json_pull_t *jp, char close)
+{
+    char c = json_pull_peek(jp);
+    if (c == close) {
+        jp->p++;
+        jp->first = false;
+        return false;
+    }
+    if (!jp->first) {
+        if (c != ',') return jp_fail(jp);
+        jp->p++;
+    }
+    jp->first = false;
+    return !jp->err;
+}
+
+bool json_pull_string(json_pull_t *jp, const char **s, size_t *len)
+{
+    if (json_pull_peek(jp) != '"') return jp_fail(jp);
+    const char *start = ++jp->p;
+    while (jp->p < jp->end && *jp->p != '"') {
+        if (*jp->p == '\\') jp->p++;
+        jp->p++;
+    }
+    if (jp->p >= jp->end) return jp_fail(jp);
+    if (s) *s = start;
+    if (len) *len = jp->p - start;
+    jp->p++;
+    return true;
+}
+
+bool json_pull_next_key(json_pull_t *jp, const char **key, size_t *klen)
+{
+    if (!jp_next(jp, '}')) return false;
+    if (!json_pull_string(jp, key, klen)) return false;
+    if (json_pull_peek(jp) != ':') return jp_fail(jp);
+    jp->p++;
+    return true;
+}
+
+bool json_pull_next_item(json_pull_t *jp)
+{
+    return jp_next(jp, ']');
+}
+
+bool json_pull_number(json_pull_t *jp, double *out)
+{
+    json_pull_peek(jp);
+    if (jp->err) return false;
+    char *endp = NULL;
+    double d = strtod(jp->p, &endp);
+    if (endp == jp->p || endp > jp->end) return jp_fail(jp);
+    jp->p = endp;
+    if (out) *out = d;
+    return true;
+}
+
+bool json_pull_skip(json_pull_t *jp, const char **raw, size_t *len)
+{
+    char c = json_pull_peek(jp);
+    const char *start = jp->p;
+
+    if (c == '"') {
+        if (!json_pull_string(jp, NULL, NULL)) return false;
+    } else if (c == '{' || c == '[') {
+        /* Match brackets, stepping over strings (which may contain them) */
+        int depth = 0;
+        while (jp->p < jp->end) {
+            char ch = *jp->p;
+            if (ch == '"') {
+                if (!json_pull_string(jp, NULL, NULL)) return false;
+                continue;
+            }
+            jp->p++;
+            if (ch == '{' || ch == '[') {
+                depth++;
+            } else if (ch == '}' || ch == ']') {
+                if (--depth == 0) break;
+            }
+        }
+        if (depth != 0) return jp_fail(jp);
+    } else if (c == 't' || c == 'f' || c == 'n') {
+        while (jp->p < jp->end && *jp->p >= 'a' && *jp->p <= 'z') jp->p++;
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        if (!json_pull_number(jp, NULL)) return false;
+    } else {
+        return jp_fail(jp);
+    }
+
+    if (raw) *raw = start;
+    if (len) *len = jp->p - start;
+    return true;
+}
+
+bool json_pull_key_is(const char *key, size_t klen, const char *name)
+{
+    return strlen(name) == klen && memcmp(key, name, klen) == 0;
+}
+
+static int hex4(const char *s)
+{
+    int v = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = s[i];
+        v <<= 4;
+        if (c >= '0' && c <= '9')      v |= c - '0';
+        else if (c >= 'a' && c <= 'f') v |= c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') v |= c - 'A' + 10;
+        else return -1;
+    }
+    return v;
+}
+
+size_t json_pull_unescape(const char *src, size_t len, char *out)
+{
+    const char *end = src + len;
+    char *o = out;
+
+    while (src < end) {
+        if (*src != '\\' || src + 1 >= end) {
+            *o++ = *src++;
+            continue;
+        }
+        src++;
+        char e = *src++;
+        switch (e) {
+        case 'b': *o++ = '\b'; break;
+        case 'f': *o++ = '\f'; break;
+        case 'n': *o++ = '\n'; break;
+        case 'r': *o++ = '\r'; break;
+        case 't': *o++ = '\t'; break;
+        case 'u': {
+            if (end - src < 4) break;
+            int cp = hex4(src);
+            if (cp < 0) break;
+            src += 4;
+            /* Surrogate pair → one code point */
+            if (cp >= 0xD800 && cp <= 0xDBFF && end - src >= 6 &&
+                src[0] == '\\' && src[1] == 'u') {
+                int lo = hex4(src + 2);
+                if (lo >= 0xDC00 && lo <= 0xDFFF) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+                    src += 6;
+                }
+            }
+            /* \uXXXX is 6 raw bytes; UTF-8 output is at most 4 */
+            if (cp < 0x80) {
+                *o++ = (char)cp;
+            } else if (cp < 0x800) {
+                *o++ = (char)(0xC0 | (cp >> 6));
+                *o++ = (char)(0x80 | (cp & 0x3F));
+            } else if (cp < 0x10000) {
+                *o++ = (char)(0xE0 | (cp >> 12));
+                *o++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                *o++ = (char)(0x80 | (cp & 0x3F));
+            } else {
+                *o++ = (char)(0xF0 | (cp >> 18));
+                *o++ = (char)(0x80 | ((cp >> 12) & 0x3F));
+                *o++ = (char)(0x80 | ((cp >> 6) & 0x3F));
+                *o++ = (char)(0x80 | (cp & 0x3F));
+            }
+            break;
+        }
+        default:  /* \" \\ \/ */
+            *o++ = e;
+            break;
+        }
+    }
+    *o = '\0';
+    return o - out;
+}
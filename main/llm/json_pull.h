@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * json_pull.h
+ *
+ * Minimal pull parser over a JSON text already in memory. Nothing is
+ * allocated: strings and skipped values come back as (pointer, length)
+ * spans into the input, so callers can copy or unescape only what they
+ * need. Keys are compared raw (escape sequences in keys are not decoded).
+ *
+ * Typical use:
+ *
+ *   json_pull_t jp;
+ *   json_pull_init(&jp, buf, len);
+ *   const char *key; size_t klen;
+ *   if (json_pull_enter(&jp, '{')) {
+ *       while (json_pull_next_key(&jp, &key, &klen)) {
+ *           if (json_pull_key_is(key, klen, "text")) json_pull_string(&jp, &s, &slen);
+ *           else json_pull_skip(&jp, NULL, NULL);
+ *       }
+ *   }
+ *   if (jp.err) ...
+ *
+ * Any syntax error sets jp.err; subsequent calls return false.
+ */
+
+typedef struct {
+    const char *p;
+    const char *end;
+    bool        err;
+    bool        first;      /* next member/element is the first in its container */
+} json_pull_t;
+
+void json_pull_init(json_pull_t *jp, const char *data, size_t len);
+
+/** Next significant character without consuming it ('\0' at end or on error). */
+char json_pull_peek(json_pull_t *jp);
+
+/** Consume '{' or '[' (open). Returns false if the next value is not that container. */
+bool json_pull_enter(json_pull_t *jp, char open);
+
+/**
+ * Advance to the next object member and return its key span. Returns false
+ * (and consumes the closing '}') when the object ends. The caller must then
+ * consume the member value with one of the value functions.
+ */
+bool json_pull_next_key(json_pull_t *jp, const char **key, size_t *klen);
+
+/** Advance to the next array element; false (consuming ']') at the end. */
+bool json_pull_next_item(json_pull_t *jp);
+
+/** Read a string value; span excludes quotes and is still escaped. */
+bool json_pull_string(json_pull_t *jp, const char **s, size_t *len);
+
+/** Read a number value. */
+bool json_pull_number(json_pull_t *jp, double *out);
+
+/** Skip any value; optionally return its raw span (e.g. a nested object). */
+bool json_pull_skip(json_pull_t *jp, const char **raw, size_t *len);
+
+/** True if the raw key span equals name. */
+bool json_pull_key_is(const char *key, size_t klen, const char *name);
+
+/**
+ * Decode an escaped string span into out (UTF-8). out may alias src when
+ * out <= src, since the decoded form is never longer than the raw form.
+ * Writes at most len bytes plus a NUL; returns the decoded length.
+ */
+size_t json_pull_unescape(const char *src, size_t len, char *out);
@@ -0,0 +1,190 @@
+#include "json_writer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+void json_writer_init(json_writer_t *w, char *buf, size_t cap,
+                      json_writer_flush_fn flush, void *ctx)
+{
+    w->buf = buf;
+    w->cap = cap;
+    w->len = 0;
+    w->total = 0;
+    w->flush = flush;
+    w->ctx = ctx;
+    w->err = ESP_OK;
+}
+
+static void jw_drain(json_writer_t *w)
+{
+    if (w->len == 0 || w->err != ESP_OK) return;
+    w->err = w->flush(w->buf, w->len, w->ctx);
+    w->len = 0;
+}
+
+void json_writer_raw(json_writer_t *w, const char *data, size_t len)
+{
+    if (w->err != ESP_OK || len == 0) return;
+    w->total += len;
+
+    if (!w->buf) return;                        /* count only */
+
+    if (!w->flush) {                            /* fixed buffer */
+        if (w->len + len >= w->cap) {
+            w->err = ESP_ERR_INVALID_SIZE;
+            return;
+        }
+        memcpy(w->buf + w->len, data, len);
+        w->len += len;
+        return;
+    }
+
+    while (len > 0 && w->err == ESP_OK) {       /* streaming window */
+        size_t room = w->cap - w->len;
+        size_t n = len < room ? len : room;
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        data += n;
+        len -= n;
+        if (w->len == w->cap) jw_drain(w);
+    }
+}
+
+void json_writer_lit(json_writer_t *w, const char *s)
+{
+    json_writer_raw(w, s, strlen(s));
+}
+
+void json_writer_string(json_writer_t *w, const char *s, size_t len)
+{
+    json_writer_raw(w, "\"", 1);
+
+    /* Emit runs of plain bytes in one go; escape the rest like cJSON does */
+    size_t run = 0;
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = (unsigned char)s[i];
+        const char *esc = NULL;
+        char ubuf[8];
+
+        switch (c) {
+        case '"':  esc = "\\\""; break;
+        case '\\': esc = "\\\\"; break;
+        case '\b': esc = "\\b";  break;
+        case '\f': esc = "\\f";  break;
+        case '\n': esc = "\\n";  break;
+        case '\r': esc = "\\r";  break;
+        case '\t': esc = "\\t";  break;
+        default:
+            if (c < 0x20) {
+                snprintf(ubuf, sizeof(ubuf), "\\u%04x", c);
+                esc = ubuf;
+            }
+            break;
+        }
+
+        if (esc) {
+            json_writer_raw(w, s + i - run, run);
+            json_writer_lit(w, esc);
+            run = 0;
+        } else {
+            run++;
+        }
+    }
+    json_writer_raw(w, s + len - run, run);
+
+    json_writer_raw(w, "\"", 1);
+}
+
+void json_writer_key(json_writer_t *w, const char *key)
+{
+    json_writer_string(w, key, strlen(key));
+    json_writer_raw(w, ":", 1);
+}
+
+void json_writer_int(json_writer_t *w, int value)
+{
+    char num[16];
+    int n = snprintf(num, sizeof(num), "%d", value);
+    json_writer_raw(w, num, n);
+}
+
+static void jw_number(json_writer_t *w, double d)
+{
+    char num[32];
+    int n;
+    if (isnan(d) || isinf(d)) {
+        n = snprintf(num, sizeof(num), "null");
+    } else if (fabs(d) < 1e15 && d == (double)(long long)d) {
+        n = snprintf(num, sizeof(num), "%lld", (long long)d);
+    } else {
+        /* As cJSON's print_number: 15 digits unless that changes the value */
+        n = snprintf(num, sizeof(num), "%1.15g", d);
+        if (strtod(num, NULL) != d) {
+            n = snprintf(num, sizeof(num), "%1.17g", d);
+        }
+    }
+    json_writer_raw(w, num, n);
+}
+
+void json_writer_cjson(json_writer_t *w, const cJSON *item)
+{
+    if (!item) {
+        json_writer_lit(w, "null");
+        return;
+    }
+
+    const cJSON *child;
+    switch (item->type & 0xFF) {
+    case cJSON_False:
+        json_writer_lit(w, "false");
+        break;
+    case cJSON_True:
+        json_writer_lit(w, "true");
+        break;
+    case cJSON_NULL:
+        json_writer_lit(w, "null");
+        break;
+    case cJSON_Number:
+        jw_number(w, item->valuedouble);
+        break;
+    case cJSON_String:
+        json_writer_string(w, item->valuestring ? item->valuestring : "",
+                           item->valuestring ? strlen(item->valuestring) : 0);
+        break;
+    case cJSON_Raw:
+        if (item->valuestring) json_writer_lit(w, item->valuestring);
+        break;
+    case cJSON_Array:
+        json_writer_raw(w, "[", 1);
+        for (child = item->child; child; child = child->next) {
+            json_writer_cjson(w, child);
+            if (child->next) json_writer_raw(w, ",", 1);
+        }
+        json_writer_raw(w, "]", 1);
+        break;
+    case cJSON_Object:
+        json_writer_raw(w, "{", 1);
+        for (child = item->child; child; child = child->next) {
+            json_writer_key(w, child->string ? child->string : "");
+            json_writer_cjson(w, child);
+            if (child->next) json_writer_raw(w, ",", 1);
+        }
+        json_writer_raw(w, "}", 1);
+        break;
+    default:
+        json_writer_lit(w, "null");
+        break;
+    }
+}
+
+esp_err_t json_writer_finish(json_writer_t *w)
+{
+    if (w->flush) {
+        jw_drain(w);
+    } else if (w->buf && w->err == ESP_OK) {
+        w->buf[w->len] = '\0';                  /* raw() keeps one byte free */
+    }
+    return w->err;
+}
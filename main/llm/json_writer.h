@@ -0,0 +1,64 @@
+#pragma once
+
+#include "esp_err.h"
+#include "cJSON.h"
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * json_writer.h
+ *
+ * Incremental JSON serializer that writes through a small fixed window
+ * instead of building one contiguous string. Three modes:
+ *
+ *   - count only   (buf == NULL, flush == NULL): just sums output bytes,
+ *                  e.g. to compute Content-Length before sending
+ *   - streaming    (flush != NULL): buf is a scratch window, handed to
+ *                  flush() whenever it fills up
+ *   - fixed buffer (buf != NULL, flush == NULL): writes into buf and
+ *                  fails with ESP_ERR_INVALID_SIZE instead of truncating
+ *
+ * Errors are sticky: after the first failure all writes are no-ops and
+ * json_writer_finish() returns the error.
+ */
+
+typedef esp_err_t (*json_writer_flush_fn)(const char *data, size_t len, void *ctx);
+
+typedef struct {
+    char                 *buf;
+    size_t                cap;
+    size_t                len;      /* bytes pending in buf */
+    size_t                total;    /* bytes produced so far */
+    json_writer_flush_fn  flush;
+    void                 *ctx;
+    esp_err_t             err;
+} json_writer_t;
+
+void json_writer_init(json_writer_t *w, char *buf, size_t cap,
+                      json_writer_flush_fn flush, void *ctx);
+
+/** Append bytes verbatim (caller guarantees they are valid JSON). */
+void json_writer_raw(json_writer_t *w, const char *data, size_t len);
+
+/** Append a NUL-terminated literal verbatim. */
+void json_writer_lit(json_writer_t *w, const char *s);
+
+/** Append len bytes of s as a quoted, escaped JSON string. */
+void json_writer_string(json_writer_t *w, const char *s, size_t len);
+
+/** Append "key": (quoted key followed by a colon). */
+void json_writer_key(json_writer_t *w, const char *key);
+
+/** Append an integer. */
+void json_writer_int(json_writer_t *w, int value);
+
+/** Serialize a cJSON tree without cJSON_Print* (no intermediate string). */
+void json_writer_cjson(json_writer_t *w, const cJSON *item);
+
+/**
+ * Flush any pending bytes (streaming mode) or NUL-terminate the output
+ * (fixed-buffer mode, when there is room).
+ *
+ * @return ESP_OK or the first error hit while writing.
+ */
+esp_err_t json_writer_finish(json_writer_t *w);
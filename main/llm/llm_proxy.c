@@ -1,14 +1,21 @@
 #include "llm_proxy.h"
 #include "device_config.h"
 #include "proxy/http_proxy.h"
+#include "json_writer.h"
+#include "json_pull.h"
 
 #include <string.h>
 #include <stdlib.h>
+#include <strings.h>
+#include <stdint.h>
 #include "esp_log.h"
 #include "esp_http_client.h"
 #include "esp_crt_bundle.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "nvs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "cJSON.h"
 
 static const char *TAG = "llm";
@@ -36,7 +43,8 @@ typedef struct {
     uint32_t caps;
 } resp_buf_t;
 
-static esp_err_t resp_buf_init(resp_buf_t *rb, size_t initial_cap)
+/* Allocate backing storage, preferring PSRAM. Does not log. */
+static esp_err_t resp_buf_alloc(resp_buf_t *rb, size_t initial_cap)
 {
     rb->caps = MALLOC_CAP_SPIRAM;
     rb->data = heap_caps_calloc(1, initial_cap, rb->caps);
@@ -44,15 +52,27 @@ static esp_err_t resp_buf_init(resp_buf_t *rb, size_t initial_cap)
         rb->caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT;
         rb->data = heap_caps_calloc(1, initial_cap, rb->caps);
         if (!rb->data) return ESP_ERR_NO_MEM;
-        ESP_LOGW(TAG, "LLM response buffer allocated in internal RAM (PSRAM unavailable)");
     }
     rb->len = 0;
     rb->cap = initial_cap;
     return ESP_OK;
 }
 
+static esp_err_t resp_buf_init(resp_buf_t *rb, size_t initial_cap)
+{
+    if (resp_buf_alloc(rb, initial_cap) != ESP_OK) return ESP_ERR_NO_MEM;
+    if (!(rb->caps & MALLOC_CAP_SPIRAM)) {
+        ESP_LOGW(TAG, "LLM response buffer allocated in internal RAM (PSRAM unavailable)");
+    }
+    return ESP_OK;
+}
+
 static esp_err_t resp_buf_append(resp_buf_t *rb, const char *data, size_t len)
 {
+    /* Small scratch buffers (SSE lines, tool inputs) are allocated lazily */
+    if (!rb->data && resp_buf_alloc(rb, len < 256 ? 256 : len + 1) != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
     while (rb->len + len >= rb->cap) {
         size_t new_cap = rb->cap * 2;
         char *tmp = heap_caps_realloc(rb->data, new_cap, rb->caps);
@@ -75,13 +95,434 @@ static void resp_buf_free(resp_buf_t *rb)
     rb->caps = 0;
 }
 
-/* ── HTTP event handler (for esp_http_client direct path) ─────── */
+/* Hand the buffer contents to the caller (who frees with free()). */
+static char *resp_buf_detach(resp_buf_t *rb, size_t *out_len)
+{
+    char *data = rb->data;
+    if (out_len) *out_len = rb->len;
+    rb->data = NULL;
+    rb->len = 0;
+    rb->cap = 0;
+    return data;
+}
+
+/* ── Usage / prompt-cache statistics ─────────────────────────── */
+
+static llm_cache_stats_t s_stats = {0};
+static SemaphoreHandle_t s_stats_lock = NULL;
+
+static uint32_t usage_field(cJSON *obj, const char *key, uint32_t fallback)
+{
+    cJSON *item = cJSON_GetObjectItem(obj, key);
+    return (item && cJSON_IsNumber(item)) ? (uint32_t)item->valuedouble : fallback;
+}
+
+/* Merge a provider "usage" object into out. Absent fields keep their value,
+ * since Anthropic streams input counts and output counts in separate events. */
+static void usage_parse(cJSON *usage, bool openai, llm_usage_t *out)
+{
+    if (!usage || !cJSON_IsObject(usage)) return;
+
+    if (openai) {
+        cJSON *details = cJSON_GetObjectItem(usage, "prompt_tokens_details");
+        uint32_t prompt = usage_field(usage, "prompt_tokens", 0);
+        uint32_t cached = usage_field(details, "cached_tokens", 0);
+        out->cache_read_tokens = cached;
+        out->input_tokens = prompt > cached ? prompt - cached : 0;
+        out->output_tokens = usage_field(usage, "completion_tokens", out->output_tokens);
+    } else {
+        out->input_tokens = usage_field(usage, "input_tokens", out->input_tokens);
+        out->output_tokens = usage_field(usage, "output_tokens", out->output_tokens);
+        out->cache_creation_tokens = usage_field(usage, "cache_creation_input_tokens",
+                                                 out->cache_creation_tokens);
+        out->cache_read_tokens = usage_field(usage, "cache_read_input_tokens",
+                                             out->cache_read_tokens);
+    }
+}
+
+static void usage_record(const llm_usage_t *u)
+{
+    if (u->input_tokens == 0 && u->output_tokens == 0 && u->cache_read_tokens == 0) return;
+
+    if (s_stats_lock) xSemaphoreTake(s_stats_lock, portMAX_DELAY);
+    s_stats.calls++;
+    if (u->cache_read_tokens > 0) s_stats.cache_hits++;
+    s_stats.input_tokens += u->input_tokens;
+    s_stats.output_tokens += u->output_tokens;
+    s_stats.cache_creation_tokens += u->cache_creation_tokens;
+    s_stats.cache_read_tokens += u->cache_read_tokens;
+    s_stats.last = *u;
+    if (s_stats_lock) xSemaphoreGive(s_stats_lock);
+
+    ESP_LOGI(TAG, "Usage: in=%u out=%u cache_write=%u cache_read=%u",
+             (unsigned)u->input_tokens, (unsigned)u->output_tokens,
+             (unsigned)u->cache_creation_tokens, (unsigned)u->cache_read_tokens);
+}
+
+void llm_get_cache_stats(llm_cache_stats_t *out)
+{
+    if (s_stats_lock) xSemaphoreTake(s_stats_lock, portMAX_DELAY);
+    *out = s_stats;
+    if (s_stats_lock) xSemaphoreGive(s_stats_lock);
+}
+
+void llm_reset_cache_stats(void)
+{
+    if (s_stats_lock) xSemaphoreTake(s_stats_lock, portMAX_DELAY);
+    memset(&s_stats, 0, sizeof(s_stats));
+    if (s_stats_lock) xSemaphoreGive(s_stats_lock);
+}
+
+/* ── SSE stream parser (stream: true) ─────────────────────────── */
+
+#define SSE_MAX_LINE  (16 * 1024)
+
+typedef struct {
+    resp_buf_t line;                            /* current line being assembled */
+    resp_buf_t data;                            /* "data:" payload of the pending event */
+    resp_buf_t text;                            /* accumulated text deltas */
+    resp_buf_t tool_input[CFG_MAX_TOOL_CALLS];  /* partial JSON per tool call */
+    int tool_slot;                              /* Anthropic: slot of the open tool_use block */
+    bool openai;
+    bool done;                                  /* OpenAI: saw "data: [DONE]" */
+    bool failed;                                /* provider sent an error event */
+    llm_response_t *resp;
+    const llm_stream_cb_t *cb;
+} sse_parser_t;
+
+static void sse_emit_text(sse_parser_t *p, const char *text)
+{
+    if (!text || !text[0]) return;
+    size_t len = strlen(text);
+    resp_buf_append(&p->text, text, len);
+    if (p->cb && p->cb->on_text) {
+        p->cb->on_text(text, len, p->cb->ctx);
+    }
+}
+
+/* Finalize a tool call: move its accumulated input into the response
+ * and notify the caller. Safe to call more than once per slot. */
+static void sse_finish_tool(sse_parser_t *p, int slot)
+{
+    llm_tool_call_t *call = &p->resp->calls[slot];
+    if (call->input) return;
+
+    if (p->tool_input[slot].len > 0) {
+        call->input = resp_buf_detach(&p->tool_input[slot], &call->input_len);
+    } else {
+        resp_buf_free(&p->tool_input[slot]);
+        call->input = strdup("{}");
+        call->input_len = call->input ? 2 : 0;
+    }
+    if (!call->input) return;
+
+    if (p->cb && p->cb->on_tool_use) {
+        p->cb->on_tool_use(call, p->cb->ctx);
+    }
+}
+
+static void sse_handle_anthropic(sse_parser_t *p, cJSON *ev)
+{
+    llm_response_t *resp = p->resp;
+    const char *type = cJSON_GetStringValue(cJSON_GetObjectItem(ev, "type"));
+    if (!type) return;
+
+    if (strcmp(type, "message_start") == 0) {
+        cJSON *message = cJSON_GetObjectItem(ev, "message");
+        usage_parse(cJSON_GetObjectItem(message, "usage"), false, &resp->usage);
+    } else if (strcmp(type, "content_block_start") == 0) {
+        cJSON *block = cJSON_GetObjectItem(ev, "content_block");
+        const char *btype = cJSON_GetStringValue(cJSON_GetObjectItem(block, "type"));
+        p->tool_slot = -1;
+        if (btype && strcmp(btype, "tool_use") == 0 && resp->call_count < CFG_MAX_TOOL_CALLS) {
+            p->tool_slot = resp->call_count++;
+            llm_tool_call_t *call = &resp->calls[p->tool_slot];
+            safe_copy(call->id, sizeof(call->id),
+                      cJSON_GetStringValue(cJSON_GetObjectItem(block, "id")));
+            safe_copy(call->name, sizeof(call->name),
+                      cJSON_GetStringValue(cJSON_GetObjectItem(block, "name")));
+        }
+    } else if (strcmp(type, "content_block_delta") == 0) {
+        cJSON *delta = cJSON_GetObjectItem(ev, "delta");
+        const char *dtype = cJSON_GetStringValue(cJSON_GetObjectItem(delta, "type"));
+        if (!dtype) return;
+        if (strcmp(dtype, "text_delta") == 0) {
+            sse_emit_text(p, cJSON_GetStringValue(cJSON_GetObjectItem(delta, "text")));
+        } else if (strcmp(dtype, "input_json_delta") == 0 && p->tool_slot >= 0) {
+            const char *part = cJSON_GetStringValue(cJSON_GetObjectItem(delta, "partial_json"));
+            if (part) resp_buf_append(&p->tool_input[p->tool_slot], part, strlen(part));
+        }
+    } else if (strcmp(type, "content_block_stop") == 0) {
+        if (p->tool_slot >= 0) sse_finish_tool(p, p->tool_slot);
+        p->tool_slot = -1;
+    } else if (strcmp(type, "message_delta") == 0) {
+        cJSON *delta = cJSON_GetObjectItem(ev, "delta");
+        const char *stop = cJSON_GetStringValue(cJSON_GetObjectItem(delta, "stop_reason"));
+        if (stop) resp->tool_use = (strcmp(stop, "tool_use") == 0);
+        usage_parse(cJSON_GetObjectItem(ev, "usage"), false, &resp->usage);
+    } else if (strcmp(type, "error") == 0) {
+        cJSON *error = cJSON_GetObjectItem(ev, "error");
+        const char *msg = cJSON_GetStringValue(cJSON_GetObjectItem(error, "message"));
+        ESP_LOGE(TAG, "Stream error: %s", msg ? msg : "(unknown)");
+        p->failed = true;
+    }
+}
+
+static void sse_handle_openai(sse_parser_t *p, cJSON *ev)
+{
+    llm_response_t *resp = p->resp;
+
+    /* Final chunk with stream_options.include_usage has empty choices */
+    usage_parse(cJSON_GetObjectItem(ev, "usage"), true, &resp->usage);
+
+    cJSON *choices = cJSON_GetObjectItem(ev, "choices");
+    cJSON *choice0 = choices && cJSON_IsArray(choices) ? cJSON_GetArrayItem(choices, 0) : NULL;
+    if (!choice0) return;
+
+    cJSON *delta = cJSON_GetObjectItem(choice0, "delta");
+    if (delta) {
+        sse_emit_text(p, cJSON_GetStringValue(cJSON_GetObjectItem(delta, "content")));
+
+        cJSON *tool_calls = cJSON_GetObjectItem(delta, "tool_calls");
+        cJSON *tc;
+        if (tool_calls && cJSON_IsArray(tool_calls)) {
+            cJSON_ArrayForEach(tc, tool_calls) {
+                cJSON *jidx = cJSON_GetObjectItem(tc, "index");
+                int idx = (jidx && cJSON_IsNumber(jidx)) ? jidx->valueint : 0;
+                if (idx < 0 || idx >= CFG_MAX_TOOL_CALLS) continue;
+                if (idx >= resp->call_count) resp->call_count = idx + 1;
+
+                llm_tool_call_t *call = &resp->calls[idx];
+                const char *id = cJSON_GetStringValue(cJSON_GetObjectItem(tc, "id"));
+                if (id) safe_copy(call->id, sizeof(call->id), id);
+
+                cJSON *func = cJSON_GetObjectItem(tc, "function");
+                const char *name = cJSON_GetStringValue(cJSON_GetObjectItem(func, "name"));
+                const char *args = cJSON_GetStringValue(cJSON_GetObjectItem(func, "arguments"));
+                if (name) safe_copy(call->name, sizeof(call->name), name);
+                if (args) resp_buf_append(&p->tool_input[idx], args, strlen(args));
+            }
+        }
+    }
+
+    const char *finish = cJSON_GetStringValue(cJSON_GetObjectItem(choice0, "finish_reason"));
+    if (finish) {
+        resp->tool_use = (strcmp(finish, "tool_calls") == 0);
+        for (int i = 0; i < resp->call_count; i++) {
+            sse_finish_tool(p, i);
+        }
+    }
+}
+
+static void sse_dispatch(sse_parser_t *p)
+{
+    if (p->data.len == 0) return;
+
+    if (p->openai && strcmp(p->data.data, "[DONE]") == 0) {
+        p->done = true;
+        p->data.len = 0;
+        return;
+    }
+
+    cJSON *ev = cJSON_Parse(p->data.data);
+    p->data.len = 0;
+    if (!ev) {
+        ESP_LOGW(TAG, "Skipping malformed SSE event");
+        return;
+    }
+    if (p->openai) {
+        sse_handle_openai(p, ev);
+    } else {
+        sse_handle_anthropic(p, ev);
+    }
+    cJSON_Delete(ev);
+}
+
+static void sse_handle_line(sse_parser_t *p, char *line, size_t len)
+{
+    if (len > 0 && line[len - 1] == '\r') line[--len] = '\0';
+
+    if (len == 0) {
+        sse_dispatch(p);
+        return;
+    }
+    /* Only "data:" matters; "event:" duplicates the JSON "type" field */
+    if (strncmp(line, "data:", 5) != 0) return;
+
+    const char *payload = line + 5;
+    if (*payload == ' ') payload++;
+    if (p->data.len > 0) resp_buf_append(&p->data, "\n", 1);
+    resp_buf_append(&p->data, payload, strlen(payload));
+}
+
+static esp_err_t sse_feed(sse_parser_t *p, const char *data, size_t len)
+{
+    while (len > 0) {
+        const char *nl = memchr(data, '\n', len);
+        size_t n = nl ? (size_t)(nl - data) : len;
+
+        if (p->line.len + n > SSE_MAX_LINE) {
+            ESP_LOGE(TAG, "SSE line exceeds %d bytes", SSE_MAX_LINE);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        if (n > 0 && resp_buf_append(&p->line, data, n) != ESP_OK) return ESP_ERR_NO_MEM;
+
+        if (!nl) break;
+        sse_handle_line(p, p->line.data ? p->line.data : "", p->line.len);
+        p->line.len = 0;
+        data += n + 1;
+        len  -= n + 1;
+    }
+    return ESP_OK;
+}
+
+/* Flush any trailing event and move the results into p->resp. */
+static void sse_finish(sse_parser_t *p)
+{
+    if (p->line.len > 0) {
+        sse_handle_line(p, p->line.data, p->line.len);
+    }
+    sse_dispatch(p);
+
+    for (int i = 0; i < p->resp->call_count; i++) {
+        sse_finish_tool(p, i);
+    }
+    if (p->openai && p->resp->call_count > 0) {
+        p->resp->tool_use = true;
+    }
+
+    if (p->text.len > 0) {
+        p->resp->text = resp_buf_detach(&p->text, &p->resp->text_len);
+    }
+
+    resp_buf_free(&p->line);
+    resp_buf_free(&p->data);
+    resp_buf_free(&p->text);
+    for (int i = 0; i < CFG_MAX_TOOL_CALLS; i++) {
+        resp_buf_free(&p->tool_input[i]);
+    }
+}
+
+/* ── Body sink: raw buffer or SSE parser ──────────────────────── */
+
+typedef struct {
+    resp_buf_t   *rb;       /* full body (non-streaming) or error body (streaming) */
+    sse_parser_t *sse;      /* set in streaming mode */
+    int           status;   /* HTTP status, filled in by the transport */
+    size_t        fed;      /* body bytes delivered so far */
+    esp_err_t     err;      /* first feed error; later data is refused */
+} body_sink_t;
+
+/* Once a feed fails (over-long SSE line, out of memory) the rest of the
+ * body cannot be parsed in step, so the error sticks and the transport
+ * stops reading. */
+static esp_err_t body_sink_feed(body_sink_t *sink, const char *data, size_t len)
+{
+    if (sink->err != ESP_OK) return sink->err;
+    sink->fed += len;
+    if (sink->sse && sink->status == 200) {
+        sink->err = sse_feed(sink->sse, data, len);
+    } else {
+        sink->err = resp_buf_append(sink->rb, data, len);
+    }
+    return sink->err;
+}
+
+/* ── HTTP/1.1 response decoder (for the CONNECT-proxy path) ───── */
+
+typedef enum {
+    HR_STATUS,
+    HR_HEADERS,
+    HR_BODY,
+    HR_CHUNK_SIZE,
+    HR_CHUNK_DATA,
+    HR_CHUNK_END,
+    HR_TRAILER,
+    HR_DONE,
+} hr_state_t;
+
+typedef struct {
+    hr_state_t   state;
+    char         line[256];
+    size_t       line_len;
+    bool         chunked;
+    bool         conn_close;        /* server sent "Connection: close" */
+    long         content_length;    /* -1 = read until close */
+    size_t       remaining;         /* bytes left in body / current chunk */
+    body_sink_t *sink;
+} http_resp_parser_t;
+
+static void hr_handle_line(http_resp_parser_t *hp)
+{
+    char *line = hp->line;
+
+    switch (hp->state) {
+    case HR_STATUS:
+        if (strncmp(line, "HTTP/", 5) == 0) {
+            const char *sp = strchr(line, ' ');
+            if (sp) hp->sink->status = atoi(sp + 1);
+        }
+        hp->state = HR_HEADERS;
+        break;
+    case HR_HEADERS:
+        if (line[0] == '\0') {
+            if (hp->chunked) {
+                hp->state = HR_CHUNK_SIZE;
+            } else if (hp->content_length >= 0) {
+                hp->remaining = (size_t)hp->content_length;
+                hp->state = hp->remaining > 0 ? HR_BODY : HR_DONE;
+            } else {
+                hp->remaining = SIZE_MAX;
+                hp->state = HR_BODY;
+            }
+        } else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0) {
+            hp->chunked = (strstr(line + 18, "chunked") != NULL);
+        } else if (strncasecmp(line, "Connection:", 11) == 0) {
+            hp->conn_close = (strstr(line + 11, "close") != NULL);
+        } else if (strncasecmp(line, "Content-Length:", 15) == 0) {
+            hp->content_length = atol(line + 15);
+        }
+        break;
+    case HR_CHUNK_SIZE:
+        hp->remaining = strtoul(line, NULL, 16);
+        hp->state = hp->remaining > 0 ? HR_CHUNK_DATA : HR_TRAILER;
+        break;
+    case HR_CHUNK_END:
+        hp->state = HR_CHUNK_SIZE;
+        break;
+    case HR_TRAILER:
+        if (line[0] == '\0') hp->state = HR_DONE;
+        break;
+    default:
+        break;
+    }
+}
 
-static esp_err_t http_event_handler(esp_http_client_event_t *evt)
+static esp_err_t hr_feed(http_resp_parser_t *hp, const char *data, size_t len)
 {
-    resp_buf_t *rb = (resp_buf_t *)evt->user_data;
-    if (evt->event_id == HTTP_EVENT_ON_DATA) {
-        resp_buf_append(rb, (const char *)evt->data, evt->data_len);
+    while (len > 0 && hp->state != HR_DONE) {
+        if (hp->state == HR_BODY || hp->state == HR_CHUNK_DATA) {
+            size_t n = len < hp->remaining ? len : hp->remaining;
+            esp_err_t err = body_sink_feed(hp->sink, data, n);
+            if (err != ESP_OK) return err;
+            if (hp->remaining != SIZE_MAX) hp->remaining -= n;
+            data += n;
+            len  -= n;
+            if (hp->remaining == 0) {
+                hp->state = (hp->state == HR_CHUNK_DATA) ? HR_CHUNK_END : HR_DONE;
+            }
+            continue;
+        }
+
+        char c = *data++;
+        len--;
+        if (c == '\n') {
+            hp->line[hp->line_len] = '\0';
+            hp->line_len = 0;
+            hr_handle_line(hp);
+        } else if (c != '\r' && hp->line_len < sizeof(hp->line) - 1) {
+            hp->line[hp->line_len++] = c;
+        }
     }
     return ESP_OK;
 }
@@ -108,10 +549,181 @@ static const char *llm_api_path(void)
     return provider_is_openai() ? "/v1/chat/completions" : "/v1/messages";
 }
 
+/* ── Request body (serialized on the fly) ───────────────────── */
+
+/*
+ * The request body is never materialized as one string. It is written
+ * twice through json_writer: once in count-only mode for Content-Length,
+ * then through a small stack window straight into the connection.
+ * A body is either a cJSON tree (legacy llm_chat, OpenAI conversion) or
+ * an Anthropic tool request written directly from the caller's messages.
+ */
+
+#define LLM_TX_WINDOW   1024
+
+typedef struct {
+    const struct llm_conv *conv;    /* if set, cached prefix + pending message */
+    cJSON      *tree;           /* if set, serialized as-is */
+    const char *system_prompt;
+    cJSON      *messages;       /* caller-owned, never copied */
+    const char *tools_json;
+    bool        stream;
+} llm_body_t;
+
+static void write_anthropic_body(json_writer_t *w, const llm_body_t *b);
+static void write_conv_body(json_writer_t *w, const llm_body_t *b);
+
+static void llm_body_write(json_writer_t *w, const llm_body_t *body)
+{
+    if (body->conv) {
+        write_conv_body(w, body);
+    } else if (body->tree) {
+        json_writer_cjson(w, body->tree);
+    } else {
+        write_anthropic_body(w, body);
+    }
+}
+
+static size_t llm_body_length(const llm_body_t *body)
+{
+    json_writer_t w;
+    json_writer_init(&w, NULL, 0, NULL, NULL);
+    llm_body_write(&w, body);
+    return w.total;
+}
+
+static esp_err_t llm_body_send(const llm_body_t *body, json_writer_flush_fn flush, void *ctx)
+{
+    char window[LLM_TX_WINDOW];
+    json_writer_t w;
+    json_writer_init(&w, window, sizeof(window), flush, ctx);
+    llm_body_write(&w, body);
+    return json_writer_finish(&w);
+}
+
+/* ── Keep-alive connection pool ───────────────────────────────── */
+
+/*
+ * Each ReAct iteration is a separate request to the same host, so TCP+TLS
+ * sessions are kept open between calls. A slot holds either an
+ * esp_http_client handle (direct) or a CONNECT tunnel (proxy) for one host.
+ * Idle slots older than CFG_LLM_KEEPALIVE_IDLE_MS are dropped on the next
+ * acquire; proxy tunnels are also probed before reuse. A request that fails
+ * on a reused connection before any response byte arrives is retried once
+ * on a fresh connection, since the server may have closed it while idle.
+ */
+
+#define LLM_POOL_SLOTS  2
+
+typedef struct {
+    bool                     in_use;
+    bool                     via_proxy;
+    char                     host[64];
+    esp_http_client_handle_t client;        /* direct path */
+    proxy_conn_t            *conn;          /* CONNECT-proxy path */
+    int64_t                  last_used_us;
+} llm_conn_t;
+
+static llm_conn_t        s_pool[LLM_POOL_SLOTS];
+static SemaphoreHandle_t s_pool_lock = NULL;
+
+static bool pool_conn_open(const llm_conn_t *c)
+{
+    return c->client != NULL || c->conn != NULL;
+}
+
+static void pool_conn_destroy(llm_conn_t *c)
+{
+    if (c->client) {
+        esp_http_client_cleanup(c->client);
+        c->client = NULL;
+    }
+    if (c->conn) {
+        proxy_conn_close(c->conn);
+        c->conn = NULL;
+    }
+}
+
+static bool pool_conn_idle_ok(const llm_conn_t *c, int64_t now)
+{
+    if (now - c->last_used_us > (int64_t)CFG_LLM_KEEPALIVE_IDLE_MS * 1000) return false;
+    if (c->conn && !proxy_conn_is_alive(c->conn)) return false;
+    return true;
+}
+
+/*
+ * Reserve a slot for host. The returned slot may already hold an open
+ * connection. Returns NULL when every slot is busy; the caller then uses a
+ * one-shot llm_conn_t on its stack.
+ */
+static llm_conn_t *pool_acquire(bool via_proxy, const char *host)
+{
+    if (!s_pool_lock) return NULL;
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+
+    int64_t now = esp_timer_get_time();
+    llm_conn_t *match = NULL, *empty = NULL, *oldest = NULL;
+
+    for (int i = 0; i < LLM_POOL_SLOTS; i++) {
+        llm_conn_t *c = &s_pool[i];
+        if (c->in_use) continue;
+
+        if (pool_conn_open(c) && !pool_conn_idle_ok(c, now)) {
+            ESP_LOGI(TAG, "Dropping idle connection to %s", c->host);
+            pool_conn_destroy(c);
+        }
+
+        if (!pool_conn_open(c)) {
+            if (!empty) empty = c;
+        } else if (c->via_proxy == via_proxy && strcmp(c->host, host) == 0) {
+            if (!match) match = c;
+        } else if (!oldest || c->last_used_us < oldest->last_used_us) {
+            oldest = c;
+        }
+    }
+
+    llm_conn_t *slot = match ? match : empty;
+    if (!slot && oldest) {
+        pool_conn_destroy(oldest);      /* evict a connection to another host */
+        slot = oldest;
+    }
+    if (slot) {
+        slot->in_use = true;
+        if (slot != match) {
+            slot->via_proxy = via_proxy;
+            safe_copy(slot->host, sizeof(slot->host), host);
+        }
+    }
+
+    xSemaphoreGive(s_pool_lock);
+    return slot;
+}
+
+static void pool_release(llm_conn_t *c, bool reusable)
+{
+    bool pooled = c >= s_pool && c < s_pool + LLM_POOL_SLOTS;
+    if (!reusable || !pooled) {
+        pool_conn_destroy(c);
+    }
+    if (!pooled) return;
+
+    xSemaphoreTake(s_pool_lock, portMAX_DELAY);
+    c->last_used_us = esp_timer_get_time();
+    c->in_use = false;
+    xSemaphoreGive(s_pool_lock);
+}
+
 /* ── Init ─────────────────────────────────────────────────────── */
 
 esp_err_t llm_proxy_init(void)
 {
+    if (!s_pool_lock) {
+        s_pool_lock = xSemaphoreCreateMutex();
+    }
+    if (!s_stats_lock) {
+        s_stats_lock = xSemaphoreCreateMutex();
+    }
+
     /* Start with build-time defaults */
     if (CFG_SECRET_API_KEY[0] != '\0') {
         safe_copy(s_api_key, sizeof(s_api_key), CFG_SECRET_API_KEY);
@@ -154,21 +766,29 @@ esp_err_t llm_proxy_init(void)
 
 /* ── Direct path: esp_http_client ───────────────────────────── */
 
-static esp_err_t llm_http_direct(const char *post_data, resp_buf_t *rb, int *out_status)
+static esp_err_t direct_flush(const char *data, size_t len, void *ctx)
 {
-    esp_http_client_config_t config = {
-        .url = llm_api_url(),
-        .event_handler = http_event_handler,
-        .user_data = rb,
-        .timeout_ms = 120 * 1000,
-        .buffer_size = 4096,
-        .buffer_size_tx = 4096,
-        .crt_bundle_attach = esp_crt_bundle_attach,
-    };
+    esp_http_client_handle_t client = (esp_http_client_handle_t)ctx;
+    return esp_http_client_write(client, data, len) == (int)len ? ESP_OK : ESP_ERR_HTTP_WRITE_DATA;
+}
 
-    esp_http_client_handle_t client = esp_http_client_init(&config);
-    if (!client) return ESP_FAIL;
+static esp_err_t llm_http_direct_once(llm_conn_t *c, const llm_body_t *body, size_t body_len,
+                                      body_sink_t *sink)
+{
+    if (!c->client) {
+        esp_http_client_config_t config = {
+            .url = llm_api_url(),
+            .timeout_ms = 120 * 1000,
+            .buffer_size = 4096,
+            .buffer_size_tx = 4096,
+            .crt_bundle_attach = esp_crt_bundle_attach,
+            .keep_alive_enable = true,
+        };
+        c->client = esp_http_client_init(&config);
+        if (!c->client) return ESP_FAIL;
+    }
 
+    esp_http_client_handle_t client = c->client;
     esp_http_client_set_method(client, HTTP_METHOD_POST);
     esp_http_client_set_header(client, "Content-Type", "application/json");
     if (provider_is_openai()) {
@@ -181,22 +801,77 @@ static esp_err_t llm_http_direct(const char *post_data, resp_buf_t *rb, int *out
         esp_http_client_set_header(client, "x-api-key", s_api_key);
         esp_http_client_set_header(client, "anthropic-version", CFG_LLM_API_VERSION);
     }
-    esp_http_client_set_post_field(client, post_data, strlen(post_data));
 
-    esp_err_t err = esp_http_client_perform(client);
-    *out_status = esp_http_client_get_status_code(client);
-    esp_http_client_cleanup(client);
+    esp_err_t err = esp_http_client_open(client, (int)body_len);
+    if (err != ESP_OK) return err;
+
+    err = llm_body_send(body, direct_flush, client);
+    if (err != ESP_OK) {
+        esp_http_client_close(client);
+        return err;
+    }
+
+    if (esp_http_client_fetch_headers(client) < 0) {
+        esp_http_client_close(client);
+        return ESP_ERR_HTTP_FETCH_HEADER;
+    }
+    sink->status = esp_http_client_get_status_code(client);
+
+    char tmp[2048];
+    while (1) {
+        int n = esp_http_client_read(client, tmp, sizeof(tmp));
+        if (n < 0) {
+            err = ESP_ERR_HTTP_INCOMPLETE_DATA;
+            break;
+        }
+        if (n == 0) break;
+        err = body_sink_feed(sink, tmp, n);
+        if (err != ESP_OK) break;
+    }
+
+    /* A partially read response leaves the connection unusable */
+    if (err != ESP_OK || !esp_http_client_is_complete_data_received(client)) {
+        esp_http_client_close(client);
+    }
+    return err;
+}
+
+static esp_err_t llm_http_direct(const llm_body_t *body, size_t body_len, body_sink_t *sink)
+{
+    llm_conn_t oneshot = {0};
+    llm_conn_t *c = pool_acquire(false, llm_api_host());
+    if (!c) c = &oneshot;
+
+    bool reused = pool_conn_open(c);
+    esp_err_t err = llm_http_direct_once(c, body, body_len, sink);
+    if (err != ESP_OK && reused && sink->fed == 0) {
+        ESP_LOGW(TAG, "Pooled connection failed (%s), reconnecting", esp_err_to_name(err));
+        pool_conn_destroy(c);
+        sink->status = 0;
+        err = llm_http_direct_once(c, body, body_len, sink);
+    }
+
+    pool_release(c, err == ESP_OK);
     return err;
 }
 
 /* ── Proxy path: manual HTTP over CONNECT tunnel ────────────── */
 
-static esp_err_t llm_http_via_proxy(const char *post_data, resp_buf_t *rb, int *out_status)
+static esp_err_t proxy_flush(const char *data, size_t len, void *ctx)
 {
-    proxy_conn_t *conn = proxy_conn_open(llm_api_host(), 443, 30000);
-    if (!conn) return ESP_ERR_HTTP_CONNECT;
+    return proxy_conn_write((proxy_conn_t *)ctx, data, (int)len) < 0 ? ESP_ERR_HTTP_WRITE_DATA : ESP_OK;
+}
+
+static esp_err_t llm_http_via_proxy_once(llm_conn_t *c, const llm_body_t *body, size_t body_len,
+                                         body_sink_t *sink, bool *reusable)
+{
+    *reusable = false;
+    if (!c->conn) {
+        c->conn = proxy_conn_open(llm_api_host(), 443, 30000);
+        if (!c->conn) return ESP_ERR_HTTP_CONNECT;
+    }
+    proxy_conn_t *conn = c->conn;
 
-    int body_len = strlen(post_data);
     char header[512];
     int hlen = 0;
     if (provider_is_openai()) {
@@ -206,8 +881,8 @@ static esp_err_t llm_http_via_proxy(const char *post_data, resp_buf_t *rb, int *
             "Content-Type: application/json\r\n"
             "Authorization: Bearer %s\r\n"
             "Content-Length: %d\r\n"
-            "Connection: close\r\n\r\n",
-            llm_api_path(), llm_api_host(), s_api_key, body_len);
+            "Connection: keep-alive\r\n\r\n",
+            llm_api_path(), llm_api_host(), s_api_key, (int)body_len);
     } else {
         hlen = snprintf(header, sizeof(header),
             "POST %s HTTP/1.1\r\n"
@@ -216,92 +891,349 @@ static esp_err_t llm_http_via_proxy(const char *post_data, resp_buf_t *rb, int *
             "x-api-key: %s\r\n"
             "anthropic-version: %s\r\n"
             "Content-Length: %d\r\n"
-            "Connection: close\r\n\r\n",
-            llm_api_path(), llm_api_host(), s_api_key, CFG_LLM_API_VERSION, body_len);
+            "Connection: keep-alive\r\n\r\n",
+            llm_api_path(), llm_api_host(), s_api_key, CFG_LLM_API_VERSION, (int)body_len);
     }
 
     if (proxy_conn_write(conn, header, hlen) < 0 ||
-        proxy_conn_write(conn, post_data, body_len) < 0) {
-        proxy_conn_close(conn);
+        llm_body_send(body, proxy_flush, conn) != ESP_OK) {
         return ESP_ERR_HTTP_WRITE_DATA;
     }
 
-    /* Read full response into buffer */
+    /* Decode status/headers/body (incl. chunked) as bytes arrive */
+    http_resp_parser_t hp = {
+        .state = HR_STATUS,
+        .content_length = -1,
+        .sink = sink,
+    };
     char tmp[4096];
-    while (1) {
+    bool got_any = false;
+    while (hp.state != HR_DONE) {
         int n = proxy_conn_read(conn, tmp, sizeof(tmp), 120000);
         if (n <= 0) break;
-        if (resp_buf_append(rb, tmp, n) != ESP_OK) break;
+        got_any = true;
+        if (hr_feed(&hp, tmp, n) != ESP_OK) return sink->err;   /* tunnel not reusable */
+    }
+    if (!got_any) return ESP_ERR_HTTP_FETCH_HEADER;
+
+    /* Only a fully framed response leaves the tunnel in a reusable state */
+    *reusable = (hp.state == HR_DONE && !hp.conn_close);
+    return ESP_OK;
+}
+
+static esp_err_t llm_http_via_proxy(const llm_body_t *body, size_t body_len, body_sink_t *sink)
+{
+    llm_conn_t oneshot = {0};
+    llm_conn_t *c = pool_acquire(true, llm_api_host());
+    if (!c) c = &oneshot;
+
+    bool reused = pool_conn_open(c);
+    bool reusable = false;
+    esp_err_t err = llm_http_via_proxy_once(c, body, body_len, sink, &reusable);
+    if (err != ESP_OK && reused && sink->fed == 0) {
+        ESP_LOGW(TAG, "Pooled tunnel failed (%s), reconnecting", esp_err_to_name(err));
+        pool_conn_destroy(c);
+        sink->status = 0;
+        err = llm_http_via_proxy_once(c, body, body_len, sink, &reusable);
+    }
+
+    pool_release(c, err == ESP_OK && reusable);
+    return err;
+}
+
+/* ── Shared HTTP dispatch ─────────────────────────────────────── */
+
+static int s_inflight = 0;   /* requests currently on the wire */
+
+static esp_err_t llm_http_call(const llm_body_t *body, size_t body_len, body_sink_t *sink)
+{
+    __atomic_add_fetch(&s_inflight, 1, __ATOMIC_RELAXED);
+    esp_err_t err;
+    if (http_proxy_is_enabled()) {
+        err = llm_http_via_proxy(body, body_len, sink);
+    } else {
+        err = llm_http_direct(body, body_len, sink);
+    }
+    __atomic_sub_fetch(&s_inflight, 1, __ATOMIC_RELAXED);
+    return err;
+}
+
+int llm_inflight(void)
+{
+    return __atomic_load_n(&s_inflight, __ATOMIC_RELAXED);
+}
+
+/* ── Response parsing (pull parser, no cJSON tree) ───────────── */
+
+/*
+ * Non-streaming responses are parsed in one pass over the receive buffer.
+ * Text blocks are unescaped in place at the front of that same buffer
+ * (decoded text never outruns the read cursor), which then becomes
+ * resp->text. Anthropic tool inputs are copied as raw JSON slices; OpenAI
+ * tool arguments are unescaped from their string form. Nothing else is
+ * allocated.
+ */
+
+static void copy_span(char *dst, size_t size, const char *s, size_t len)
+{
+    size_t n = len < size - 1 ? len : size - 1;
+    memcpy(dst, s, n);
+    dst[n] = '\0';
+}
+
+static char *dup_span(const char *s, size_t len, bool unescape, size_t *out_len)
+{
+    char *out = malloc(len + 1);
+    if (!out) return NULL;
+    if (unescape) {
+        *out_len = json_pull_unescape(s, len, out);
+    } else {
+        memcpy(out, s, len);
+        out[len] = '\0';
+        *out_len = len;
+    }
+    return out;
+}
+
+static bool pull_u32(json_pull_t *jp, uint32_t *out)
+{
+    char c = json_pull_peek(jp);
+    if (c >= '0' && c <= '9') {
+        double d = 0;
+        json_pull_number(jp, &d);
+        *out = (uint32_t)d;
+        return true;
+    }
+    json_pull_skip(jp, NULL, NULL);
+    return false;
+}
+
+static void pull_usage(json_pull_t *jp, bool openai, llm_usage_t *u)
+{
+    if (!json_pull_enter(jp, '{')) {
+        json_pull_skip(jp, NULL, NULL);
+        return;
+    }
+
+    uint32_t prompt = 0, cached = 0;
+    const char *k;
+    size_t kl;
+    while (json_pull_next_key(jp, &k, &kl)) {
+        if (openai && json_pull_key_is(k, kl, "prompt_tokens_details") &&
+            json_pull_enter(jp, '{')) {
+            const char *k2;
+            size_t kl2;
+            while (json_pull_next_key(jp, &k2, &kl2)) {
+                if (json_pull_key_is(k2, kl2, "cached_tokens")) pull_u32(jp, &cached);
+                else json_pull_skip(jp, NULL, NULL);
+            }
+        } else if (openai && json_pull_key_is(k, kl, "prompt_tokens")) {
+            pull_u32(jp, &prompt);
+        } else if (openai && json_pull_key_is(k, kl, "completion_tokens")) {
+            pull_u32(jp, &u->output_tokens);
+        } else if (!openai && json_pull_key_is(k, kl, "input_tokens")) {
+            pull_u32(jp, &u->input_tokens);
+        } else if (!openai && json_pull_key_is(k, kl, "output_tokens")) {
+            pull_u32(jp, &u->output_tokens);
+        } else if (!openai && json_pull_key_is(k, kl, "cache_creation_input_tokens")) {
+            pull_u32(jp, &u->cache_creation_tokens);
+        } else if (!openai && json_pull_key_is(k, kl, "cache_read_input_tokens")) {
+            pull_u32(jp, &u->cache_read_tokens);
+        } else {
+            json_pull_skip(jp, NULL, NULL);
+        }
+    }
+
+    if (openai) {
+        u->cache_read_tokens = cached;
+        u->input_tokens = prompt > cached ? prompt - cached : 0;
+    }
+}
+
+/* Read a string value, or skip a value of any other type (e.g. null).
+ * json_pull_string() would flag a non-string as a syntax error. */
+static bool pull_opt_string(json_pull_t *jp, const char **s, size_t *len)
+{
+    if (json_pull_peek(jp) == '"') return json_pull_string(jp, s, len);
+    json_pull_skip(jp, NULL, NULL);
+    return false;
+}
+
+/* Anthropic: {"content":[{"type":"text","text":...}|{"type":"tool_use",...}],
+ *             "stop_reason":..., "usage":{...}} */
+static void parse_anthropic(json_pull_t *jp, char *text, size_t *text_len,
+                            llm_response_t *resp)
+{
+    const char *k;
+    size_t kl;
+    if (!json_pull_enter(jp, '{')) return;
+
+    while (json_pull_next_key(jp, &k, &kl)) {
+        if (json_pull_key_is(k, kl, "stop_reason") && json_pull_peek(jp) == '"') {
+            const char *v;
+            size_t vl;
+            json_pull_string(jp, &v, &vl);
+            resp->tool_use = json_pull_key_is(v, vl, "tool_use");
+        } else if (json_pull_key_is(k, kl, "usage")) {
+            pull_usage(jp, false, &resp->usage);
+        } else if (json_pull_key_is(k, kl, "content") && json_pull_enter(jp, '[')) {
+            while (json_pull_next_item(jp)) {
+                const char *type = NULL, *txt = NULL, *id = NULL, *name = NULL, *input = NULL;
+                size_t type_len = 0, txt_len = 0, id_len = 0, name_len = 0, input_len = 0;
+
+                if (!json_pull_enter(jp, '{')) {
+                    json_pull_skip(jp, NULL, NULL);
+                    continue;
+                }
+                while (json_pull_next_key(jp, &k, &kl)) {
+                    if (json_pull_key_is(k, kl, "type"))       pull_opt_string(jp, &type, &type_len);
+                    else if (json_pull_key_is(k, kl, "text"))  pull_opt_string(jp, &txt, &txt_len);
+                    else if (json_pull_key_is(k, kl, "id"))    pull_opt_string(jp, &id, &id_len);
+                    else if (json_pull_key_is(k, kl, "name"))  pull_opt_string(jp, &name, &name_len);
+                    else if (json_pull_key_is(k, kl, "input")) json_pull_skip(jp, &input, &input_len);
+                    else json_pull_skip(jp, NULL, NULL);
+                }
+                if (jp->err || !type) continue;
+
+                if (json_pull_key_is(type, type_len, "text") && txt) {
+                    *text_len += json_pull_unescape(txt, txt_len, text + *text_len);
+                } else if (json_pull_key_is(type, type_len, "tool_use") &&
+                           resp->call_count < CFG_MAX_TOOL_CALLS) {
+                    llm_tool_call_t *call = &resp->calls[resp->call_count++];
+                    if (id)   copy_span(call->id, sizeof(call->id), id, id_len);
+                    if (name) copy_span(call->name, sizeof(call->name), name, name_len);
+                    if (input) call->input = dup_span(input, input_len, false, &call->input_len);
+                }
+            }
+        } else {
+            json_pull_skip(jp, NULL, NULL);
+        }
     }
-    proxy_conn_close(conn);
+}
 
-    /* Parse status line */
-    *out_status = 0;
-    if (rb->len > 5 && strncmp(rb->data, "HTTP/", 5) == 0) {
-        const char *sp = strchr(rb->data, ' ');
-        if (sp) *out_status = atoi(sp + 1);
+static void parse_openai_message(json_pull_t *jp, char *text, size_t *text_len,
+                                 llm_response_t *resp)
+{
+    const char *k;
+    size_t kl;
+    if (!json_pull_enter(jp, '{')) {
+        json_pull_skip(jp, NULL, NULL);
+        return;
     }
 
-    /* Strip HTTP headers, keep body only */
-    char *body = strstr(rb->data, "\r\n\r\n");
-    if (body) {
-        body += 4;
-        size_t blen = rb->len - (body - rb->data);
-        memmove(rb->data, body, blen);
-        rb->len = blen;
-        rb->data[rb->len] = '\0';
+    while (json_pull_next_key(jp, &k, &kl)) {
+        if (json_pull_key_is(k, kl, "content") && json_pull_peek(jp) == '"') {
+            const char *v;
+            size_t vl;
+            json_pull_string(jp, &v, &vl);
+            *text_len += json_pull_unescape(v, vl, text + *text_len);
+        } else if (json_pull_key_is(k, kl, "tool_calls") && json_pull_enter(jp, '[')) {
+            while (json_pull_next_item(jp)) {
+                if (resp->call_count >= CFG_MAX_TOOL_CALLS || !json_pull_enter(jp, '{')) {
+                    json_pull_skip(jp, NULL, NULL);
+                    continue;
+                }
+                llm_tool_call_t *call = &resp->calls[resp->call_count++];
+                while (json_pull_next_key(jp, &k, &kl)) {
+                    const char *v;
+                    size_t vl;
+                    if (json_pull_key_is(k, kl, "id")) {
+                        if (pull_opt_string(jp, &v, &vl)) copy_span(call->id, sizeof(call->id), v, vl);
+                    } else if (json_pull_key_is(k, kl, "function") && json_pull_enter(jp, '{')) {
+                        while (json_pull_next_key(jp, &k, &kl)) {
+                            if (json_pull_key_is(k, kl, "name")) {
+                                if (pull_opt_string(jp, &v, &vl)) {
+                                    copy_span(call->name, sizeof(call->name), v, vl);
+                                }
+                            } else if (json_pull_key_is(k, kl, "arguments") &&
+                                       json_pull_peek(jp) == '"' && json_pull_string(jp, &v, &vl)) {
+                                call->input = dup_span(v, vl, true, &call->input_len);
+                            } else {
+                                json_pull_skip(jp, NULL, NULL);
+                            }
+                        }
+                    } else {
+                        json_pull_skip(jp, NULL, NULL);
+                    }
+                }
+            }
+        } else {
+            json_pull_skip(jp, NULL, NULL);
+        }
     }
-
-    return ESP_OK;
 }
 
-/* ── Shared HTTP dispatch ─────────────────────────────────────── */
-
-static esp_err_t llm_http_call(const char *post_data, resp_buf_t *rb, int *out_status)
+/* OpenAI: {"choices":[{"message":{...},"finish_reason":...}], "usage":{...}} */
+static void parse_openai(json_pull_t *jp, char *text, size_t *text_len,
+                         llm_response_t *resp)
 {
-    if (http_proxy_is_enabled()) {
-        return llm_http_via_proxy(post_data, rb, out_status);
-    } else {
-        return llm_http_direct(post_data, rb, out_status);
+    const char *k;
+    size_t kl;
+    if (!json_pull_enter(jp, '{')) return;
+
+    while (json_pull_next_key(jp, &k, &kl)) {
+        if (json_pull_key_is(k, kl, "usage")) {
+            pull_usage(jp, true, &resp->usage);
+        } else if (json_pull_key_is(k, kl, "choices") && json_pull_enter(jp, '[')) {
+            int idx = 0;
+            while (json_pull_next_item(jp)) {
+                if (idx++ > 0 || !json_pull_enter(jp, '{')) {
+                    json_pull_skip(jp, NULL, NULL);
+                    continue;
+                }
+                while (json_pull_next_key(jp, &k, &kl)) {
+                    if (json_pull_key_is(k, kl, "message")) {
+                        parse_openai_message(jp, text, text_len, resp);
+                    } else if (json_pull_key_is(k, kl, "finish_reason") &&
+                               json_pull_peek(jp) == '"') {
+                        const char *v;
+                        size_t vl;
+                        json_pull_string(jp, &v, &vl);
+                        resp->tool_use = json_pull_key_is(v, vl, "tool_calls");
+                    } else {
+                        json_pull_skip(jp, NULL, NULL);
+                    }
+                }
+            }
+        } else {
+            json_pull_skip(jp, NULL, NULL);
+        }
     }
+    if (resp->call_count > 0) resp->tool_use = true;
 }
 
-/* ── Parse text from JSON response ────────────────────────────── */
-
-static void extract_text_anthropic(cJSON *root, char *buf, size_t size)
+/* Parse a complete response body. Consumes rb (its storage becomes resp->text). */
+static esp_err_t parse_response(resp_buf_t *rb, bool openai, llm_response_t *resp)
 {
-    buf[0] = '\0';
-    cJSON *content = cJSON_GetObjectItem(root, "content");
-    if (!content || !cJSON_IsArray(content)) return;
+    if (!rb->data || rb->len == 0) {
+        resp_buf_free(rb);
+        return ESP_FAIL;
+    }
+
+    json_pull_t jp;
+    json_pull_init(&jp, rb->data, rb->len);
+    size_t text_len = 0;
 
-    size_t off = 0;
-    cJSON *block;
-    cJSON_ArrayForEach(block, content) {
-        cJSON *btype = cJSON_GetObjectItem(block, "type");
-        if (!btype || !cJSON_IsString(btype) || strcmp(btype->valuestring, "text") != 0) continue;
-        cJSON *text = cJSON_GetObjectItem(block, "text");
-        if (!text || !cJSON_IsString(text)) continue;
-        size_t tlen = strlen(text->valuestring);
-        size_t copy = (tlen < size - off - 1) ? tlen : size - off - 1;
-        memcpy(buf + off, text->valuestring, copy);
-        off += copy;
+    if (openai) {
+        parse_openai(&jp, rb->data, &text_len, resp);
+    } else {
+        parse_anthropic(&jp, rb->data, &text_len, resp);
     }
-    buf[off] = '\0';
-}
 
-static void extract_text_openai(cJSON *root, char *buf, size_t size)
-{
-    buf[0] = '\0';
-    cJSON *choices = cJSON_GetObjectItem(root, "choices");
-    if (!choices || !cJSON_IsArray(choices)) return;
-    cJSON *choice0 = cJSON_GetArrayItem(choices, 0);
-    if (!choice0) return;
-    cJSON *message = cJSON_GetObjectItem(choice0, "message");
-    if (!message) return;
-    cJSON *content = cJSON_GetObjectItem(message, "content");
-    if (!content || !cJSON_IsString(content)) return;
-    strncpy(buf, content->valuestring, size - 1);
-    buf[size - 1] = '\0';
+    if (jp.err) {
+        resp_buf_free(rb);
+        llm_response_free(resp);
+        return ESP_FAIL;
+    }
+
+    if (text_len > 0) {
+        rb->len = text_len;
+        rb->data[text_len] = '\0';
+        resp->text = resp_buf_detach(rb, &resp->text_len);
+    } else {
+        resp_buf_free(rb);
+    }
+    return ESP_OK;
 }
 
 static cJSON *convert_tools_openai(const char *tools_json)
@@ -338,14 +1270,173 @@ static cJSON *convert_tools_openai(const char *tools_json)
     return out;
 }
 
+/* ── Prompt caching helpers ───────────────────────────────────── */
+
+#define CACHE_CONTROL_JSON  "\"cache_control\":{\"type\":\"ephemeral\"}"
+
+/* System prompt with LLM_SYSTEM_CACHE_BREAK removed. Caller frees. */
+static char *system_plain(const char *system_prompt)
+{
+    char *out = strdup(system_prompt ? system_prompt : "");
+    if (!out) return NULL;
+    char *brk = strstr(out, LLM_SYSTEM_CACHE_BREAK);
+    if (brk) {
+        size_t blen = strlen(LLM_SYSTEM_CACHE_BREAK);
+        memmove(brk, brk + blen, strlen(brk + blen) + 1);
+    }
+    return out;
+}
+
+/*
+ * Anthropic "system" as text blocks: the stable prefix (up to the cache
+ * break) carries a cache_control breakpoint, the volatile tail does not.
+ */
+static void write_system_blocks(json_writer_t *w, const char *system_prompt)
+{
+    const char *brk = strstr(system_prompt, LLM_SYSTEM_CACHE_BREAK);
+    size_t stable_len = brk ? (size_t)(brk - system_prompt) : strlen(system_prompt);
+    const char *tail = brk ? brk + strlen(LLM_SYSTEM_CACHE_BREAK) : "";
+
+    json_writer_raw(w, "[", 1);
+    if (stable_len > 0) {
+        json_writer_lit(w, "{\"type\":\"text\",\"text\":");
+        json_writer_string(w, system_prompt, stable_len);
+        json_writer_lit(w, "," CACHE_CONTROL_JSON "}");
+    }
+    if (tail[0]) {
+        if (stable_len > 0) json_writer_raw(w, ",", 1);
+        json_writer_lit(w, "{\"type\":\"text\",\"text\":");
+        json_writer_string(w, tail, strlen(tail));
+        json_writer_raw(w, "}", 1);
+    }
+    json_writer_raw(w, "]", 1);
+}
+
+/* Write an object, appending a cache_control member unless present. */
+static void write_object_cached(json_writer_t *w, const cJSON *obj)
+{
+    json_writer_raw(w, "{", 1);
+    for (const cJSON *m = obj->child; m; m = m->next) {
+        json_writer_key(w, m->string ? m->string : "");
+        json_writer_cjson(w, m);
+        if (m->next) json_writer_raw(w, ",", 1);
+    }
+    if (!cJSON_GetObjectItem(obj, "cache_control")) {
+        if (obj->child) json_writer_raw(w, ",", 1);
+        json_writer_lit(w, CACHE_CONTROL_JSON);
+    }
+    json_writer_raw(w, "}", 1);
+}
+
+/* Write one message with a breakpoint on its last content block. */
+static void write_message_cached(json_writer_t *w, const cJSON *msg)
+{
+    if (!cJSON_IsObject(msg)) {
+        json_writer_cjson(w, msg);
+        return;
+    }
+
+    json_writer_raw(w, "{", 1);
+    for (const cJSON *m = msg->child; m; m = m->next) {
+        json_writer_key(w, m->string ? m->string : "");
+        bool is_content = m->string && strcmp(m->string, "content") == 0;
+        if (is_content && cJSON_IsString(m)) {
+            json_writer_lit(w, "[{\"type\":\"text\",\"text\":");
+            json_writer_string(w, m->valuestring, strlen(m->valuestring));
+            json_writer_lit(w, "," CACHE_CONTROL_JSON "}]");
+        } else if (is_content && cJSON_IsArray(m) && m->child) {
+            json_writer_raw(w, "[", 1);
+            /* Breakpoint only on an object tail; anything else goes as is */
+            for (const cJSON *blk = m->child; blk; blk = blk->next) {
+                if (!blk->next && cJSON_IsObject(blk)) {
+                    write_object_cached(w, blk);
+                } else {
+                    json_writer_cjson(w, blk);
+                }
+                if (blk->next) json_writer_raw(w, ",", 1);
+            }
+            json_writer_raw(w, "]", 1);
+        } else {
+            json_writer_cjson(w, m);
+        }
+        if (m->next) json_writer_raw(w, ",", 1);
+    }
+    json_writer_raw(w, "}", 1);
+}
+
+/*
+ * Messages array with a breakpoint on the last block of the last message,
+ * so the next ReAct iteration (same history + assistant/tool_result turn)
+ * reads the whole conversation so far from cache.
+ */
+static void write_messages_cached(json_writer_t *w, const cJSON *messages)
+{
+    json_writer_raw(w, "[", 1);
+    for (const cJSON *msg = messages ? messages->child : NULL; msg; msg = msg->next) {
+        if (msg->next) {
+            json_writer_cjson(w, msg);
+            json_writer_raw(w, ",", 1);
+        } else {
+            write_message_cached(w, msg);
+        }
+    }
+    json_writer_raw(w, "]", 1);
+}
+
+/*
+ * Tools array straight from the registry's pre-built JSON, with the
+ * breakpoint spliced into the last tool object (before its closing brace).
+ */
+static void write_tools_cached(json_writer_t *w, const char *tools_json)
+{
+    const char *end = strrchr(tools_json, ']');
+    const char *last = end ? end : tools_json + strlen(tools_json);
+    while (last > tools_json && *last != '}') last--;
+
+    if (!end || *last != '}') {
+        json_writer_lit(w, tools_json);
+        return;
+    }
+    json_writer_raw(w, tools_json, last - tools_json);
+    json_writer_lit(w, "," CACHE_CONTROL_JSON);
+    json_writer_lit(w, last);
+}
+
+/*
+ * Cache prefix order is tools → system → messages. Breakpoints: last
+ * tool, stable part of the system prompt, last message.
+ */
+static void write_anthropic_body(json_writer_t *w, const llm_body_t *b)
+{
+    json_writer_lit(w, "{\"model\":");
+    json_writer_string(w, s_model, strlen(s_model));
+    json_writer_lit(w, ",\"max_tokens\":");
+    json_writer_int(w, CFG_LLM_MAX_TOKENS);
+    if (b->stream) {
+        json_writer_lit(w, ",\"stream\":true");
+    }
+    json_writer_lit(w, ",\"system\":");
+    write_system_blocks(w, b->system_prompt ? b->system_prompt : "");
+    json_writer_lit(w, ",\"messages\":");
+    write_messages_cached(w, b->messages);
+    if (b->tools_json) {
+        json_writer_lit(w, ",\"tools\":");
+        write_tools_cached(w, b->tools_json);
+    }
+    json_writer_raw(w, "}", 1);
+}
+
 static cJSON *convert_messages_openai(const char *system_prompt, cJSON *messages)
 {
     cJSON *out = cJSON_CreateArray();
     if (system_prompt && system_prompt[0]) {
+        /* OpenAI caches long prefixes automatically; just drop the marker */
+        char *plain = system_plain(system_prompt);
         cJSON *sys = cJSON_CreateObject();
         cJSON_AddStringToObject(sys, "role", "system");
-        cJSON_AddStringToObject(sys, "content", system_prompt);
+        cJSON_AddStringToObject(sys, "content", plain ? plain : system_prompt);
         cJSON_AddItemToArray(out, sys);
+        free(plain);
     }
 
     if (!messages || !cJSON_IsArray(messages)) return out;
@@ -407,7 +1498,7 @@ static cJSON *convert_messages_openai(const char *system_prompt, cJSON *messages
                         char *args = cJSON_PrintUnformatted(input);
                         if (args) {
                             cJSON_AddStringToObject(func, "arguments", args);
-                            free(args);
+                            cJSON_free(args);
                         }
                     }
                     cJSON_AddItemToObject(tc, "function", func);
@@ -501,7 +1592,9 @@ esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
         cJSON_Delete(messages);
         cJSON_AddItemToObject(body, "messages", openai_msgs);
     } else {
-        cJSON_AddStringToObject(body, "system", system_prompt);
+        char *plain = system_plain(system_prompt);
+        cJSON_AddStringToObject(body, "system", plain ? plain : system_prompt);
+        free(plain);
         cJSON *messages = cJSON_Parse(messages_json);
         if (messages) {
             cJSON_AddItemToObject(body, "messages", messages);
@@ -515,26 +1608,23 @@ esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
         }
     }
 
-    char *post_data = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-    if (!post_data) {
-        snprintf(response_buf, buf_size, "Error: Failed to build request");
-        return ESP_ERR_NO_MEM;
-    }
+    llm_body_t req = { .tree = body };
+    size_t body_len = llm_body_length(&req);
 
     ESP_LOGI(TAG, "Calling LLM API (provider: %s, model: %s, body: %d bytes)",
-             s_provider, s_model, (int)strlen(post_data));
+             s_provider, s_model, (int)body_len);
 
     resp_buf_t rb;
     if (resp_buf_init(&rb, CFG_LLM_STREAM_BUF_SIZE) != ESP_OK) {
-        free(post_data);
+        cJSON_Delete(body);
         snprintf(response_buf, buf_size, "Error: Out of memory");
         return ESP_ERR_NO_MEM;
     }
 
-    int status = 0;
-    esp_err_t err = llm_http_call(post_data, &rb, &status);
-    free(post_data);
+    body_sink_t sink = { .rb = &rb };
+    esp_err_t err = llm_http_call(&req, body_len, &sink);
+    int status = sink.status;
+    cJSON_Delete(body);
 
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
@@ -553,20 +1643,13 @@ esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
     }
 
     /* Parse JSON response */
-    cJSON *root = cJSON_Parse(rb.data);
-    resp_buf_free(&rb);
-
-    if (!root) {
+    llm_response_t parsed = {0};
+    if (parse_response(&rb, provider_is_openai(), &parsed) != ESP_OK) {
         snprintf(response_buf, buf_size, "Error: Failed to parse response");
         return ESP_FAIL;
     }
-
-    if (provider_is_openai()) {
-        extract_text_openai(root, response_buf, buf_size);
-    } else {
-        extract_text_anthropic(root, response_buf, buf_size);
-    }
-    cJSON_Delete(root);
+    copy_span(response_buf, buf_size, parsed.text ? parsed.text : "", parsed.text_len);
+    llm_response_free(&parsed);
 
     if (response_buf[0] == '\0') {
         snprintf(response_buf, buf_size, "No response from LLM API");
@@ -592,64 +1675,65 @@ void llm_response_free(llm_response_t *resp)
     resp->tool_use = false;
 }
 
-esp_err_t llm_chat_tools(const char *system_prompt,
-                         cJSON *messages,
-                         const char *tools_json,
-                         llm_response_t *resp)
+/* OpenAI tool request. Messages/tools must be converted anyway, so the
+ * converted tree is serialized directly (no extra copy of the input). */
+static cJSON *build_openai_tools_body(const char *system_prompt, cJSON *messages,
+                                      const char *tools_json, bool stream)
 {
-    memset(resp, 0, sizeof(*resp));
-
-    if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
-
-    /* Build request body (non-streaming) */
     cJSON *body = cJSON_CreateObject();
     cJSON_AddStringToObject(body, "model", s_model);
     cJSON_AddNumberToObject(body, "max_tokens", CFG_LLM_MAX_TOKENS);
+    if (stream) {
+        cJSON_AddBoolToObject(body, "stream", true);
+        cJSON *opts = cJSON_CreateObject();
+        cJSON_AddBoolToObject(opts, "include_usage", true);
+        cJSON_AddItemToObject(body, "stream_options", opts);
+    }
 
-    if (provider_is_openai()) {
-        cJSON *openai_msgs = convert_messages_openai(system_prompt, messages);
-        cJSON_AddItemToObject(body, "messages", openai_msgs);
+    cJSON *openai_msgs = convert_messages_openai(system_prompt, messages);
+    cJSON_AddItemToObject(body, "messages", openai_msgs);
 
-        if (tools_json) {
-            cJSON *tools = convert_tools_openai(tools_json);
-            if (tools) {
-                cJSON_AddItemToObject(body, "tools", tools);
-                cJSON_AddStringToObject(body, "tool_choice", "auto");
-            }
+    if (tools_json) {
+        cJSON *tools = convert_tools_openai(tools_json);
+        if (tools) {
+            cJSON_AddItemToObject(body, "tools", tools);
+            cJSON_AddStringToObject(body, "tool_choice", "auto");
         }
-    } else {
-        cJSON_AddStringToObject(body, "system", system_prompt);
-
-        /* Deep-copy messages so caller keeps ownership */
-        cJSON *msgs_copy = cJSON_Duplicate(messages, 1);
-        cJSON_AddItemToObject(body, "messages", msgs_copy);
+    }
+    return body;
+}
 
-        /* Add tools array if provided */
-        if (tools_json) {
-            cJSON *tools = cJSON_Parse(tools_json);
-            if (tools) {
-                cJSON_AddItemToObject(body, "tools", tools);
-            }
-        }
+static void tools_body_init(llm_body_t *body, const char *system_prompt, cJSON *messages,
+                            const char *tools_json, bool stream)
+{
+    memset(body, 0, sizeof(*body));
+    if (provider_is_openai()) {
+        body->tree = build_openai_tools_body(system_prompt, messages, tools_json, stream);
+    } else {
+        body->system_prompt = system_prompt;
+        body->messages = messages;
+        body->tools_json = tools_json;
+        body->stream = stream;
     }
+}
 
-    char *post_data = cJSON_PrintUnformatted(body);
-    cJSON_Delete(body);
-    if (!post_data) return ESP_ERR_NO_MEM;
+/* Send a prepared tool request and parse the complete JSON response. */
+static esp_err_t chat_tools_send(const llm_body_t *body, bool openai, llm_response_t *resp)
+{
+    size_t body_len = llm_body_length(body);
 
     ESP_LOGI(TAG, "Calling LLM API with tools (provider: %s, model: %s, body: %d bytes)",
-             s_provider, s_model, (int)strlen(post_data));
+             s_provider, s_model, (int)body_len);
 
     /* HTTP call */
     resp_buf_t rb;
     if (resp_buf_init(&rb, CFG_LLM_STREAM_BUF_SIZE) != ESP_OK) {
-        free(post_data);
         return ESP_ERR_NO_MEM;
     }
 
-    int status = 0;
-    esp_err_t err = llm_http_call(post_data, &rb, &status);
-    free(post_data);
+    body_sink_t sink = { .rb = &rb };
+    esp_err_t err = llm_http_call(body, body_len, &sink);
+    int status = sink.status;
 
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
@@ -664,146 +1748,283 @@ esp_err_t llm_chat_tools(const char *system_prompt,
     }
 
     /* Parse full JSON response */
-    cJSON *root = cJSON_Parse(rb.data);
-    resp_buf_free(&rb);
-
-    if (!root) {
+    int64_t t0 = esp_timer_get_time();
+    if (parse_response(&rb, openai, resp) != ESP_OK) {
         ESP_LOGE(TAG, "Failed to parse API response JSON");
         return ESP_FAIL;
     }
+    int parse_us = (int)(esp_timer_get_time() - t0);
 
-    if (provider_is_openai()) {
-        cJSON *choices = cJSON_GetObjectItem(root, "choices");
-        cJSON *choice0 = choices && cJSON_IsArray(choices) ? cJSON_GetArrayItem(choices, 0) : NULL;
-        if (choice0) {
-            cJSON *finish = cJSON_GetObjectItem(choice0, "finish_reason");
-            if (finish && cJSON_IsString(finish)) {
-                resp->tool_use = (strcmp(finish->valuestring, "tool_calls") == 0);
-            }
+    usage_record(&resp->usage);
 
-            cJSON *message = cJSON_GetObjectItem(choice0, "message");
-            if (message) {
-                cJSON *content = cJSON_GetObjectItem(message, "content");
-                if (content && cJSON_IsString(content)) {
-                    size_t tlen = strlen(content->valuestring);
-                    resp->text = calloc(1, tlen + 1);
-                    if (resp->text) {
-                        memcpy(resp->text, content->valuestring, tlen);
-                        resp->text_len = tlen;
-                    }
-                }
+    ESP_LOGI(TAG, "Response: %d bytes text, %d tool calls, stop=%s (parsed in %d us)",
+             (int)resp->text_len, resp->call_count,
+             resp->tool_use ? "tool_use" : "end_turn", parse_us);
 
-                cJSON *tool_calls = cJSON_GetObjectItem(message, "tool_calls");
-                if (tool_calls && cJSON_IsArray(tool_calls)) {
-                    cJSON *tc;
-                    cJSON_ArrayForEach(tc, tool_calls) {
-                        if (resp->call_count >= CFG_MAX_TOOL_CALLS) break;
-                        llm_tool_call_t *call = &resp->calls[resp->call_count];
-                        cJSON *id = cJSON_GetObjectItem(tc, "id");
-                        cJSON *func = cJSON_GetObjectItem(tc, "function");
-                        if (id && cJSON_IsString(id)) {
-                            strncpy(call->id, id->valuestring, sizeof(call->id) - 1);
-                        }
-                        if (func) {
-                            cJSON *name = cJSON_GetObjectItem(func, "name");
-                            cJSON *args = cJSON_GetObjectItem(func, "arguments");
-                            if (name && cJSON_IsString(name)) {
-                                strncpy(call->name, name->valuestring, sizeof(call->name) - 1);
-                            }
-                            if (args && cJSON_IsString(args)) {
-                                call->input = strdup(args->valuestring);
-                                if (call->input) {
-                                    call->input_len = strlen(call->input);
-                                }
-                            }
-                        }
-                        resp->call_count++;
-                    }
-                    if (resp->call_count > 0) {
-                        resp->tool_use = true;
-                    }
-                }
-            }
-        }
-    } else {
-        /* stop_reason */
-        cJSON *stop_reason = cJSON_GetObjectItem(root, "stop_reason");
-        if (stop_reason && cJSON_IsString(stop_reason)) {
-            resp->tool_use = (strcmp(stop_reason->valuestring, "tool_use") == 0);
-        }
+    return ESP_OK;
+}
 
-        /* Iterate content blocks */
-        cJSON *content = cJSON_GetObjectItem(root, "content");
-        if (content && cJSON_IsArray(content)) {
-            /* Accumulate total text length first */
-            size_t total_text = 0;
-            cJSON *block;
-            cJSON_ArrayForEach(block, content) {
-                cJSON *btype = cJSON_GetObjectItem(block, "type");
-                if (btype && cJSON_IsString(btype) && strcmp(btype->valuestring, "text") == 0) {
-                    cJSON *text = cJSON_GetObjectItem(block, "text");
-                    if (text && cJSON_IsString(text)) {
-                        total_text += strlen(text->valuestring);
-                    }
-                }
-            }
+/* Send a prepared tool request with "stream": true and consume the SSE events. */
+static esp_err_t chat_tools_send_stream(const llm_body_t *body, bool openai,
+                                        const llm_stream_cb_t *cb, llm_response_t *resp)
+{
+    size_t body_len = llm_body_length(body);
+
+    ESP_LOGI(TAG, "Calling LLM API with tools, streaming (provider: %s, model: %s, body: %d bytes)",
+             s_provider, s_model, (int)body_len);
+
+    /* Only error bodies land here; SSE events are consumed incrementally */
+    resp_buf_t err_body = {0};
+    sse_parser_t sse = {
+        .tool_slot = -1,
+        .openai = openai,
+        .resp = resp,
+        .cb = cb,
+    };
+    body_sink_t sink = { .rb = &err_body, .sse = &sse };
 
-            /* Allocate and copy text */
-            if (total_text > 0) {
-                resp->text = calloc(1, total_text + 1);
-                if (resp->text) {
-                    cJSON_ArrayForEach(block, content) {
-                        cJSON *btype = cJSON_GetObjectItem(block, "type");
-                        if (!btype || !cJSON_IsString(btype) || strcmp(btype->valuestring, "text") != 0) continue;
-                        cJSON *text = cJSON_GetObjectItem(block, "text");
-                        if (!text || !cJSON_IsString(text)) continue;
-                        size_t tlen = strlen(text->valuestring);
-                        memcpy(resp->text + resp->text_len, text->valuestring, tlen);
-                        resp->text_len += tlen;
-                    }
-                    resp->text[resp->text_len] = '\0';
-                }
-            }
+    esp_err_t err = llm_http_call(body, body_len, &sink);
+    sse_finish(&sse);
 
-            /* Extract tool_use blocks */
-            cJSON_ArrayForEach(block, content) {
-                cJSON *btype = cJSON_GetObjectItem(block, "type");
-                if (!btype || !cJSON_IsString(btype) || strcmp(btype->valuestring, "tool_use") != 0) continue;
-                if (resp->call_count >= CFG_MAX_TOOL_CALLS) break;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
+        resp_buf_free(&err_body);
+        llm_response_free(resp);
+        return err;
+    }
 
-                llm_tool_call_t *call = &resp->calls[resp->call_count];
+    if (sink.status != 200) {
+        ESP_LOGE(TAG, "API error %d: %.500s", sink.status,
+                 err_body.data ? err_body.data : "");
+        resp_buf_free(&err_body);
+        llm_response_free(resp);
+        return ESP_FAIL;
+    }
+    resp_buf_free(&err_body);
 
-                cJSON *id = cJSON_GetObjectItem(block, "id");
-                if (id && cJSON_IsString(id)) {
-                    strncpy(call->id, id->valuestring, sizeof(call->id) - 1);
-                }
+    if (sse.failed) {
+        llm_response_free(resp);
+        return ESP_FAIL;
+    }
 
-                cJSON *name = cJSON_GetObjectItem(block, "name");
-                if (name && cJSON_IsString(name)) {
-                    strncpy(call->name, name->valuestring, sizeof(call->name) - 1);
-                }
+    usage_record(&resp->usage);
 
-                cJSON *input = cJSON_GetObjectItem(block, "input");
-                if (input) {
-                    char *input_str = cJSON_PrintUnformatted(input);
-                    if (input_str) {
-                        call->input = input_str;
-                        call->input_len = strlen(input_str);
-                    }
-                }
+    ESP_LOGI(TAG, "Streamed response: %d bytes text, %d tool calls, stop=%s",
+             (int)resp->text_len, resp->call_count,
+             resp->tool_use ? "tool_use" : "end_turn");
 
-                resp->call_count++;
-            }
+    return ESP_OK;
+}
+
+esp_err_t llm_chat_tools(const char *system_prompt,
+                         cJSON *messages,
+                         const char *tools_json,
+                         llm_response_t *resp)
+{
+    memset(resp, 0, sizeof(*resp));
+
+    if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
+
+    llm_body_t body;
+    tools_body_init(&body, system_prompt, messages, tools_json, false);
+    esp_err_t err = chat_tools_send(&body, provider_is_openai(), resp);
+    cJSON_Delete(body.tree);
+    return err;
+}
+
+/* ── Public: chat with tools (streaming) ──────────────────────── */
+
+esp_err_t llm_chat_tools_stream(const char *system_prompt,
+                                cJSON *messages,
+                                const char *tools_json,
+                                const llm_stream_cb_t *cb,
+                                llm_response_t *resp)
+{
+    memset(resp, 0, sizeof(*resp));
+
+    if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
+
+    llm_body_t body;
+    tools_body_init(&body, system_prompt, messages, tools_json, true);
+    esp_err_t err = chat_tools_send_stream(&body, provider_is_openai(), cb, resp);
+    cJSON_Delete(body.tree);
+    return err;
+}
+
+/* ── Public: multi-iteration request (serialized prefix cache) ── */
+
+/*
+ * Everything that does not change between ReAct iterations (model,
+ * system prompt, tools, earlier messages) is serialized once into
+ * `prefix`, which ends inside the open "messages" array. Each iteration
+ * only serializes what it appends. For Anthropic the newest message is
+ * kept as a tree until the next append, because it carries the moving
+ * cache_control breakpoint; OpenAI messages are converted and settled
+ * immediately.
+ */
+struct llm_conv {
+    bool        openai;
+    resp_buf_t  prefix;
+    bool        has_msgs;       /* prefix already holds a message (needs ',') */
+    cJSON      *pending;        /* Anthropic: newest message, not yet in prefix */
+    esp_err_t   err;            /* sticky serialization error */
+};
+
+static esp_err_t conv_flush(const char *data, size_t len, void *ctx)
+{
+    return resp_buf_append((resp_buf_t *)ctx, data, len);
+}
+
+static void conv_write_msg(llm_conv_t *conv, json_writer_t *w, const cJSON *msg)
+{
+    if (conv->has_msgs) json_writer_raw(w, ",", 1);
+    json_writer_cjson(w, msg);
+    conv->has_msgs = true;
+}
+
+/* Move the pending message (or an OpenAI message) into the prefix. Takes ownership. */
+static void conv_settle(llm_conv_t *conv, cJSON *msg)
+{
+    if (!msg) return;
+
+    char window[256];
+    json_writer_t w;
+    json_writer_init(&w, window, sizeof(window), conv_flush, &conv->prefix);
+
+    if (conv->openai) {
+        cJSON *one = cJSON_CreateArray();
+        cJSON_AddItemToArray(one, msg);
+        cJSON *converted = convert_messages_openai(NULL, one);
+        cJSON_Delete(one);
+        const cJSON *m;
+        cJSON_ArrayForEach(m, converted) {
+            conv_write_msg(conv, &w, m);
         }
+        cJSON_Delete(converted);
+    } else {
+        conv_write_msg(conv, &w, msg);
+        cJSON_Delete(msg);
     }
 
-    cJSON_Delete(root);
+    esp_err_t err = json_writer_finish(&w);
+    if (err != ESP_OK && conv->err == ESP_OK) conv->err = err;
+}
 
-    ESP_LOGI(TAG, "Response: %d bytes text, %d tool calls, stop=%s",
-             (int)resp->text_len, resp->call_count,
-             resp->tool_use ? "tool_use" : "end_turn");
+static void write_conv_body(json_writer_t *w, const llm_body_t *b)
+{
+    const llm_conv_t *conv = b->conv;
 
-    return ESP_OK;
+    json_writer_raw(w, conv->prefix.data, conv->prefix.len);
+    if (conv->pending) {
+        if (conv->has_msgs) json_writer_raw(w, ",", 1);
+        write_message_cached(w, conv->pending);
+    }
+    json_writer_raw(w, "]", 1);
+    if (b->stream) {
+        json_writer_lit(w, ",\"stream\":true");
+        if (conv->openai) json_writer_lit(w, ",\"stream_options\":{\"include_usage\":true}");
+    }
+    json_writer_raw(w, "}", 1);
+}
+
+llm_conv_t *llm_conv_create(const char *system_prompt, const char *tools_json, cJSON *messages)
+{
+    llm_conv_t *conv = calloc(1, sizeof(*conv));
+    if (!conv || resp_buf_alloc(&conv->prefix, 8 * 1024) != ESP_OK) {
+        free(conv);
+        cJSON_Delete(messages);
+        return NULL;
+    }
+    conv->openai = provider_is_openai();
+
+    char window[256];
+    json_writer_t w;
+    json_writer_init(&w, window, sizeof(window), conv_flush, &conv->prefix);
+
+    json_writer_lit(&w, "{\"model\":");
+    json_writer_string(&w, s_model, strlen(s_model));
+    json_writer_lit(&w, ",\"max_tokens\":");
+    json_writer_int(&w, CFG_LLM_MAX_TOKENS);
+
+    if (conv->openai) {
+        cJSON *tools = convert_tools_openai(tools_json);
+        if (tools) {
+            json_writer_lit(&w, ",\"tools\":");
+            json_writer_cjson(&w, tools);
+            json_writer_lit(&w, ",\"tool_choice\":\"auto\"");
+            cJSON_Delete(tools);
+        }
+        json_writer_lit(&w, ",\"messages\":[");
+        cJSON *sys = convert_messages_openai(system_prompt, NULL);
+        const cJSON *m;
+        cJSON_ArrayForEach(m, sys) {
+            conv_write_msg(conv, &w, m);
+        }
+        cJSON_Delete(sys);
+    } else {
+        json_writer_lit(&w, ",\"system\":");
+        write_system_blocks(&w, system_prompt ? system_prompt : "");
+        if (tools_json) {
+            json_writer_lit(&w, ",\"tools\":");
+            write_tools_cached(&w, tools_json);
+        }
+        json_writer_lit(&w, ",\"messages\":[");
+    }
+    conv->err = json_writer_finish(&w);
+
+    /* Take over the initial messages one by one */
+    if (messages) {
+        cJSON *msg;
+        while ((msg = cJSON_DetachItemFromArray(messages, 0)) != NULL) {
+            llm_conv_append(conv, msg);
+        }
+        cJSON_Delete(messages);
+    }
+
+    ESP_LOGI(TAG, "Request prefix cached: %d bytes", (int)conv->prefix.len);
+    return conv;
+}
+
+void llm_conv_append(llm_conv_t *conv, cJSON *message)
+{
+    if (!message) return;
+    if (conv->openai) {
+        conv_settle(conv, message);
+    } else {
+        conv_settle(conv, conv->pending);
+        conv->pending = message;
+    }
+}
+
+esp_err_t llm_conv_chat(llm_conv_t *conv, llm_response_t *resp)
+{
+    memset(resp, 0, sizeof(*resp));
+
+    if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
+    if (conv->err != ESP_OK) return conv->err;
+
+    llm_body_t body = { .conv = conv };
+    return chat_tools_send(&body, conv->openai, resp);
+}
+
+esp_err_t llm_conv_chat_stream(llm_conv_t *conv, const llm_stream_cb_t *cb,
+                               llm_response_t *resp)
+{
+    memset(resp, 0, sizeof(*resp));
+
+    if (s_api_key[0] == '\0') return ESP_ERR_INVALID_STATE;
+    if (conv->err != ESP_OK) return conv->err;
+
+    llm_body_t body = { .conv = conv, .stream = true };
+    return chat_tools_send_stream(&body, conv->openai, cb, resp);
+}
+
+void llm_conv_free(llm_conv_t *conv)
+{
+    if (!conv) return;
+    cJSON_Delete(conv->pending);
+    resp_buf_free(&conv->prefix);
+    free(conv);
 }
 
 /* ── NVS helpers ──────────────────────────────────────────────── */
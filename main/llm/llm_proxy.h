@@ -3,6 +3,7 @@
 #include "esp_err.h"
 #include "cJSON.h"
 #include <stddef.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #include "device_config.h"
@@ -39,6 +40,42 @@ esp_err_t llm_set_model(const char *model);
 esp_err_t llm_chat(const char *system_prompt, const char *messages_json,
                    char *response_buf, size_t buf_size);
 
+/* ── Prompt caching ────────────────────────────────────────────── */
+
+/**
+ * Optional marker inside a system prompt. Everything before it is the
+ * stable prefix and gets an Anthropic cache_control breakpoint; everything
+ * after it (per-turn data) is sent uncached. The marker itself is never
+ * sent to the provider.
+ */
+#define LLM_SYSTEM_CACHE_BREAK      "\x1e"
+
+typedef struct {
+    uint32_t input_tokens;           /* uncached input tokens */
+    uint32_t output_tokens;
+    uint32_t cache_creation_tokens;  /* input tokens written to the cache */
+    uint32_t cache_read_tokens;      /* input tokens served from the cache */
+} llm_usage_t;
+
+typedef struct {
+    uint32_t    calls;               /* successful calls with usage info */
+    uint32_t    cache_hits;          /* calls with cache_read_tokens > 0 */
+    uint64_t    input_tokens;
+    uint64_t    output_tokens;
+    uint64_t    cache_creation_tokens;
+    uint64_t    cache_read_tokens;
+    llm_usage_t last;
+} llm_cache_stats_t;
+
+/** Copy cumulative token/cache counters since boot (or last reset). */
+void llm_get_cache_stats(llm_cache_stats_t *out);
+
+/** Zero the cumulative counters. */
+void llm_reset_cache_stats(void);
+
+/** Number of LLM requests currently in flight (all tasks). */
+int llm_inflight(void);
+
 /* ── Tool Use Support ──────────────────────────────────────────── */
 
 typedef struct {
@@ -54,6 +91,7 @@ typedef struct {
     llm_tool_call_t calls[CFG_MAX_TOOL_CALLS];
     int call_count;
     bool tool_use;                               /* stop_reason == "tool_use" */
+    llm_usage_t usage;                           /* token counts from "usage" */
 } llm_response_t;
 
 void llm_response_free(llm_response_t *resp);
@@ -71,3 +109,54 @@ esp_err_t llm_chat_tools(const char *system_prompt,
                          cJSON *messages,
                          const char *tools_json,
                          llm_response_t *resp);
+
+/* ── Streaming (SSE) ───────────────────────────────────────────── */
+
+typedef struct {
+    /** Called for each text delta as it arrives (not NUL-terminated beyond len). */
+    void (*on_text)(const char *delta, size_t len, void *ctx);
+    /** Called once per tool call when its input JSON is complete. */
+    void (*on_tool_use)(const llm_tool_call_t *call, void *ctx);
+    void *ctx;
+} llm_stream_cb_t;
+
+/**
+ * Same as llm_chat_tools() but requests "stream": true and parses the
+ * server-sent events incrementally. Callbacks fire from the calling task
+ * while the response is still being received; on return resp holds the
+ * same accumulated result llm_chat_tools() would have produced.
+ *
+ * @param cb    Delta callbacks, or NULL to only accumulate into resp
+ */
+esp_err_t llm_chat_tools_stream(const char *system_prompt,
+                                cJSON *messages,
+                                const char *tools_json,
+                                const llm_stream_cb_t *cb,
+                                llm_response_t *resp);
+
+/* ── Multi-iteration request (serialized prefix cache) ─────────── */
+
+typedef struct llm_conv llm_conv_t;
+
+/**
+ * Start a tool-calling request for one user turn. The model, system prompt,
+ * tools and the initial messages are serialized once; later iterations
+ * only serialize the messages appended with llm_conv_append().
+ *
+ * @param messages  cJSON array of initial messages. Ownership is taken.
+ * @return NULL on allocation failure.
+ */
+llm_conv_t *llm_conv_create(const char *system_prompt, const char *tools_json,
+                            cJSON *messages);
+
+/** Append a message (assistant tool_use turn, tool_result turn). Ownership is taken. */
+void llm_conv_append(llm_conv_t *conv, cJSON *message);
+
+/** Same as llm_chat_tools(), using the cached request prefix. */
+esp_err_t llm_conv_chat(llm_conv_t *conv, llm_response_t *resp);
+
+/** Same as llm_chat_tools_stream(), using the cached request prefix. */
+esp_err_t llm_conv_chat_stream(llm_conv_t *conv, const llm_stream_cb_t *cb,
+                               llm_response_t *resp);
+
+void llm_conv_free(llm_conv_t *conv);
@@ -1,6 +1,7 @@
 #include "atom_session.h"
 #include "atom_config.h"
 
+#include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -8,79 +9,540 @@
 #include "esp_heap_caps.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/semphr.h"
+#include "freertos/task.h"
 #include "cJSON.h"
 
 static const char *TAG = "atom_session";
 
 /* ── Data structures ─────────────────────────────────────────────────── */
 
-typedef struct {
-    char role[12];                          /* "user" or "assistant" */
-    char content[ATOM_SESSION_MSG_MAX_LEN]; /* truncated message text */
-} atom_msg_t;
+/* Messages are packed back-to-back in a per-user byte arena, oldest first:
+ *   [role:1]['len':2 LE][text:len]['\0']
+ * Appending past ATOM_SESSION_USER_BYTES drops records from the front. */
+#define REC_HDR     3
+#define REC_SIZE(n) (REC_HDR + (n) + 1)
+
+#define ROLE_USER       'u'
+#define ROLE_ASSISTANT  'a'
+
+_Static_assert(ATOM_SESSION_USER_BYTES <= UINT16_MAX, "arena offsets are 16-bit");
 
 typedef struct {
-    char      user_id[32];
-    atom_msg_t msgs[ATOM_SESSION_MAX_MSGS]; /* ring buffer */
-    int       head;     /* index of next write position */
-    int       count;    /* number of valid entries (0..MAX_MSGS) */
+    char      user_id[64];
+    uint16_t  used;     /* bytes of arena holding records */
+    uint16_t  count;    /* number of records in the arena */
     bool      in_use;
+    int       lru_prev; /* towards most recently used, -1 = none */
+    int       lru_next; /* towards least recently used / next free slot */
+    uint32_t  log_gen;  /* last compaction that snapshotted this session */
+    uint8_t   arena[ATOM_SESSION_USER_BYTES];
 } atom_user_session_t;
 
 static atom_user_session_t *s_sessions = NULL;   /* PSRAM or internal RAM array */
+static int                  s_slots    = 0;      /* sized at boot */
 static SemaphoreHandle_t    s_mutex    = NULL;
 static bool                 s_using_psram = false;
 
+/* Open-addressing (linear probing) index: user_id hash -> slot, -1 = empty.
+ * Capacity is a power of two, at least twice the slot count. */
+static int32_t *s_index     = NULL;
+static uint32_t s_index_cap = 0;
+
+/* LRU list of used slots and a free list threaded through lru_next */
+static int s_lru_head = -1;     /* most recently active */
+static int s_lru_tail = -1;     /* eviction candidate */
+static int s_free     = -1;
+
+/* Write-behind log. Records are [op:1][uid_len:1][text_len:2 LE][user_id][text]
+ * where op is ROLE_USER / ROLE_ASSISTANT for an append or LOG_OP_CLEAR.
+ * Appends fill s_log_buf under s_mutex; the log task swaps it with
+ * s_log_out and writes that to flash. While a compaction runs, queued
+ * records its snapshot will contain carry LOG_OP_COVERED in op; they are
+ * dropped once the new log is in place, or kept if the compaction fails. */
+#define LOG_OP_CLEAR    'c'
+#define LOG_OP_COVERED  0x80
+#define LOG_HDR         4
+#define LOG_TMP_FILE    ATOM_SESSION_LOG_FILE ".tmp"
+
+static uint8_t     *s_log_buf    = NULL;
+static uint8_t     *s_log_out    = NULL;
+static size_t       s_log_len    = 0;
+static long         s_log_size   = 0;     /* bytes in the log file (log task only) */
+static long         s_log_base   = 0;     /* s_log_size after the last compaction */
+static TaskHandle_t s_log_task   = NULL;
+static uint32_t     s_compact_gen = 0;
+static bool         s_compacting = false;
+
 /* ── Helpers ─────────────────────────────────────────────────────────── */
 
-/* Find session slot for user_id, or allocate a new one.
- * Returns NULL if no slot available.  Caller must hold mutex. */
+static uint32_t hash_id(const char *s)
+{
+    uint32_t h = 2166136261u;      /* FNV-1a */
+    while (*s) {
+        h ^= (uint8_t)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/* Index position holding user_id, or the empty position where it would go. */
+static uint32_t index_probe(const char *user_id)
+{
+    uint32_t mask = s_index_cap - 1;
+    uint32_t pos  = hash_id(user_id) & mask;
+    while (s_index[pos] >= 0 &&
+           strcmp(s_sessions[s_index[pos]].user_id, user_id) != 0) {
+        pos = (pos + 1) & mask;
+    }
+    return pos;
+}
+
+/* Remove position pos, shifting later entries of the probe run back so
+ * lookups never need tombstones. */
+static void index_remove_at(uint32_t pos)
+{
+    uint32_t mask = s_index_cap - 1;
+    s_index[pos] = -1;
+    uint32_t next = (pos + 1) & mask;
+    while (s_index[next] >= 0) {
+        int32_t  slot  = s_index[next];
+        uint32_t ideal = hash_id(s_sessions[slot].user_id) & mask;
+        /* Move it into the hole if the hole lies on its probe path */
+        if (((next - ideal) & mask) >= ((next - pos) & mask)) {
+            s_index[pos]  = slot;
+            s_index[next] = -1;
+            pos = next;
+        }
+        next = (next + 1) & mask;
+    }
+}
+
+static void lru_unlink(int i)
+{
+    atom_user_session_t *e = &s_sessions[i];
+    if (e->lru_prev >= 0) s_sessions[e->lru_prev].lru_next = e->lru_next;
+    else                  s_lru_head = e->lru_next;
+    if (e->lru_next >= 0) s_sessions[e->lru_next].lru_prev = e->lru_prev;
+    else                  s_lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = -1;
+}
+
+static void lru_push_front(int i)
+{
+    atom_user_session_t *e = &s_sessions[i];
+    e->lru_prev = -1;
+    e->lru_next = s_lru_head;
+    if (s_lru_head >= 0) s_sessions[s_lru_head].lru_prev = i;
+    s_lru_head = i;
+    if (s_lru_tail < 0) s_lru_tail = i;
+}
+
+static void lru_touch(int i)
+{
+    if (s_lru_head == i) return;
+    lru_unlink(i);
+    lru_push_front(i);
+}
+
+/* Drop slot i from the index and LRU list and put it on the free list.
+ * Caller must hold mutex. */
+static void release_slot(int i)
+{
+    index_remove_at(index_probe(s_sessions[i].user_id));
+    lru_unlink(i);
+    memset(&s_sessions[i], 0, sizeof(s_sessions[i]));
+    s_sessions[i].lru_prev = -1;
+    s_sessions[i].lru_next = s_free;
+    s_free = i;
+}
+
+/* Find the session for user_id, or NULL. Caller must hold mutex. */
+static atom_user_session_t *find(const char *user_id)
+{
+    int32_t slot = s_index[index_probe(user_id)];
+    if (slot < 0) return NULL;
+    lru_touch(slot);
+    return &s_sessions[slot];
+}
+
+/* Find session slot for user_id, or allocate a new one, evicting the
+ * least recently active session when the table is full.
+ * Caller must hold mutex. */
 static atom_user_session_t *find_or_alloc(const char *user_id)
 {
-    atom_user_session_t *empty = NULL;
-    for (int i = 0; i < ATOM_SESSION_MAX_USERS; i++) {
-        if (s_sessions[i].in_use &&
-            strncmp(s_sessions[i].user_id, user_id, sizeof(s_sessions[i].user_id)-1) == 0) {
-            return &s_sessions[i];
+    atom_user_session_t *sess = find(user_id);
+    if (sess) return sess;
+
+    if (s_free < 0) {
+        ESP_LOGD(TAG, "Evicting session for user %s", s_sessions[s_lru_tail].user_id);
+        release_slot(s_lru_tail);
+    }
+
+    int i = s_free;
+    s_free = s_sessions[i].lru_next;
+
+    sess = &s_sessions[i];
+    memset(sess, 0, sizeof(*sess));
+    strncpy(sess->user_id, user_id, sizeof(sess->user_id) - 1);
+    sess->in_use = true;
+    sess->log_gen = s_compact_gen;    /* nothing for a running compaction to copy */
+    s_index[index_probe(sess->user_id)] = i;
+    lru_push_front(i);
+    ESP_LOGD(TAG, "New session for user %s", user_id);
+    return sess;
+}
+
+static inline uint16_t rec_len(const uint8_t *rec)
+{
+    return (uint16_t)(rec[1] | (rec[2] << 8));
+}
+
+/* Longest prefix of s (at most max bytes) that ends on a UTF-8 boundary. */
+static size_t utf8_clip(const char *s, size_t max)
+{
+    size_t n = strnlen(s, max + 1);
+    if (n <= max) return n;
+    n = max;
+    while (n > 0 && ((uint8_t)s[n] & 0xC0) == 0x80) n--;
+    return n;
+}
+
+/* Longest text a single record may hold. */
+static size_t msg_cap(void)
+{
+    size_t max = ATOM_SESSION_MSG_MAX_LEN;
+    if (max > ATOM_SESSION_USER_BYTES - REC_SIZE(0)) max = ATOM_SESSION_USER_BYTES - REC_SIZE(0);
+    return max;
+}
+
+/* Append one record to sess, dropping the oldest ones until it fits. */
+static void arena_push(atom_user_session_t *sess, char role,
+                       const char *text, size_t len)
+{
+    size_t need = REC_SIZE(len);
+    size_t drop = 0;
+    while (sess->used - drop + need > ATOM_SESSION_USER_BYTES) {
+        drop += REC_SIZE(rec_len(sess->arena + drop));
+        sess->count--;
+    }
+    if (drop) {
+        memmove(sess->arena, sess->arena + drop, sess->used - drop);
+        sess->used -= drop;
+    }
+
+    uint8_t *rec = sess->arena + sess->used;
+    rec[0] = (uint8_t)role;
+    rec[1] = (uint8_t)(len & 0xFF);
+    rec[2] = (uint8_t)(len >> 8);
+    memcpy(rec + REC_HDR, text, len);
+    rec[REC_HDR + len] = '\0';
+    sess->used += need;
+    sess->count++;
+}
+
+/* Slot count for this boot: a share of free PSRAM, clamped to the config. */
+static int size_slots(void)
+{
+    size_t free_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    if (free_psram == 0) return ATOM_SESSION_MIN_USERS;
+
+    size_t budget = free_psram / 100 * ATOM_SESSION_PSRAM_PCT;
+    size_t n = budget / sizeof(atom_user_session_t);
+    if (n < ATOM_SESSION_MIN_USERS) n = ATOM_SESSION_MIN_USERS;
+    if (n > ATOM_SESSION_MAX_USERS) n = ATOM_SESSION_MAX_USERS;
+    return (int)n;
+}
+
+/* ── Write-behind log ────────────────────────────────────────────────── */
+
+static inline size_t log_rec_size(const uint8_t *rec)
+{
+    return LOG_HDR + rec[1] + (rec[2] | (rec[3] << 8));
+}
+
+/* Queue one log record for sess's user for the log task.
+ * Caller must hold mutex. */
+static void log_queue(char op, const atom_user_session_t *sess, const char *text, size_t len)
+{
+    if (!s_log_buf) return;
+
+    /* A running compaction still has to copy this session */
+    const char *user_id = sess->user_id;
+    uint8_t covered = (s_compacting && sess->log_gen != s_compact_gen) ? LOG_OP_COVERED : 0;
+
+    size_t uid_len = strlen(user_id);
+    size_t need    = LOG_HDR + uid_len + len;
+    if (s_log_len + need > ATOM_SESSION_LOG_BUF_BYTES) {
+        ESP_LOGW(TAG, "Session log buffer full, record for %s not persisted", user_id);
+        return;
+    }
+    uint8_t *p = s_log_buf + s_log_len;
+    p[0] = (uint8_t)op | covered;
+    p[1] = (uint8_t)uid_len;
+    p[2] = (uint8_t)(len & 0xFF);
+    p[3] = (uint8_t)(len >> 8);
+    memcpy(p + LOG_HDR, user_id, uid_len);
+    memcpy(p + LOG_HDR + uid_len, text, len);
+    s_log_len += need;
+
+    if (s_log_len >= ATOM_SESSION_FLUSH_BYTES && s_log_task) {
+        xTaskNotifyGive(s_log_task);
+    }
+}
+
+/* Rebuild sessions from the log. Runs from init before anything else
+ * touches the table, and before s_log_buf exists so nothing is re-logged. */
+static void log_replay(void)
+{
+    FILE *f = fopen(ATOM_SESSION_LOG_FILE, "rb");
+    if (!f) f = fopen(LOG_TMP_FILE, "rb");     /* crashed mid-compaction */
+    if (!f) return;
+
+    char *text = malloc(ATOM_SESSION_MSG_MAX_LEN + 1);
+    if (!text) {
+        fclose(f);
+        return;
+    }
+
+    uint8_t hdr[LOG_HDR];
+    char    uid[sizeof(((atom_user_session_t *)0)->user_id)];
+    int     records = 0;
+    while (fread(hdr, 1, LOG_HDR, f) == LOG_HDR) {
+        size_t uid_len = hdr[1];
+        size_t len     = hdr[2] | (hdr[3] << 8);
+        bool   op_ok   = hdr[0] == ROLE_USER || hdr[0] == ROLE_ASSISTANT ||
+                         hdr[0] == LOG_OP_CLEAR;
+        if (!op_ok || uid_len == 0 || uid_len >= sizeof(uid) || len > msg_cap()) {
+            ESP_LOGW(TAG, "Corrupt session log record at #%d, stopping replay", records);
+            break;
+        }
+        if (fread(uid, 1, uid_len, f) != uid_len || fread(text, 1, len, f) != len) {
+            break;      /* torn tail from an interrupted write */
         }
-        if (!s_sessions[i].in_use && !empty) {
-            empty = &s_sessions[i];
+        uid[uid_len] = '\0';
+        text[len]    = '\0';
+
+        if (hdr[0] == LOG_OP_CLEAR) {
+            int32_t slot = s_index[index_probe(uid)];
+            if (slot >= 0) release_slot(slot);
+        } else {
+            arena_push(find_or_alloc(uid), (char)hdr[0], text, len);
         }
+        records++;
     }
-    if (empty) {
-        memset(empty, 0, sizeof(*empty));
-        strncpy(empty->user_id, user_id, sizeof(empty->user_id) - 1);
-        empty->in_use = true;
-        ESP_LOGD(TAG, "New session for user %s", user_id);
+    fclose(f);
+    free(text);
+    ESP_LOGI(TAG, "Restored %d session records from flash", records);
+}
+
+/* Write out everything queued so far. Log task only. */
+static void log_flush(void)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint8_t *out = s_log_buf;
+    size_t   len = s_log_len;
+    s_log_buf = s_log_out;
+    s_log_out = out;
+    s_log_len = 0;
+    xSemaphoreGive(s_mutex);
+    if (len == 0) return;
+
+    FILE *f = fopen(ATOM_SESSION_LOG_FILE, "ab");
+    if (!f) {
+        ESP_LOGW(TAG, "Cannot open session log, %d bytes not persisted", (int)len);
+        return;
+    }
+    size_t n = fwrite(out, 1, len, f);
+    fclose(f);
+    s_log_size += (long)n;
+    if (n != len) ESP_LOGW(TAG, "Session log short write (%d/%d)", (int)n, (int)len);
+}
+
+/* After a compaction: drop the queued records its snapshot contains if the
+ * new log is in place, otherwise keep them for the old log.
+ * Caller must hold mutex. */
+static void log_settle(bool committed)
+{
+    size_t in = 0, out = 0;
+    while (in < s_log_len) {
+        uint8_t *rec  = s_log_buf + in;
+        size_t   size = log_rec_size(rec);
+        in += size;
+        if (rec[0] & LOG_OP_COVERED) {
+            if (committed) continue;
+            rec[0] &= (uint8_t)~LOG_OP_COVERED;
+        }
+        if (out != in - size) memmove(s_log_buf + out, rec, size);
+        out += size;
     }
-    return empty;
+    s_log_len = out;
+}
+
+/* Rewrite the log from the sessions in RAM, oldest first so replay restores
+ * the LRU order. Sessions are copied one at a time so appends are only
+ * blocked for a memcpy; the generation stamp marks which queued records
+ * the copy supersedes (see log_settle). Log task only. */
+static void log_compact(void)
+{
+    log_flush();
+
+    int *order = malloc(s_slots * sizeof(int));
+    atom_user_session_t *copy = heap_caps_malloc(sizeof(*copy), MALLOC_CAP_SPIRAM);
+    if (!copy) copy = malloc(sizeof(*copy));
+    FILE *out = (order && copy) ? fopen(LOG_TMP_FILE, "wb") : NULL;
+    if (!out) {
+        ESP_LOGW(TAG, "Session log compaction skipped");
+        s_log_base = s_log_size;
+        free(order);
+        free(copy);
+        return;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t gen = ++s_compact_gen;
+    s_compacting = true;
+    /* Queued so far: every session is still to be copied */
+    for (size_t off = 0; off < s_log_len; off += log_rec_size(s_log_buf + off)) {
+        s_log_buf[off] |= LOG_OP_COVERED;
+    }
+    int n = 0;
+    for (int i = s_lru_tail; i >= 0; i = s_sessions[i].lru_prev) order[n++] = i;
+    xSemaphoreGive(s_mutex);
+
+    long written = 0;
+    bool ok = true;
+    for (int k = 0; k < n && ok; k++) {
+        bool have = false;
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+        atom_user_session_t *sess = &s_sessions[order[k]];
+        if (sess->in_use && sess->log_gen != gen) {
+            memcpy(copy, sess, sizeof(*copy));
+            sess->log_gen = gen;
+            have = true;
+        }
+        xSemaphoreGive(s_mutex);
+        if (!have) continue;
+
+        size_t uid_len = strlen(copy->user_id);
+        const uint8_t *rec = copy->arena;
+        const uint8_t *end = copy->arena + copy->used;
+        for (; rec < end && ok; rec += REC_SIZE(rec_len(rec))) {
+            uint16_t len = rec_len(rec);
+            uint8_t  hdr[LOG_HDR] = { rec[0], (uint8_t)uid_len, rec[1], rec[2] };
+            ok = fwrite(hdr, 1, LOG_HDR, out) == LOG_HDR &&
+                 fwrite(copy->user_id, 1, uid_len, out) == uid_len &&
+                 fwrite(rec + REC_HDR, 1, len, out) == len;
+            written += LOG_HDR + uid_len + len;
+        }
+    }
+    if (fclose(out) != 0) ok = false;
+
+    bool committed = false;
+    if (ok) {
+        remove(ATOM_SESSION_LOG_FILE);
+        if (rename(LOG_TMP_FILE, ATOM_SESSION_LOG_FILE) == 0) {
+            s_log_size = written;
+            committed = true;
+            ESP_LOGI(TAG, "Session log compacted to %ld bytes", written);
+        } else {
+            ESP_LOGE(TAG, "Session log rename failed");
+        }
+    } else {
+        ESP_LOGW(TAG, "Session log compaction failed, keeping previous log");
+        remove(LOG_TMP_FILE);
+    }
+    /* On failure, wait for as much new growth before trying again */
+    s_log_base = s_log_size;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    log_settle(committed);
+    s_compacting = false;
+    xSemaphoreGive(s_mutex);
+
+    free(order);
+    free(copy);
+}
+
+static void log_task(void *arg)
+{
+    (void)arg;
+    /* Drop superseded records and any torn tail left by the last run */
+    log_compact();
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ATOM_SESSION_FLUSH_MS));
+        log_flush();
+        /* A snapshot alone may exceed the cap; compact once the log has
+         * doubled since, so a large snapshot is not rewritten every flush */
+        if (s_log_size > ATOM_SESSION_LOG_MAX_BYTES && s_log_size > 2 * s_log_base) {
+            log_compact();
+        }
+    }
+}
+
+/* Start write-behind persistence. Sessions still work in RAM if this fails. */
+static void log_start(void)
+{
+    s_log_buf = heap_caps_malloc(ATOM_SESSION_LOG_BUF_BYTES, MALLOC_CAP_SPIRAM);
+    s_log_out = heap_caps_malloc(ATOM_SESSION_LOG_BUF_BYTES, MALLOC_CAP_SPIRAM);
+    if (!s_log_buf) s_log_buf = malloc(ATOM_SESSION_LOG_BUF_BYTES);
+    if (!s_log_out) s_log_out = malloc(ATOM_SESSION_LOG_BUF_BYTES);
+    if (s_log_buf && s_log_out &&
+        xTaskCreate(log_task, "sess_log", ATOM_SESSION_LOG_STACK, NULL,
+                    ATOM_SESSION_LOG_PRIO, &s_log_task) == pdPASS) {
+        return;
+    }
+    ESP_LOGW(TAG, "Session log disabled, history will not survive reboot");
+    free(s_log_buf);
+    free(s_log_out);
+    s_log_buf = s_log_out = NULL;
 }
 
 /* ── Public API ──────────────────────────────────────────────────────── */
 
 esp_err_t atom_session_init(void)
 {
+    s_slots = size_slots();
+
     /* Prefer PSRAM, but allow internal RAM fallback for PSRAM-less boards. */
-    s_sessions = heap_caps_calloc(ATOM_SESSION_MAX_USERS,
-                                  sizeof(atom_user_session_t),
+    s_sessions = heap_caps_calloc(s_slots, sizeof(atom_user_session_t),
                                   MALLOC_CAP_SPIRAM);
     s_using_psram = (s_sessions != NULL);
     if (!s_sessions) {
-        s_sessions = calloc(ATOM_SESSION_MAX_USERS, sizeof(atom_user_session_t));
+        s_slots = ATOM_SESSION_MIN_USERS;
+        s_sessions = calloc(s_slots, sizeof(atom_user_session_t));
     }
     if (!s_sessions) {
         ESP_LOGE(TAG, "Failed to allocate session buffer");
         return ESP_ERR_NO_MEM;
     }
 
+    s_index_cap = 1;
+    while (s_index_cap < (uint32_t)s_slots * 2) s_index_cap <<= 1;
+    s_index = s_using_psram
+        ? heap_caps_malloc(s_index_cap * sizeof(int32_t), MALLOC_CAP_SPIRAM)
+        : malloc(s_index_cap * sizeof(int32_t));
     s_mutex = xSemaphoreCreateMutex();
-    if (!s_mutex) {
+    if (!s_index || !s_mutex) {
+        free(s_index);
         free(s_sessions);
+        if (s_mutex) vSemaphoreDelete(s_mutex);
         return ESP_ERR_NO_MEM;
     }
+    memset(s_index, 0xFF, s_index_cap * sizeof(int32_t));   /* all -1 */
+
+    /* Every slot starts on the free list */
+    for (int i = 0; i < s_slots; i++) {
+        s_sessions[i].lru_prev = -1;
+        s_sessions[i].lru_next = (i + 1 < s_slots) ? i + 1 : -1;
+    }
+    s_free = 0;
 
-    ESP_LOGI(TAG, "Session ring buffer ready (%d users x %d msgs each, mem=%s)",
-             ATOM_SESSION_MAX_USERS, ATOM_SESSION_MAX_MSGS,
+    log_replay();
+    log_start();
+
+    ESP_LOGI(TAG, "Session arena ready (%d users x %d bytes each, mem=%s)",
+             s_slots, ATOM_SESSION_USER_BYTES,
              s_using_psram ? "PSRAM" : "INTERNAL");
     return ESP_OK;
 }
@@ -94,78 +556,74 @@ esp_err_t atom_session_append(const char *user_id,
     xSemaphoreTake(s_mutex, portMAX_DELAY);
 
     atom_user_session_t *sess = find_or_alloc(user_id);
-    if (!sess) {
-        xSemaphoreGive(s_mutex);
-        ESP_LOGW(TAG, "No session slot for user %s", user_id);
-        return ESP_ERR_NO_MEM;
-    }
-
-    atom_msg_t *m = &sess->msgs[sess->head];
-    strncpy(m->role, role, sizeof(m->role) - 1);
-    m->role[sizeof(m->role)-1] = '\0';
-    strncpy(m->content, content, sizeof(m->content) - 1);
-    m->content[sizeof(m->content)-1] = '\0';
 
-    sess->head = (sess->head + 1) % ATOM_SESSION_MAX_MSGS;
-    if (sess->count < ATOM_SESSION_MAX_MSGS) sess->count++;
+    char   code = strcmp(role, "assistant") == 0 ? ROLE_ASSISTANT : ROLE_USER;
+    size_t len  = utf8_clip(content, msg_cap());
+    arena_push(sess, code, content, len);
+    log_queue(code, sess, content, len);
 
     xSemaphoreGive(s_mutex);
     return ESP_OK;
 }
 
-esp_err_t atom_session_get_history_json(const char *user_id,
-                                        char *buf, size_t buf_size,
-                                        int max_msgs)
+cJSON *atom_session_get_history(const char *user_id, int max_msgs)
 {
-    buf[0] = '\0';
-    if (!user_id) return ESP_ERR_INVALID_ARG;
+    cJSON *arr = cJSON_CreateArray();
+    if (!arr || !user_id) return arr;
 
     xSemaphoreTake(s_mutex, portMAX_DELAY);
 
-    atom_user_session_t *sess = NULL;
-    for (int i = 0; i < ATOM_SESSION_MAX_USERS; i++) {
-        if (s_sessions[i].in_use &&
-            strncmp(s_sessions[i].user_id, user_id, sizeof(s_sessions[i].user_id)-1) == 0) {
-            sess = &s_sessions[i];
-            break;
-        }
-    }
-
+    atom_user_session_t *sess = find(user_id);
     if (!sess || sess->count == 0) {
         xSemaphoreGive(s_mutex);
-        strncpy(buf, "[]", buf_size);
-        return ESP_OK;
+        return arr;
     }
 
-    cJSON *arr = cJSON_CreateArray();
+    /* Skip to the most recent max_msgs records (0 means no limit) */
+    int skip = 0;
+    if (max_msgs > 0 && max_msgs < sess->count) skip = sess->count - max_msgs;
 
-    /* Clamp count to max_msgs (0 means no limit) */
-    int count = sess->count;
-    if (max_msgs > 0 && max_msgs < count) count = max_msgs;
+    const uint8_t *rec = sess->arena;
+    const uint8_t *end = sess->arena + sess->used;
+    for (int i = 0; rec < end; i++, rec += REC_SIZE(rec_len(rec))) {
+        if (i < skip) continue;
+        /* Eviction can leave an orphaned reply at the front; the
+         * conversation must open with a user turn. */
+        if (cJSON_GetArraySize(arr) == 0 && rec[0] != ROLE_USER) continue;
 
-    /* Traverse ring buffer in chronological order (most recent `count` msgs) */
-    int start = (sess->head - count + ATOM_SESSION_MAX_MSGS) % ATOM_SESSION_MAX_MSGS;
-    for (int i = 0; i < count; i++) {
-        int idx = (start + i) % ATOM_SESSION_MAX_MSGS;
         cJSON *msg = cJSON_CreateObject();
-        cJSON_AddStringToObject(msg, "role",    sess->msgs[idx].role);
-        cJSON_AddStringToObject(msg, "content", sess->msgs[idx].content);
+        cJSON_AddStringToObject(msg, "role",
+                                rec[0] == ROLE_ASSISTANT ? "assistant" : "user");
+        cJSON_AddStringToObject(msg, "content", (const char *)rec + REC_HDR);
         cJSON_AddItemToArray(arr, msg);
     }
 
     xSemaphoreGive(s_mutex);
+    return arr;
+}
 
-    char *json = cJSON_PrintUnformatted(arr);
-    cJSON_Delete(arr);
+esp_err_t atom_session_get_history_json(const char *user_id,
+                                        char *buf, size_t buf_size,
+                                        int max_msgs)
+{
+    buf[0] = '\0';
+    if (!user_id) return ESP_ERR_INVALID_ARG;
 
-    if (json) {
-        strncpy(buf, json, buf_size - 1);
-        buf[buf_size - 1] = '\0';
-        free(json);
-    } else {
+    cJSON *arr = atom_session_get_history(user_id, max_msgs);
+    if (!arr) {
         strncpy(buf, "[]", buf_size);
+        return ESP_ERR_NO_MEM;
     }
 
+    /* Print straight into buf; a history that does not fit is reported
+     * instead of being cut into invalid JSON */
+    bool ok = cJSON_PrintPreallocated(arr, buf, (int)buf_size, false);
+    cJSON_Delete(arr);
+    if (!ok) {
+        ESP_LOGW(TAG, "History for %s exceeds %d bytes", user_id, (int)buf_size);
+        strncpy(buf, "[]", buf_size);
+        return ESP_ERR_INVALID_SIZE;
+    }
     return ESP_OK;
 }
 
@@ -174,13 +632,114 @@ esp_err_t atom_session_clear(const char *user_id)
     if (!user_id) return ESP_ERR_INVALID_ARG;
 
     xSemaphoreTake(s_mutex, portMAX_DELAY);
-    for (int i = 0; i < ATOM_SESSION_MAX_USERS; i++) {
-        if (s_sessions[i].in_use &&
-            strncmp(s_sessions[i].user_id, user_id, sizeof(s_sessions[i].user_id)-1) == 0) {
-            memset(&s_sessions[i], 0, sizeof(s_sessions[i]));
-            break;
-        }
+    int32_t slot = s_index[index_probe(user_id)];
+    if (slot >= 0) {
+        log_queue(LOG_OP_CLEAR, &s_sessions[slot], "", 0);
+        release_slot(slot);
+    }
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+void atom_session_get_stats(atom_session_stats_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (!s_mutex) return;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    out->slots       = s_slots;
+    out->bytes_total = (size_t)s_slots * ATOM_SESSION_USER_BYTES;
+    for (int i = s_lru_head; i >= 0; i = s_sessions[i].lru_next) {
+        out->users++;
+        out->msgs       += s_sessions[i].count;
+        out->bytes_used += s_sessions[i].used;
     }
     xSemaphoreGive(s_mutex);
+}
+
+/* ── Benchmark ───────────────────────────────────────────────────────── */
+
+/* Old layout for comparison: fixed role[12] + content[512] per message. */
+#define FIXED_MSG_LEN   512
+#define FIXED_MSG_SIZE  (12 + FIXED_MSG_LEN)
+#define FIXED_SLOTS     (ATOM_SESSION_USER_BYTES / FIXED_MSG_SIZE)
+
+static uint32_t bench_rand(uint32_t *st)
+{
+    *st = *st * 1664525u + 1013904223u;
+    return *st >> 8;
+}
+
+/* Rough shape of chat traffic: short user prompts, medium replies and
+ * the occasional long answer with code. */
+static size_t bench_len(uint32_t *st, bool assistant)
+{
+    uint32_t r = bench_rand(st) % 100;
+    if (!assistant) {
+        if (r < 60) return 8   + bench_rand(st) % 72;
+        if (r < 90) return 80  + bench_rand(st) % 220;
+        return             300 + bench_rand(st) % 900;
+    }
+    if (r < 30) return 40  + bench_rand(st) % 160;
+    if (r < 80) return 200 + bench_rand(st) % 500;
+    return             700 + bench_rand(st) % 1300;
+}
+
+esp_err_t atom_session_bench(int n_msgs, uint32_t seed, atom_session_bench_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    if (n_msgs <= 0) return ESP_ERR_INVALID_ARG;
+
+    /* Scratch session outside the table; the live sessions are untouched */
+    atom_user_session_t *sess = heap_caps_calloc(1, sizeof(*sess), MALLOC_CAP_SPIRAM);
+    if (!sess) sess = calloc(1, sizeof(*sess));
+    char *text = malloc(ATOM_SESSION_MSG_MAX_LEN + 1);
+    if (!sess || !text) {
+        free(sess);
+        free(text);
+        return ESP_ERR_NO_MEM;
+    }
+    memset(text, 'x', ATOM_SESSION_MSG_MAX_LEN);
+
+    size_t fixed_len[FIXED_SLOTS] = {0};
+    int    fixed_count = 0;
+    uint64_t arena_msgs = 0, arena_bytes = 0, fixed_msgs = 0, fixed_bytes = 0;
+    uint32_t st = seed ? seed : 1;
+
+    for (int i = 0; i < n_msgs; i++) {
+        bool assistant = (i & 1);
+        size_t len = bench_len(&st, assistant);
+        out->bytes_in += len;
+
+        /* Arena: capped at ATOM_SESSION_MSG_MAX_LEN, same as append */
+        size_t keep = len < ATOM_SESSION_MSG_MAX_LEN ? len : ATOM_SESSION_MSG_MAX_LEN;
+        text[keep] = '\0';
+        arena_push(sess, assistant ? ROLE_ASSISTANT : ROLE_USER, text, keep);
+        text[keep] = 'x';
+
+        /* Fixed slots: ring of FIXED_SLOTS, text cut to FIXED_MSG_LEN - 1 */
+        if (len > FIXED_MSG_LEN - 1) out->fixed_truncated++;
+        fixed_len[i % FIXED_SLOTS] = len < FIXED_MSG_LEN - 1 ? len : FIXED_MSG_LEN - 1;
+        if (fixed_count < FIXED_SLOTS) fixed_count++;
+
+        if (len > keep) out->arena_truncated++;
+
+        /* Sample what each layout would hand to the LLM right now */
+        arena_msgs  += sess->count;
+        arena_bytes += sess->used - (size_t)sess->count * REC_SIZE(0);
+        fixed_msgs  += fixed_count;
+        for (int k = 0; k < fixed_count; k++) fixed_bytes += fixed_len[k];
+    }
+
+    out->msgs            = n_msgs;
+    out->user_bytes      = ATOM_SESSION_USER_BYTES;
+    out->fixed_slots     = FIXED_SLOTS;
+    out->arena_avg_msgs  = (int)(arena_msgs  * 100 / n_msgs);
+    out->arena_avg_bytes = (int)(arena_bytes / n_msgs);
+    out->fixed_avg_msgs  = (int)(fixed_msgs  * 100 / n_msgs);
+    out->fixed_avg_bytes = (int)(fixed_bytes / n_msgs);
+
+    free(text);
+    free(sess);
     return ESP_OK;
 }
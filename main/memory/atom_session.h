@@ -2,51 +2,69 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
+#include "cJSON.h"
 
 /**
  * atom_session.h
  *
- * AtomClaw: In-RAM ring buffer session manager.
+ * AtomClaw: In-RAM session history manager.
  *
- * Stores the last ATOM_SESSION_MAX_EXCHANGES (default 3) conversation
- * exchanges (user + assistant pairs) per Discord user in RAM.
+ * Keeps recent messages per Discord/LINE user in a fixed byte arena
+ * (ATOM_SESSION_USER_BYTES). Messages are stored at their real length,
+ * so short exchanges keep many turns and long ones keep fewer; the
+ * oldest messages are dropped when the arena is full.
  * Prefers PSRAM and falls back to internal RAM when PSRAM is unavailable.
  *
- * - No SPIFFS writes (Flash preservation)
+ * - Write-behind log on SPIFFS (ATOM_SESSION_LOG_FILE): appends are batched
+ *   by a background task, replayed at boot and compacted from RAM
  * - Thread-safe via FreeRTOS mutex
- * - Keyed by Discord user_id (string)
- * - Supports up to ATOM_SESSION_MAX_USERS simultaneous users
+ * - Keyed by Discord/LINE user_id (string) via an open-addressing hash index
+ * - Slot count sized at boot from free PSRAM (ATOM_SESSION_PSRAM_PCT),
+ *   between ATOM_SESSION_MIN_USERS and ATOM_SESSION_MAX_USERS
+ * - When full, the least recently active user's session is evicted
  */
 
-#define ATOM_SESSION_MAX_USERS  8
-
 /**
  * Initialize the session module (allocates RAM buffers, creates mutex).
  */
 esp_err_t atom_session_init(void);
 
 /**
- * Append a message to the ring buffer for the given user.
+ * Append a message to the given user's history, dropping the oldest
+ * messages if it does not fit. Creates the session if needed, evicting
+ * the least recently active one.
  *
  * @param user_id  Discord user ID.
  * @param role     "user" or "assistant".
- * @param content  Message text (will be truncated to ATOM_SESSION_MSG_MAX_LEN).
+ * @param content  Message text (truncated to ATOM_SESSION_MSG_MAX_LEN bytes
+ *                 on a UTF-8 character boundary).
  */
 esp_err_t atom_session_append(const char *user_id,
                               const char *role,
                               const char *content);
 
 /**
- * Serialize recent messages for the given user as a JSON array.
- *
- * Returns a JSON messages array:
+ * Build the recent messages for the given user as a cJSON array, ready to
+ * hand to llm_chat_tools():
  *   [{"role":"user","content":"..."},{"role":"assistant","content":"..."},...]
+ * The array always starts with a user message.
  *
  * @param user_id   Discord user ID.
- * @param buf       Output buffer.
- * @param buf_size  Size of buf.
  * @param max_msgs  Maximum number of messages to return (0 = return all stored).
  *                  Use 4 (= 2 exchanges) for CF-less local-only mode.
+ * @return New array owned by the caller (cJSON_Delete), NULL only on OOM.
+ */
+cJSON *atom_session_get_history(const char *user_id, int max_msgs);
+
+/**
+ * Same as atom_session_get_history(), printed into buf as JSON text.
+ *
+ * @param user_id   Discord user ID.
+ * @param buf       Output buffer.
+ * @param buf_size  Size of buf.
+ * @param max_msgs  As for atom_session_get_history().
+ * @return ESP_ERR_INVALID_SIZE (buf set to "[]") if the JSON does not fit.
  */
 esp_err_t atom_session_get_history_json(const char *user_id,
                                         char *buf, size_t buf_size,
@@ -56,3 +74,38 @@ esp_err_t atom_session_get_history_json(const char *user_id,
  * Clear the session history for the given user.
  */
 esp_err_t atom_session_clear(const char *user_id);
+
+typedef struct {
+    int    slots;        /* session slots allocated at boot */
+    int    users;        /* slots currently in use */
+    size_t msgs;         /* messages held across all users */
+    size_t bytes_used;   /* arena bytes holding messages */
+    size_t bytes_total;  /* arena bytes allocated */
+} atom_session_stats_t;
+
+/**
+ * Snapshot of session memory usage.
+ */
+void atom_session_get_stats(atom_session_stats_t *out);
+
+typedef struct {
+    int    msgs;             /* messages streamed through */
+    int    user_bytes;       /* per-user budget both layouts were given */
+    int    fixed_slots;      /* 512-byte slots that budget buys */
+    size_t bytes_in;         /* total text generated */
+    int    arena_avg_msgs;   /* avg messages retained, x100 */
+    int    arena_avg_bytes;  /* avg text bytes retained */
+    int    arena_truncated;  /* messages cut to ATOM_SESSION_MSG_MAX_LEN */
+    int    fixed_avg_msgs;   /* same for fixed 512-byte slots, x100 */
+    int    fixed_avg_bytes;
+    int    fixed_truncated;
+} atom_session_bench_t;
+
+/**
+ * Stream n_msgs synthetic user/assistant messages (seeded size mix of short
+ * prompts, medium replies and long answers) through a scratch arena and
+ * through the former fixed 512-byte slot layout of the same size, and
+ * report how much history each retains on average.
+ * Live sessions are not touched.
+ */
+esp_err_t atom_session_bench(int n_msgs, uint32_t seed, atom_session_bench_t *out);
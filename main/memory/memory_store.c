@@ -9,6 +9,18 @@
 
 static const char *TAG = "memory";
 
+static uint32_t s_generation = 0;   /* bumped on every memory/config write */
+
+uint32_t memory_generation(void)
+{
+    return __atomic_load_n(&s_generation, __ATOMIC_ACQUIRE);
+}
+
+void memory_bump_generation(void)
+{
+    __atomic_add_fetch(&s_generation, 1, __ATOMIC_RELEASE);
+}
+
 static void get_date_str(char *buf, size_t size, int days_ago)
 {
     time_t now;
@@ -50,6 +62,7 @@ esp_err_t memory_write_long_term(const char *content)
     }
     fputs(content, f);
     fclose(f);
+    memory_bump_generation();
     ESP_LOGI(TAG, "Long-term memory updated (%d bytes)", (int)strlen(content));
     return ESP_OK;
 }
@@ -75,6 +88,7 @@ esp_err_t memory_append_today(const char *note)
 
     fprintf(f, "%s\n", note);
     fclose(f);
+    memory_bump_generation();
     return ESP_OK;
 }
 
@@ -2,6 +2,7 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdint.h>
 
 /**
  * Initialize memory store. Ensures SPIFFS directories exist.
@@ -29,3 +30,15 @@ esp_err_t memory_append_today(const char *note);
  * @param days  Number of days to look back (default 3)
  */
 esp_err_t memory_read_recent(char *buf, size_t size, int days);
+
+/**
+ * Generation counter for files that feed the system prompt. Bumped by the
+ * memory writers above and by the write_file / edit_file tools; prompt
+ * caches compare it to decide whether to re-read flash.
+ */
+uint32_t memory_generation(void);
+
+/**
+ * Mark prompt sources as changed.
+ */
+void memory_bump_generation(void);
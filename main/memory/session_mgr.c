@@ -6,14 +6,165 @@
 #include <stdlib.h>
 #include <dirent.h>
 #include <time.h>
+#include <sys/stat.h>
 #include "esp_log.h"
 #include "cJSON.h"
 
 static const char *TAG = "session";
 
-static void session_path(const char *chat_id, char *buf, size_t size)
+#define SESSION_LINE_MAX  2048
+
+/* Each session is tg_<chat>.jsonl plus a sidecar tg_<chat>.idx holding the
+ * uint32 byte offset of every line, so the last N messages are found with
+ * one seek instead of parsing the whole file. The index may lag the JSONL
+ * after a crash; readers pick up the unindexed tail and append it, and
+ * session_append() rebuilds it. Compaction writes tg_<chat>.tmp, which is
+ * recovered if a crash leaves it without the JSONL. */
+
+static void session_path(const char *chat_id, const char *ext, char *buf, size_t size)
+{
+    snprintf(buf, size, "%s/tg_%s.%s", MIMI_SPIFFS_SESSION_DIR, chat_id, ext);
+}
+
+static long file_size(const char *path)
+{
+    struct stat st;
+    return stat(path, &st) == 0 ? (long)st.st_size : -1;
+}
+
+/* Read one line into buf. Over-long lines are consumed and returned empty.
+ * Returns false at EOF. */
+static bool read_line(FILE *f, char *buf, size_t size)
+{
+    if (!fgets(buf, size, f)) return false;
+    size_t len = strlen(buf);
+    if (len > 0 && buf[len - 1] == '\n') {
+        buf[len - 1] = '\0';
+        return true;
+    }
+    if (feof(f)) return true;
+    int c;
+    while ((c = fgetc(f)) != EOF && c != '\n') {}
+    buf[0] = '\0';
+    return true;
+}
+
+static void index_append(const char *idx_path, const uint32_t *offs, size_t n)
+{
+    FILE *f = fopen(idx_path, "ab");
+    if (!f) return;
+    fwrite(offs, sizeof(uint32_t), n, f);
+    fclose(f);
+}
+
+/* Rebuild the index from a full scan of the JSONL. Returns line count. */
+static long index_rebuild(const char *jsonl_path, const char *idx_path)
+{
+    remove(idx_path);
+    FILE *in = fopen(jsonl_path, "r");
+    if (!in) return 0;
+    FILE *out = fopen(idx_path, "wb");
+    char *line = malloc(SESSION_LINE_MAX);
+    long count = 0;
+    if (out && line) {
+        uint32_t off = 0;
+        while (read_line(in, line, SESSION_LINE_MAX)) {
+            fwrite(&off, sizeof(off), 1, out);
+            count++;
+            off = (uint32_t)ftell(in);
+        }
+    }
+    free(line);
+    if (out) fclose(out);
+    fclose(in);
+    ESP_LOGI(TAG, "Rebuilt index %s (%ld lines)", idx_path, count);
+    return count;
+}
+
+/* Byte offset of line `nth` from the index, or -1. */
+static long index_offset(const char *idx_path, long nth)
+{
+    FILE *f = fopen(idx_path, "rb");
+    if (!f) return -1;
+    uint32_t off;
+    bool ok = fseek(f, nth * (long)sizeof(off), SEEK_SET) == 0 &&
+              fread(&off, sizeof(off), 1, f) == 1;
+    fclose(f);
+    return ok ? (long)off : -1;
+}
+
+/* True if the index ends with the line that ends at byte end, i.e. it
+ * covers the whole file up to there. */
+static bool index_covers(const char *jsonl_path, const char *idx_path,
+                         long idx_size, uint32_t end)
+{
+    if (idx_size <= 0) return end == 0;
+    if (idx_size % (long)sizeof(uint32_t) != 0) return false;
+
+    long last = index_offset(idx_path, idx_size / (long)sizeof(uint32_t) - 1);
+    if (last < 0 || last >= (long)end) return false;
+    FILE *f = fopen(jsonl_path, "r");
+    char *line = malloc(SESSION_LINE_MAX);
+    bool ok = f && line && fseek(f, last, SEEK_SET) == 0 &&
+              read_line(f, line, SESSION_LINE_MAX) && ftell(f) == (long)end;
+    free(line);
+    if (f) fclose(f);
+    return ok;
+}
+
+/* A compaction that stopped between removing the JSONL and renaming its
+ * copy leaves only the .tmp file, which is the complete kept tail. */
+static void session_recover(const char *chat_id, const char *path, const char *idx_path)
+{
+    if (file_size(path) >= 0) return;
+    char tmp_path[64];
+    session_path(chat_id, "tmp", tmp_path, sizeof(tmp_path));
+    if (file_size(tmp_path) < 0) return;
+    remove(idx_path);
+    if (rename(tmp_path, path) == 0) {
+        ESP_LOGW(TAG, "Session %s recovered from interrupted compaction", chat_id);
+    }
+}
+
+/* Drop all but the last MIMI_SESSION_KEEP_MSGS lines of a session. */
+static void session_compact(const char *chat_id, long count)
 {
-    snprintf(buf, size, "%s/tg_%s.jsonl", MIMI_SPIFFS_SESSION_DIR, chat_id);
+    char path[64], idx_path[64], tmp_path[64];
+    session_path(chat_id, "jsonl", path, sizeof(path));
+    session_path(chat_id, "idx", idx_path, sizeof(idx_path));
+    session_path(chat_id, "tmp", tmp_path, sizeof(tmp_path));
+
+    long base = index_offset(idx_path, count - MIMI_SESSION_KEEP_MSGS);
+    if (base <= 0) return;
+
+    FILE *in  = fopen(path, "rb");
+    FILE *out = fopen(tmp_path, "wb");
+    char *chunk = malloc(1024);
+    bool ok = in && out && chunk && fseek(in, base, SEEK_SET) == 0;
+    size_t n;
+    while (ok && (n = fread(chunk, 1, 1024, in)) > 0) {
+        ok = fwrite(chunk, 1, n, out) == n;
+    }
+    free(chunk);
+    if (in) fclose(in);
+    if (out) fclose(out);
+    if (!ok) {
+        remove(tmp_path);
+        return;
+    }
+
+    /* A crash after remove(path) leaves only tmp_path, which
+     * session_recover() renames into place; without an index the next
+     * access rebuilds one */
+    remove(idx_path);
+    remove(path);
+    if (rename(tmp_path, path) != 0) {
+        ESP_LOGE(TAG, "Session %s compaction rename failed", chat_id);
+        return;
+    }
+    index_rebuild(path, idx_path);
+    ESP_LOGI(TAG, "Session %s compacted (%ld -> %d msgs)",
+             chat_id, count, MIMI_SESSION_KEEP_MSGS);
 }
 
 esp_err_t session_mgr_init(void)
@@ -24,14 +175,18 @@ esp_err_t session_mgr_init(void)
 
 esp_err_t session_append(const char *chat_id, const char *role, const char *content)
 {
-    char path[64];
-    session_path(chat_id, path, sizeof(path));
+    char path[64], idx_path[64];
+    session_path(chat_id, "jsonl", path, sizeof(path));
+    session_path(chat_id, "idx", idx_path, sizeof(idx_path));
+    session_recover(chat_id, path, idx_path);
 
     FILE *f = fopen(path, "a");
     if (!f) {
         ESP_LOGE(TAG, "Cannot open session file %s", path);
         return ESP_FAIL;
     }
+    fseek(f, 0, SEEK_END);
+    uint32_t off = (uint32_t)ftell(f);
 
     cJSON *obj = cJSON_CreateObject();
     cJSON_AddStringToObject(obj, "role", role);
@@ -43,35 +198,83 @@ esp_err_t session_append(const char *chat_id, const char *role, const char *cont
 
     if (line) {
         fprintf(f, "%s\n", line);
-        free(line);
+        cJSON_free(line);
     }
 
     fclose(f);
+    if (!line) return ESP_OK;
+
+    /* Index it. An index that does not end at the previous last line
+     * (missing, or lagging after a crash) is rebuilt instead, so the new
+     * offset cannot land at the wrong line number. */
+    long idx_size = file_size(idx_path);
+    if (!index_covers(path, idx_path, idx_size, off)) {
+        idx_size = index_rebuild(path, idx_path) * (long)sizeof(uint32_t);
+    } else {
+        index_append(idx_path, &off, 1);
+        idx_size = (idx_size < 0 ? 0 : idx_size) + (long)sizeof(off);
+    }
+
+    long count = idx_size / (long)sizeof(uint32_t);
+    if (count > MIMI_SESSION_COMPACT_MSGS) session_compact(chat_id, count);
     return ESP_OK;
 }
 
 esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs)
 {
-    char path[64];
-    session_path(chat_id, path, sizeof(path));
+    char path[64], idx_path[64];
+    session_path(chat_id, "jsonl", path, sizeof(path));
+    session_path(chat_id, "idx", idx_path, sizeof(idx_path));
+    session_recover(chat_id, path, idx_path);
 
-    FILE *f = fopen(path, "r");
-    if (!f) {
+    long jsonl_size = file_size(path);
+    if (jsonl_size < 0 || max_msgs <= 0) {
         /* No history yet */
         snprintf(buf, size, "[]");
         return ESP_OK;
     }
 
-    /* Read all lines into a ring buffer of cJSON objects */
-    cJSON *messages[MIMI_SESSION_MAX_MSGS];
+    /* Seek to the first of the last max_msgs indexed lines */
+    long idx_size = file_size(idx_path);
+    if (idx_size < 0 && jsonl_size > 0) {
+        idx_size = index_rebuild(path, idx_path) * (long)sizeof(uint32_t);
+    }
+    long indexed = idx_size > 0 ? idx_size / (long)sizeof(uint32_t) : 0;
+    long first   = indexed > max_msgs ? indexed - max_msgs : 0;
+    long start   = indexed > 0 ? index_offset(idx_path, first) : 0;
+    if (start < 0 || start >= jsonl_size) {
+        /* Index ahead of the file (interrupted compaction) */
+        indexed = index_rebuild(path, idx_path);
+        first   = indexed > max_msgs ? indexed - max_msgs : 0;
+        start   = indexed > 0 ? index_offset(idx_path, first) : 0;
+        if (start < 0) start = 0;
+    }
+
+    FILE *f = fopen(path, "r");
+    cJSON **messages = calloc(max_msgs, sizeof(cJSON *));
+    char *line = malloc(SESSION_LINE_MAX);
+    if (!f || !messages || !line || fseek(f, start, SEEK_SET) != 0) {
+        if (f) fclose(f);
+        free(messages);
+        free(line);
+        snprintf(buf, size, "[]");
+        return ESP_OK;
+    }
+
+    /* Ring buffer of the last max_msgs lines from there to EOF. Lines past
+     * the indexed ones are remembered so the index can catch up. */
     int count = 0;
     int write_idx = 0;
+    long line_no = first;
+    uint32_t missing[8];
+    int n_missing = 0;
 
-    char line[2048];
-    while (fgets(line, sizeof(line), f)) {
-        /* Strip newline */
-        size_t len = strlen(line);
-        if (len > 0 && line[len - 1] == '\n') line[len - 1] = '\0';
+    uint32_t off = (uint32_t)start;
+    while (read_line(f, line, SESSION_LINE_MAX)) {
+        if (line_no++ >= indexed && n_missing < (int)(sizeof(missing) / sizeof(missing[0]))) {
+            missing[n_missing++] = off;
+        }
+        off = (uint32_t)ftell(f);
         if (line[0] == '\0') continue;
 
         cJSON *obj = cJSON_Parse(line);
@@ -86,12 +289,19 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
         if (count < max_msgs) count++;
     }
     fclose(f);
+    free(line);
+
+    if (n_missing > 0 && line_no - indexed == n_missing) {
+        index_append(idx_path, missing, n_missing);
+    } else if (n_missing > 0) {
+        index_rebuild(path, idx_path);
+    }
 
     /* Build JSON array with only role + content */
     cJSON *arr = cJSON_CreateArray();
-    int start = (count < max_msgs) ? 0 : write_idx;
+    int start_idx = (count < max_msgs) ? 0 : write_idx;
     for (int i = 0; i < count; i++) {
-        int idx = (start + i) % max_msgs;
+        int idx = (start_idx + i) % max_msgs;
         cJSON *src = messages[idx];
 
         cJSON *entry = cJSON_CreateObject();
@@ -102,14 +312,9 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
             cJSON_AddStringToObject(entry, "content", content->valuestring);
         }
         cJSON_AddItemToArray(arr, entry);
+        cJSON_Delete(src);
     }
-
-    /* Cleanup ring buffer */
-    int cleanup_start = (count < max_msgs) ? 0 : write_idx;
-    for (int i = 0; i < count; i++) {
-        int idx = (cleanup_start + i) % max_msgs;
-        cJSON_Delete(messages[idx]);
-    }
+    free(messages);
 
     char *json_str = cJSON_PrintUnformatted(arr);
     cJSON_Delete(arr);
@@ -117,7 +322,7 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
     if (json_str) {
         strncpy(buf, json_str, size - 1);
         buf[size - 1] = '\0';
-        free(json_str);
+        cJSON_free(json_str);
     } else {
         snprintf(buf, size, "[]");
     }
@@ -127,9 +332,11 @@ esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size,
 
 esp_err_t session_clear(const char *chat_id)
 {
-    char path[64];
-    session_path(chat_id, path, sizeof(path));
+    char path[64], idx_path[64];
+    session_path(chat_id, "jsonl", path, sizeof(path));
+    session_path(chat_id, "idx", idx_path, sizeof(idx_path));
 
+    remove(idx_path);
     if (remove(path) == 0) {
         ESP_LOGI(TAG, "Session %s cleared", chat_id);
         return ESP_OK;
@@ -9,7 +9,9 @@
 esp_err_t session_mgr_init(void);
 
 /**
- * Append a message to a session file (JSONL format).
+ * Append a message to a session file (JSONL format) and its offset index.
+ * Files past MIMI_SESSION_COMPACT_MSGS are cut back to the last
+ * MIMI_SESSION_KEEP_MSGS messages.
  * @param chat_id   Session identifier (e.g., "12345")
  * @param role      "user" or "assistant"
  * @param content   Message text
@@ -18,7 +20,8 @@ esp_err_t session_append(const char *chat_id, const char *role, const char *cont
 
 /**
  * Load session history as a JSON array string suitable for LLM messages.
- * Returns the last max_msgs messages as:
+ * Returns the last max_msgs messages, located through the offset index
+ * (rebuilt from the JSONL if missing or stale), as:
  * [{"role":"user","content":"..."},{"role":"assistant","content":"..."},...]
  *
  * @param chat_id   Session identifier
@@ -29,7 +32,7 @@ esp_err_t session_append(const char *chat_id, const char *role, const char *cont
 esp_err_t session_get_history_json(const char *chat_id, char *buf, size_t size, int max_msgs);
 
 /**
- * Clear a session (delete the file).
+ * Clear a session (delete the file and its index).
  */
 esp_err_t session_clear(const char *chat_id);
 
@@ -21,6 +21,7 @@
 #include "cli/serial_cli.h"
 #include "proxy/http_proxy.h"
 #include "tools/tool_registry.h"
+#include "tools/tool_pool.h"
 #include "display/display.h"
 #include "buttons/button_driver.h"
 #include "ui/config_screen.h"
@@ -81,7 +82,7 @@ static void outbound_dispatch_task(void *arg)
             ESP_LOGW(TAG, "Unknown channel: %s", msg.channel);
         }
 
-        free(msg.content);
+        msg_text_unref(msg.content);
     }
 }
 
@@ -124,6 +125,7 @@ void app_main(void)
     ESP_ERROR_CHECK(telegram_bot_init());
     ESP_ERROR_CHECK(llm_proxy_init());
     ESP_ERROR_CHECK(tool_registry_init());
+    ESP_ERROR_CHECK(tool_pool_init());
     ESP_ERROR_CHECK(agent_loop_init());
 
     /* Start Serial CLI first (works without WiFi) */
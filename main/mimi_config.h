@@ -54,6 +54,12 @@
 #define MIMI_AGENT_MAX_HISTORY       20
 #define MIMI_AGENT_MAX_TOOL_ITER     10
 #define MIMI_MAX_TOOL_CALLS          4
+#define MIMI_TOOL_OUTPUT_SIZE        (8 * 1024)
+
+/* Tool worker pool (0 = run tool calls sequentially) */
+#define MIMI_TOOL_WORKERS            2
+#define MIMI_TOOL_WORKER_STACK       (8 * 1024)
+#define MIMI_TOOL_WORKER_PRIO        5
 
 /* Timezone (POSIX TZ format) */
 #define MIMI_TIMEZONE                "PST8PDT,M3.2.0,M11.1.0"
@@ -66,9 +72,12 @@
 #define MIMI_OPENAI_API_URL          "https://api.openai.com/v1/chat/completions"
 #define MIMI_LLM_API_VERSION         "2023-06-01"
 #define MIMI_LLM_STREAM_BUF_SIZE     (32 * 1024)
+#define MIMI_LLM_KEEPALIVE_IDLE_MS   (30 * 1000)
 
 /* Message Bus */
-#define MIMI_BUS_QUEUE_LEN           8
+#define MIMI_BUS_QUEUE_LEN           32   /* message slots per direction (PSRAM pool) */
+#define MIMI_BUS_COALESCE_MS         1500 /* merge follow-ups within this window, 0 = off */
+#define MIMI_BUS_COALESCE_MAX_MS     4000 /* longest hold from the first message */
 #define MIMI_OUTBOUND_STACK          (8 * 1024)
 #define MIMI_OUTBOUND_PRIO           5
 #define MIMI_OUTBOUND_CORE           0
@@ -83,6 +92,10 @@
 #define MIMI_USER_FILE               "/spiffs/config/USER.md"
 #define MIMI_CONTEXT_BUF_SIZE        (16 * 1024)
 #define MIMI_SESSION_MAX_MSGS        20
+/* Session files are cut back to the last KEEP messages once they hold
+ * more than COMPACT, so append and load cost stay flat */
+#define MIMI_SESSION_COMPACT_MSGS    200
+#define MIMI_SESSION_KEEP_MSGS       (MIMI_SESSION_MAX_MSGS * 2)
 
 /* WebSocket Gateway */
 #define MIMI_WS_PORT                 18789
@@ -240,6 +240,18 @@ int proxy_conn_read(proxy_conn_t *conn, char *buf, int len, int timeout_ms)
     return (int)ret;
 }
 
+bool proxy_conn_is_alive(proxy_conn_t *conn)
+{
+    if (!conn || !conn->tls) return false;
+    if (esp_tls_get_bytes_avail(conn->tls) > 0) return false;
+
+    char c;
+    int r = recv(conn->sock, &c, 1, MSG_PEEK | MSG_DONTWAIT);
+    if (r == 0) return false;                               /* FIN from peer */
+    if (r > 0) return false;                                /* stray bytes / alert */
+    return errno == EAGAIN || errno == EWOULDBLOCK;
+}
+
 void proxy_conn_close(proxy_conn_t *conn)
 {
     if (!conn) return;
@@ -44,5 +44,12 @@ int proxy_conn_write(proxy_conn_t *conn, const char *data, int len);
 /** Read raw bytes from the TLS tunnel. Returns bytes read or -1. */
 int proxy_conn_read(proxy_conn_t *conn, char *buf, int len, int timeout_ms);
 
+/**
+ * Non-blocking liveness probe for an idle connection. Returns false if the
+ * peer has closed the tunnel or sent unsolicited data (e.g. a TLS alert),
+ * in which case the connection must not be reused.
+ */
+bool proxy_conn_is_alive(proxy_conn_t *conn);
+
 /** Close and free the connection. */
 void proxy_conn_close(proxy_conn_t *conn);
@@ -217,9 +217,9 @@ static void process_updates(const char *json_str)
         mimi_msg_t msg = {0};
         strncpy(msg.channel, MIMI_CHAN_TELEGRAM, sizeof(msg.channel) - 1);
         strncpy(msg.chat_id, chat_id_str, sizeof(msg.chat_id) - 1);
-        msg.content = strdup(text->valuestring);
-        if (msg.content) {
-            message_bus_push_inbound(&msg);
+        msg.content = msg_text_dup(text->valuestring);
+        if (msg.content && message_bus_push_inbound(&msg) != ESP_OK) {
+            msg_text_unref(msg.content);
         }
     }
 
@@ -327,7 +327,7 @@ esp_err_t telegram_send_message(const char *chat_id, const char *text)
 
         if (json_str) {
             char *resp = tg_api_call("sendMessage", json_str);
-            free(json_str);
+            cJSON_free(json_str);
             if (resp) {
                 /* Check for Markdown parse error, retry as plain text */
                 cJSON *root = cJSON_Parse(resp);
@@ -352,7 +352,7 @@ esp_err_t telegram_send_message(const char *chat_id, const char *text)
                         cJSON_Delete(body2);
                         if (json2) {
                             char *resp2 = tg_api_call("sendMessage", json2);
-                            free(json2);
+                            cJSON_free(json2);
                             free(resp2);
                         }
                     } else {
@@ -1,5 +1,6 @@
 #include "tools/tool_files.h"
 #include "device_config.h"
+#include "memory/memory_store.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -95,6 +96,7 @@ esp_err_t tool_write_file_execute(const char *input_json, char *output, size_t o
     size_t len = strlen(content);
     size_t written = fwrite(content, 1, len, f);
     fclose(f);
+    memory_bump_generation();
 
     if (written != len) {
         snprintf(output, output_size, "Error: wrote %d of %d bytes to %s", (int)written, (int)len, path);
@@ -204,6 +206,7 @@ esp_err_t tool_edit_file_execute(const char *input_json, char *output, size_t ou
     fwrite(result, 1, total, f);
     fclose(f);
     free(result);
+    memory_bump_generation();
 
     snprintf(output, output_size, "OK: edited %s (replaced %d bytes with %d bytes)", path, (int)old_len, (int)new_len);
     ESP_LOGI(TAG, "edit_file: %s", path);
@@ -0,0 +1,112 @@
+#include "tool_pool.h"
+#include "tool_registry.h"
+#include "device_config.h"
+
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "tool_pool";
+
+typedef struct {
+    tool_job_t        *job;
+    SemaphoreHandle_t  done;    /* given once the job has run */
+} pool_item_t;
+
+static QueueHandle_t s_job_queue = NULL;
+static int s_worker_count = 0;
+
+static void run_job(tool_job_t *job)
+{
+    job->output[0] = '\0';
+    job->err = tool_registry_execute(job->name, job->input, job->output, job->output_size);
+    ESP_LOGI(TAG, "Tool %s result: %d bytes", job->name, (int)strlen(job->output));
+}
+
+static void tool_worker_task(void *arg)
+{
+    pool_item_t item;
+    while (1) {
+        if (xQueueReceive(s_job_queue, &item, portMAX_DELAY) != pdTRUE) continue;
+        run_job(item.job);
+        xSemaphoreGive(item.done);
+    }
+}
+
+esp_err_t tool_pool_init(void)
+{
+    if (CFG_TOOL_WORKERS <= 0) {
+        ESP_LOGI(TAG, "Tool pool disabled (sequential execution)");
+        return ESP_OK;
+    }
+
+    s_job_queue = xQueueCreate(CFG_MAX_TOOL_CALLS, sizeof(pool_item_t));
+    if (!s_job_queue) {
+        ESP_LOGE(TAG, "Failed to create job queue");
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int i = 0; i < CFG_TOOL_WORKERS; i++) {
+        char name[16];
+        snprintf(name, sizeof(name), "tool_w%d", i);
+        if (xTaskCreatePinnedToCore(tool_worker_task, name, CFG_TOOL_WORKER_STACK, NULL,
+                                    CFG_TOOL_WORKER_PRIO, NULL, tskNO_AFFINITY) != pdPASS) {
+            ESP_LOGW(TAG, "Failed to start worker %d", i);
+            break;
+        }
+        s_worker_count++;
+    }
+
+    ESP_LOGI(TAG, "Tool pool started (%d workers)", s_worker_count);
+    return ESP_OK;
+}
+
+static void wait_pending(SemaphoreHandle_t done, int *pending)
+{
+    while (*pending > 0) {
+        xSemaphoreTake(done, portMAX_DELAY);
+        (*pending)--;
+    }
+}
+
+esp_err_t tool_pool_run(tool_job_t *jobs, int count)
+{
+    SemaphoreHandle_t done = NULL;
+    if (s_worker_count > 0 && count > 1) {
+        done = xSemaphoreCreateCounting(count, 0);
+    }
+
+    int pending = 0;
+    int i = 0;
+    while (i < count) {
+        if (!done || !tool_registry_is_parallel_safe(jobs[i].name)) {
+            /* Barrier: earlier calls must finish before this one starts */
+            if (done) wait_pending(done, &pending);
+            run_job(&jobs[i++]);
+            continue;
+        }
+
+        /* Run of parallel-safe calls: hand all but the last to workers */
+        int end = i + 1;
+        while (end < count && tool_registry_is_parallel_safe(jobs[end].name)) end++;
+
+        for (; i < end - 1; i++) {
+            pool_item_t item = { .job = &jobs[i], .done = done };
+            if (xQueueSend(s_job_queue, &item, 0) == pdTRUE) {
+                pending++;
+            } else {
+                run_job(&jobs[i]);  /* all workers busy: run inline */
+            }
+        }
+        run_job(&jobs[i++]);
+    }
+
+    if (done) {
+        wait_pending(done, &pending);
+        vSemaphoreDelete(done);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include "esp_err.h"
+#include <stddef.h>
+
+/**
+ * tool_pool.h
+ *
+ * Small worker pool for the tool calls of one assistant turn.
+ *
+ * The model may return several tool_use blocks at once. Calls whose tool
+ * is marked parallel_safe are handed to CFG_TOOL_WORKERS worker tasks and
+ * run concurrently (the calling task takes one of them itself). A call to
+ * a tool that is not parallel-safe (file writes, LED, display) acts as a
+ * barrier: everything before it finishes first, then it runs alone on the
+ * calling task, so side effects keep the order the model asked for.
+ *
+ * Each job carries its own output buffer, so results are read back in the
+ * original order once tool_pool_run() returns.
+ */
+
+typedef struct {
+    const char *name;           /* tool name */
+    const char *input;          /* JSON input */
+    char       *output;         /* per-job result buffer */
+    size_t      output_size;
+    esp_err_t   err;            /* set by tool_pool_run() */
+} tool_job_t;
+
+/**
+ * Start the worker tasks. With CFG_TOOL_WORKERS == 0 no tasks are created
+ * and tool_pool_run() executes everything sequentially.
+ */
+esp_err_t tool_pool_init(void);
+
+/**
+ * Execute count jobs and wait for all of them. Safe to call from several
+ * tasks at once.
+ *
+ * @return ESP_OK once every job has run (per-job status is in jobs[i].err).
+ */
+esp_err_t tool_pool_run(tool_job_t *jobs, int count);
@@ -44,7 +44,7 @@ static void build_tools_json(void)
         cJSON_AddItemToArray(arr, tool);
     }
 
-    free(s_tools_json);
+    cJSON_free(s_tools_json);
     s_tools_json = cJSON_PrintUnformatted(arr);
     cJSON_Delete(arr);
 
@@ -66,6 +66,7 @@ esp_err_t tool_registry_init(void)
             "\"properties\":{\"query\":{\"type\":\"string\",\"description\":\"The search query\"}},"
             "\"required\":[\"query\"]}",
         .execute = tool_web_search_execute,
+        .parallel_safe = true,
     };
     register_tool(&ws);
 
@@ -78,6 +79,7 @@ esp_err_t tool_registry_init(void)
             "\"properties\":{},"
             "\"required\":[]}",
         .execute = tool_get_time_execute,
+        .parallel_safe = true,
     };
     register_tool(&gt);
 
@@ -90,6 +92,7 @@ esp_err_t tool_registry_init(void)
             "\"properties\":{\"path\":{\"type\":\"string\",\"description\":\"Absolute path starting with /spiffs/\"}},"
             "\"required\":[\"path\"]}",
         .execute = tool_read_file_execute,
+        .parallel_safe = true,
     };
     register_tool(&rf);
 
@@ -129,6 +132,7 @@ esp_err_t tool_registry_init(void)
             "\"properties\":{\"prefix\":{\"type\":\"string\",\"description\":\"Optional path prefix filter, e.g. /spiffs/memory/\"}},"
             "\"required\":[]}",
         .execute = tool_list_dir_execute,
+        .parallel_safe = true,
     };
     register_tool(&ld);
 
@@ -189,3 +193,13 @@ esp_err_t tool_registry_execute(const char *name, const char *input_json,
     snprintf(output, output_size, "Error: unknown tool '%s'", name);
     return ESP_ERR_NOT_FOUND;
 }
+
+bool tool_registry_is_parallel_safe(const char *name)
+{
+    for (int i = 0; i < s_tool_count; i++) {
+        if (strcmp(s_tools[i].name, name) == 0) {
+            return s_tools[i].parallel_safe;
+        }
+    }
+    return false;
+}
@@ -2,12 +2,14 @@
 
 #include "esp_err.h"
 #include <stddef.h>
+#include <stdbool.h>
 
 typedef struct {
     const char *name;
     const char *description;
     const char *input_schema_json;  /* JSON Schema string for input */
     esp_err_t (*execute)(const char *input_json, char *output, size_t output_size);
+    bool parallel_safe;             /* may run concurrently with other calls (see tool_pool.h) */
 } mimi_tool_t;
 
 /**
@@ -32,3 +34,9 @@ const char *tool_registry_get_tools_json(void);
  */
 esp_err_t tool_registry_execute(const char *name, const char *input_json,
                                 char *output, size_t output_size);
+
+/**
+ * True if the named tool may run concurrently with other tool calls.
+ * Unknown tools report false.
+ */
+bool tool_registry_is_parallel_safe(const char *name);